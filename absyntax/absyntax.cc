@@ -105,6 +105,7 @@ list_c::list_c(symbol_c *elem,
 /* get element in position pos of the list */
 /*******************************************/    
 symbol_c *list_c::get_element(int pos) {return elements[pos].symbol;}
+const char *list_c::get_element_token_value(int pos) {return elements[pos].token_value;}
 
 
 
@@ -292,6 +292,8 @@ class list_c: public symbol_c {
           );
      /* get element in position pos of the list */
     virtual symbol_c *get_element(int pos);
+     /* get the token value associated to the element in position pos of the list */
+    virtual const char *get_element_token_value(int pos);
      /* find element associated to token value */
     virtual symbol_c *find_element(symbol_c   *token);
     virtual symbol_c *find_element(const char *token_value);
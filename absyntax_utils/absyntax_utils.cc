@@ -58,6 +58,7 @@
 #include "../util/dsymtable.hh"
 #include "../absyntax/visitor.hh"
 #include "../main.hh" // required for ERROR() and ERROR_MSG() macros.
+#include "function_overloads.hh"
 
 
 
@@ -281,5 +282,6 @@ void absyntax_utils_init(symbol_c *tree_root) {
   populate_symtables_c populate_symbols;
 
   tree_root->accept(populate_symbols);
+  function_overloads_c::init();
 }
 
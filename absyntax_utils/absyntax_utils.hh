@@ -100,7 +100,10 @@ extern  type_symtable_t type_symtable;
 #include "search_il_label.hh"
 #include "get_var_name.hh"
 #include "get_datatype_info.hh"
+#include "function_overloads.hh"
 #include "debug_ast.hh"
+#include "serialize_ast.hh"
+#include "library_module.hh"
 
 /***********************************************************************/
 /***********************************************************************/
@@ -0,0 +1,153 @@
+/*
+ *  matiec - a compiler for the programming languages defined in IEC 61131-3
+ *
+ *  Copyright (C) 2014  Mario de Sousa (msousa@fe.up.pt)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+/*
+ * An IEC 61131-3 compiler.
+ *
+ * Based on the
+ * FINAL DRAFT - IEC 61131-3, 2nd Ed. (2001-12-10)
+ *
+ */
+
+/*
+ *  An index of the overloaded Functions, used to speed up the resolution of function calls.
+ *  Please read the comments in function_overloads.hh for more details.
+ */
+
+#include "absyntax_utils.hh"
+
+#include "../main.hh" // required for ERROR() and ERROR_MSG() macros.
+
+#include <typeinfo>  // required for typeid
+#include <algorithm> // required for std::sort() and std::unique()
+#include <ctype.h>   // required for toupper()
+#include <string.h>  // required for strcmp()
+
+
+
+std::map<std::string, function_overloads_c::overload_set_t> function_overloads_c::index;
+const function_overloads_c::function_list_t                  function_overloads_c::empty_list;
+
+
+
+/* Function names are case insensitive! */
+static std::string index_key(const char *name) {
+  std::string key(name);
+  for (std::string::iterator i = key.begin(); i != key.end(); i++)
+    *i = toupper(*i);
+  return key;
+}
+
+
+
+void function_overloads_c::init(void) {
+  index.clear();
+  for (function_symtable_t::iterator i = function_symtable.begin(); i != function_symtable.end(); i++) {
+    function_declaration_c *f_decl = function_symtable.get_value(i);
+    overload_set_t &overload_set = index[index_key(i->first.c_str())];
+
+    /* Count the parameters, and get the data type of the first one (EN and ENO are never passed in non-formal invocations) */
+    function_param_iterator_c fp_iterator(f_decl);
+    identifier_c *param_name;
+    symbol_c     *first_param_type = NULL;
+    overload_t    overload = {f_decl, 0};
+    while ((param_name = fp_iterator.next()) != NULL) {
+      if ((strcmp(param_name->value, "EN") == 0) || (strcmp(param_name->value, "ENO") == 0)) continue;
+      if (0 == overload.param_count)
+        first_param_type = search_base_type_c::get_basetype_decl(fp_iterator.param_type());
+      if (fp_iterator.is_extensible_param()) {overload.param_count = -1; break;}
+      overload.param_count++;
+    }
+
+    int n = overload_set.overloads.size();
+    overload_set.overloads.push_back(overload);
+    overload_set.all.push_back(f_decl);
+    if      ((NULL == first_param_type) || get_datatype_info_c::is_ANY_generic_type(first_param_type))
+      overload_set.generic_first.push_back(n);
+    else if (get_datatype_info_c::is_ANY_ELEMENTARY_compatible(first_param_type))
+      overload_set.elementary_first[typeid(*first_param_type).name()].push_back(n);
+    else
+      overload_set.derived_first.push_back(n);
+  }
+}
+
+
+
+function_overloads_c::overload_set_t *function_overloads_c::get_overload_set(symbol_c *function_name) {
+  token_c *name = dynamic_cast<token_c *>(function_name);
+  if (NULL == name) ERROR;
+  std::map<std::string, overload_set_t>::iterator i = index.find(index_key(name->value));
+  if (i == index.end()) return NULL;
+  return &(i->second);
+}
+
+
+
+const function_overloads_c::function_list_t &function_overloads_c::find(symbol_c *function_name) {
+  overload_set_t *overload_set = get_overload_set(function_name);
+  if (NULL == overload_set) return empty_list;
+  return overload_set->all;
+}
+
+
+
+void function_overloads_c::find(symbol_c *function_name, int param_count, const std::vector<symbol_c *> &first_param_types, function_list_t &result) {
+  result.clear();
+  overload_set_t *overload_set = get_overload_set(function_name);
+  if (NULL == overload_set) return;
+
+  /* Determine which overloads may accept the first parameter */
+  std::vector<int> candidates;
+  bool all_candidates = (0 == param_count);
+  for (unsigned int i = 0; (i < first_param_types.size()) && !all_candidates; i++) {
+    symbol_c *type = first_param_types[i];
+    if      (!get_datatype_info_c::is_type_valid(type))
+      continue;
+    else if (get_datatype_info_c::is_ANY_generic_type(type))
+      all_candidates = true;
+    else if (get_datatype_info_c::is_ANY_ELEMENTARY_compatible(type)) {
+      std::map<std::string, std::vector<int> >::iterator j = overload_set->elementary_first.find(typeid(*type).name());
+      if (j != overload_set->elementary_first.end())
+        candidates.insert(candidates.end(), j->second.begin(), j->second.end());
+    } else
+      candidates.insert(candidates.end(), overload_set->derived_first.begin(), overload_set->derived_first.end());
+  }
+
+  if (all_candidates) {
+    candidates.clear();
+    for (unsigned int i = 0; i < overload_set->overloads.size(); i++)
+      candidates.push_back(i);
+  } else {
+    candidates.insert(candidates.end(), overload_set->generic_first.begin(), overload_set->generic_first.end());
+    /* keep the declaration order, and remove duplicates */
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+  }
+
+  /* Keep only the overloads that accept that many parameters */
+  for (unsigned int i = 0; i < candidates.size(); i++) {
+    overload_t &overload = overload_set->overloads[candidates[i]];
+    if ((overload.param_count < 0) || (overload.param_count >= param_count))
+      result.push_back(overload.f_decl);
+  }
+}
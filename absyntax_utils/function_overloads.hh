@@ -0,0 +1,102 @@
+/*
+ *  matiec - a compiler for the programming languages defined in IEC 61131-3
+ *
+ *  Copyright (C) 2014  Mario de Sousa (msousa@fe.up.pt)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+/*
+ * An IEC 61131-3 compiler.
+ *
+ * Based on the
+ * FINAL DRAFT - IEC 61131-3, 2nd Ed. (2001-12-10)
+ *
+ */
+
+/*
+ *  An index of the overloaded Functions (i.e. the Functions declared more than once with the
+ *  same name, but with distinct parameter data types, such as the ADD, MUL, SEL, ... standard
+ *  functions), used to speed up the resolution of function calls during data type analysis
+ *  (fill_candidate_datatypes_c).
+ *
+ *  For each Function name, the overloads are indexed by the data type of their first
+ *  parameter, and keep the number of parameters they accept, so that the non-formal
+ *  invocations (e.g. ADD(a, b)) only need to be matched against the overloads that may
+ *  actually accept the parameters being passed.
+ *
+ *  Elementary data types are indexed by their class (all instances of int_type_name_c are
+ *  the same data type). All derived data types share a single entry, and overloads whose
+ *  first parameter has a generic data type (ANY) are always considered.
+ *
+ *  The index is built by absyntax_utils_init(), from the function_symtable, and the overloads
+ *  are always returned in the order in which they were declared.
+ */
+
+#ifndef _FUNCTION_OVERLOADS_HH
+#define _FUNCTION_OVERLOADS_HH
+
+#include "absyntax_utils.hh"
+#include <vector>
+#include <map>
+#include <string>
+
+
+class function_overloads_c {
+  private: // this is a purely static class. No need for constructors!
+     function_overloads_c(void) {};
+    ~function_overloads_c(void) {};
+
+  public:
+    typedef std::vector<function_declaration_c *> function_list_t;
+
+  private:
+    typedef struct {
+      function_declaration_c *f_decl;
+      int                     param_count;   /* number of parameters (excluding EN/ENO). -1 if extensible */
+    } overload_t;
+
+    typedef struct {
+      std::vector<overload_t>                    overloads;         /* in declaration order */
+      function_list_t                            all;               /* same as above, without the additional info */
+      std::map<std::string, std::vector<int> >   elementary_first;  /* index of the overloads, by the class of the elementary datatype of the 1st parameter */
+      std::vector<int>                           derived_first;     /* overloads whose 1st parameter has a derived datatype */
+      std::vector<int>                           generic_first;     /* overloads whose 1st parameter has a generic datatype, or that have no parameters */
+    } overload_set_t;
+
+    static std::map<std::string, overload_set_t> index;
+    static const function_list_t                  empty_list;
+
+    static overload_set_t *get_overload_set(symbol_c *function_name);
+
+  public:
+    /* (re)build the index from the function_symtable */
+    static void init(void);
+
+    /* All the Functions declared with the name 'function_name'. */
+    static const function_list_t &find(symbol_c *function_name);
+
+    /* The Functions declared with the name 'function_name' that may accept a non-formal
+     * invocation with 'param_count' parameters, the first of which has one of the data types
+     * in 'first_param_types' (ignored when there are no parameters).
+     */
+    static void find(symbol_c *function_name, int param_count, const std::vector<symbol_c *> &first_param_types, function_list_t &result);
+};
+
+
+#endif /* _FUNCTION_OVERLOADS_HH */
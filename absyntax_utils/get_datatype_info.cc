@@ -584,6 +584,11 @@ bool get_datatype_info_c::is_type_equal(symbol_c *first_type, symbol_c *second_t
   if (!is_type_valid( first_type))                                   {return false;}
   if (!is_type_valid(second_type))                                   {return false;}
 
+  /* The fast path, taken by (almost) all the datatypes in the candidate datatype lists of stage 3 */
+  int  first_id = get_datatype_id( first_type);
+  int second_id = get_datatype_id(second_type);
+  if ((first_id >= 0) && (second_id >= 0))                           {return (first_id == second_id);}
+
   /* GENERIC DATATYPES */
   /* For the moment, we only support the ANY generic datatype! */
   if ((is_ANY_generic_type( first_type)) ||
@@ -744,6 +749,89 @@ bool get_datatype_info_c::is_arraytype_equal_relaxed(symbol_c *first_type, symbo
 
 
 
+/* The elementary datatypes, in the order of their ids */
+static const std::type_info *elementary_datatypes[] = {
+  &typeid(time_type_name_c),     &typeid(bool_type_name_c),       &typeid(sint_type_name_c),      &typeid(int_type_name_c),
+  &typeid(dint_type_name_c),     &typeid(lint_type_name_c),       &typeid(usint_type_name_c),     &typeid(uint_type_name_c),
+  &typeid(udint_type_name_c),    &typeid(ulint_type_name_c),      &typeid(real_type_name_c),      &typeid(lreal_type_name_c),
+  &typeid(date_type_name_c),     &typeid(tod_type_name_c),        &typeid(dt_type_name_c),        &typeid(byte_type_name_c),
+  &typeid(word_type_name_c),     &typeid(dword_type_name_c),      &typeid(lword_type_name_c),     &typeid(string_type_name_c),
+  &typeid(wstring_type_name_c),
+  &typeid(safetime_type_name_c), &typeid(safebool_type_name_c),   &typeid(safesint_type_name_c),  &typeid(safeint_type_name_c),
+  &typeid(safedint_type_name_c), &typeid(safelint_type_name_c),   &typeid(safeusint_type_name_c), &typeid(safeuint_type_name_c),
+  &typeid(safeudint_type_name_c),&typeid(safeulint_type_name_c),  &typeid(safereal_type_name_c),  &typeid(safelreal_type_name_c),
+  &typeid(safedate_type_name_c), &typeid(safetod_type_name_c),    &typeid(safedt_type_name_c),    &typeid(safebyte_type_name_c),
+  &typeid(safeword_type_name_c), &typeid(safedword_type_name_c),  &typeid(safelword_type_name_c), &typeid(safestring_type_name_c),
+  &typeid(safewstring_type_name_c)
+};
+
+const int get_datatype_info_c::elementary_datatype_count = sizeof(elementary_datatypes) / sizeof(elementary_datatypes[0]);
+
+
+/* The id of each (non elementary) datatype symbol already seen by get_datatype_id().
+ * A temporary symbol (e.g. one created on the stack) may later be replaced by another symbol at the same
+ * address, so we also store the class of the symbol, and only reuse the id if the class is the same.
+ * Note that the id of the symbols of the same class can only differ if they reference another datatype,
+ * which is why datatype names (tokens) are always given the id -1.
+ */
+typedef struct {
+  const std::type_info *type_info;
+  int id;
+} datatype_id_t;
+
+static const unsigned int elementary_hash_size = 128; /* a power of 2, at least twice the number of elementary datatypes */
+static inline unsigned int elementary_hash(const std::type_info *type_info) {
+  return (((unsigned long)type_info) >> 3) % elementary_hash_size;
+}
+
+static std::map<symbol_c *, datatype_id_t> derived_datatype_ids;
+
+
+int get_datatype_info_c::get_datatype_id(symbol_c *type) {
+  static int next_derived_id = elementary_datatype_count;
+  
+  if (NULL == type)                                                  {return -1;}
+  /* The elementary datatypes (by far the most common) are equivalent if they are of the same class (see is_type_equal()).
+   * Their ids are kept in a small hash table indexed by the address of their type_info object, as this
+   * function is called for (almost) every comparison of two datatypes in stage 3.
+   */
+  static const std::type_info *elementary_hash_type[elementary_hash_size];
+  static int                   elementary_hash_id  [elementary_hash_size];
+  static bool                  elementary_hash_init = false;
+  if (!elementary_hash_init) {
+    for (int i = 0; i < elementary_datatype_count; i++) {
+      unsigned int h = elementary_hash(elementary_datatypes[i]);
+      while (NULL != elementary_hash_type[h])  h = (h + 1) % elementary_hash_size;
+      elementary_hash_type[h] = elementary_datatypes[i];
+      elementary_hash_id  [h] = i;
+    }
+    elementary_hash_init = true;
+  }
+  const std::type_info *type_info = &typeid(*type);
+  for (unsigned int h = elementary_hash(type_info); NULL != elementary_hash_type[h]; h = (h + 1) % elementary_hash_size)
+    if (type_info == elementary_hash_type[h])                        {return elementary_hash_id[h];}
+  
+  std::map<symbol_c *, datatype_id_t>::iterator iter = derived_datatype_ids.find(type);
+  if ((iter != derived_datatype_ids.end()) && (iter->second.type_info == type_info))
+                                                                     {return iter->second.id;}  /* already determined */
+  
+  datatype_id_t datatype_id = {type_info, -1};
+  if (!is_type_valid(type) || is_ANY_generic_type(type))             {}
+  else if (is_ANY_ELEMENTARY_compatible(type)) {
+    for (int i = 0; i < elementary_datatype_count; i++)
+      if (typeid(*type) == *elementary_datatypes[i])               {datatype_id.id = i; break;}
+  }
+  /* derived datatypes are only equivalent to themselves, except for the following... */
+  else if (NULL != dynamic_cast<token_c *>(type))                    {}
+  else if (is_ref_to(type))                                          {}
+  else if (runtime_options.relaxed_datatype_model && is_array(type)) {}
+  else                                                               {datatype_id.id = next_derived_id++;}
+  derived_datatype_ids[type] = datatype_id;
+  return datatype_id.id;
+}
+
+
+
 bool get_datatype_info_c::is_type_valid(symbol_c *type) {
   if (NULL == type)                                                  {return false;}
   if (typeid(*type) == typeid(invalid_type_name_c))                  {return false;}
@@ -83,6 +83,15 @@ class get_datatype_info_c {
     static bool is_type_equal(symbol_c *first_type, symbol_c *second_type);
     static bool is_type_valid(symbol_c *type);
 
+    /* Returns a small integer (>= 0) identifying the datatype, such that two datatypes with an id
+     * are equivalent (is_type_equal()) if and only if their ids are equal.
+     * Returns -1 for the datatypes whose equivalence depends on more than their identity (invalid, generic
+     * and REF_TO datatypes, arrays in the relaxed datatype model, datatype names, ...).
+     * Elementary datatypes have the ids 0 .. elementary_datatype_count-1.
+     */
+    static int  get_datatype_id(symbol_c *type);
+    static const int elementary_datatype_count;
+
     static bool is_ref_to                          (symbol_c *type_symbol);    // Defined in IEC 61131-3 v3
     static bool is_sfc_initstep                    (symbol_c *type_symbol);
     static bool is_sfc_step                        (symbol_c *type_symbol);
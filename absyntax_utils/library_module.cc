@@ -0,0 +1,115 @@
+/*
+ *  matiec - a compiler for the programming languages defined in IEC 61131-3
+ *
+ *  Copyright (C) 2014  Mario de Sousa (msousa@fe.up.pt)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+/*
+ * An IEC 61131-3 compiler.
+ *
+ * Based on the
+ * FINAL DRAFT - IEC 61131-3, 2nd Ed. (2001-12-10)
+ *
+ */
+
+/*
+ *  Save the interface of a library (a library module), and load it back again.
+ *  Please read the comments in library_module.hh for more details.
+ */
+
+#include "library_module.hh"
+
+#include "../main.hh" // required for ERROR() and ERROR_MSG() macros.
+
+#include <stdio.h>
+#include <string.h>  // required for strrchr(), strdup()
+
+
+
+/* The declaration of the POU, without its body. */
+static symbol_c *pou_interface(symbol_c *element) {
+  { function_declaration_c       *d = dynamic_cast<function_declaration_c       *>(element);
+    if (NULL != d) {d = new function_declaration_c      (*d); d->function_body       = new statement_list_c(); return d;}}
+  { function_block_declaration_c *d = dynamic_cast<function_block_declaration_c *>(element);
+    if (NULL != d) {d = new function_block_declaration_c(*d); d->fblock_body         = new statement_list_c(); return d;}}
+  { program_declaration_c        *d = dynamic_cast<program_declaration_c        *>(element);
+    if (NULL != d) {d = new program_declaration_c       (*d); d->function_block_body = new statement_list_c(); return d;}}
+  return NULL;
+}
+
+
+
+bool library_module_c::save(symbol_c *tree_root, const char *filename) {
+  library_c *library = dynamic_cast<library_c *>(tree_root);
+  if (NULL == library) ERROR;
+
+  library_c *interface = new library_c();
+  bool generate_code = true;
+  for (int i = 0; i < library->n; i++) {
+    symbol_c *element = library->get_element(i);
+    if (NULL != dynamic_cast<disable_code_generation_pragma_c *>(element)) generate_code = false;
+    if (NULL != dynamic_cast< enable_code_generation_pragma_c *>(element)) generate_code = true;
+    if (!generate_code) continue;
+
+    symbol_c *pou = pou_interface(element);
+    if (NULL != dynamic_cast<data_type_declaration_c *>(element)) {
+      interface->add_element(element);
+    } else if (NULL != pou) {
+      interface->add_element(pou);
+    } else if (NULL != dynamic_cast<configuration_declaration_c *>(element)) {
+      fprintf(stderr, "%s:%d-%d..%d-%d: error: a library module may not contain a CONFIGURATION.\n",
+              element->first_file, element->first_line, element->first_column, element->last_line, element->last_column);
+      return false;
+    }
+    /* any other pragmas are simply ignored */
+  }
+
+  /* the interface does not include the bodies of the POUs, so the annotations (of stage 3) are
+   * not required, and would reference symbols (e.g. of the standard library) outside the interface.
+   */
+  return serialize_ast_c::save(interface, filename, false);
+}
+
+
+
+library_c *library_module_c::load(const char *filename) {
+  symbol_c *tree_root = serialize_ast_c::load(filename);
+  if (NULL == tree_root) return NULL;
+
+  library_c *library = dynamic_cast<library_c *>(tree_root);
+  if (NULL == library)
+    fprintf(stderr, "File %s is not a library module.\n", filename);
+  return library;
+}
+
+
+
+const char *library_module_c::name(const char *filename) {
+  const char *name = strrchr(filename, '/');
+  name = (NULL == name)? filename : name + 1;
+  #ifdef __WIN32__
+  if (NULL != strrchr(name, '\\')) name = strrchr(name, '\\') + 1;
+  #endif
+  char *module_name = strdup(name);
+  if (NULL == module_name) ERROR_MSG("out of memory");
+  char *extension = strrchr(module_name, '.');
+  if ((NULL != extension) && (extension != module_name)) *extension = '\0';
+  return module_name;
+}
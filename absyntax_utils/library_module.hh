@@ -0,0 +1,81 @@
+/*
+ *  matiec - a compiler for the programming languages defined in IEC 61131-3
+ *
+ *  Copyright (C) 2014  Mario de Sousa (msousa@fe.up.pt)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+/*
+ * An IEC 61131-3 compiler.
+ *
+ * Based on the
+ * FINAL DRAFT - IEC 61131-3, 2nd Ed. (2001-12-10)
+ *
+ */
+
+/*
+ *  Library modules: a library compiled once, and then imported by any number of projects.
+ *
+ *  Compiling a library with '-m <module_file>' generates the C code of the library as usual
+ *  (into <module_name>.c and <module_name>.h, instead of POUS.c and POUS.h), and additionally
+ *  saves the interface of the library in the module file. The interface contains the derived
+ *  datatypes and the declarations of the Functions, FBs and Programs of the library, but not their
+ *  bodies (these are replaced by an empty list of statements).
+ *
+ *  A project imports the module with '-M <module_file>'. The interface is loaded before the project
+ *  is parsed, and its elements are added to the AST enclosed in the {disable code generation} and
+ *  {enable code generation} pragmas (just like the standard library). The project may therefore use
+ *  the datatypes and POUs of the module, but no code is generated for them. The generated POUS.h
+ *  instead includes <module_name>.h, and the (already compiled) <module_name>.c must be linked
+ *  with the project.
+ *
+ *  The name of the module (<module_name> above) is the name of the module file, without
+ *  the directory and the extension.
+ *
+ *  Only the library elements for which code is generated are saved in the interface. The
+ *  elements of the modules imported while compiling a module are therefore not saved in its
+ *  interface, and must be imported separately by the projects that use them.
+ */
+
+#ifndef _LIBRARY_MODULE_HH
+#define _LIBRARY_MODULE_HH
+
+#include "absyntax_utils.hh"
+
+
+class library_module_c {
+  private: // this is a purely static class. No need for constructors!
+     library_module_c(void) {};
+    ~library_module_c(void) {};
+
+  public:
+    /* Save the interface of the library elements (of tree_root) for which code is generated.
+     * Returns false (after printing an error message) if the interface could not be saved.
+     */
+    static bool       save(symbol_c *tree_root, const char *filename);
+    /* Load the interface saved by save().
+     * Returns NULL (after printing an error message) if the module could not be loaded.
+     */
+    static library_c *load(const char *filename);
+    /* The name of the module saved in the file (i.e. the name of the file, without directory and extension) */
+    static const char *name(const char *filename);
+};
+
+
+#endif /* _LIBRARY_MODULE_HH */
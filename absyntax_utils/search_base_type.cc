@@ -54,7 +54,7 @@ search_base_type_c *search_base_type_c::search_base_type_singleton = NULL;
 
 
 
-search_base_type_c::search_base_type_c(void) {current_basetype_name = NULL; current_basetype = NULL; current_equivtype = NULL;}
+search_base_type_c::search_base_type_c(void) {current_basetype_name = NULL; current_basetype = NULL; current_equivtype = NULL; current_equivtype_forced = false;}
 
 /* static method! */
 void search_base_type_c::create_singleton(void) {
@@ -63,13 +63,20 @@ void search_base_type_c::create_singleton(void) {
 }
 
 /* static method! */
-symbol_c *search_base_type_c::get_equivtype_decl(symbol_c *symbol) {
+/* Follow the chain of data type declarations referenced by 'symbol', and return the base type. */
+symbol_c *search_base_type_c::resolve(symbol_c *symbol) {
   create_singleton();
-  if (NULL == symbol)    return NULL; 
   search_base_type_singleton->current_basetype_name = NULL;
   search_base_type_singleton->current_basetype  = NULL; 
   search_base_type_singleton->current_equivtype = NULL; 
-  symbol_c *basetype = (symbol_c *)symbol->accept(*search_base_type_singleton);
+  search_base_type_singleton->current_equivtype_forced = false;
+  return (symbol_c *)symbol->accept(*search_base_type_singleton);
+}
+
+/* static method! */
+symbol_c *search_base_type_c::get_equivtype_decl(symbol_c *symbol) {
+  if (NULL == symbol)    return NULL; 
+  symbol_c *basetype = resolve(symbol);
   if (NULL != search_base_type_singleton->current_equivtype)
     return search_base_type_singleton->current_equivtype;
   return basetype;
@@ -77,22 +84,14 @@ symbol_c *search_base_type_c::get_equivtype_decl(symbol_c *symbol) {
 
 /* static method! */
 symbol_c *search_base_type_c::get_basetype_decl(symbol_c *symbol) {
-  create_singleton();
   if (NULL == symbol)    return NULL; 
-  search_base_type_singleton->current_basetype_name = NULL;
-  search_base_type_singleton->current_basetype  = NULL; 
-  search_base_type_singleton->current_equivtype = NULL; 
-  return (symbol_c *)symbol->accept(*search_base_type_singleton);
+  return resolve(symbol);
 }
 
 /* static method! */
 symbol_c *search_base_type_c::get_basetype_id  (symbol_c *symbol) {
-  create_singleton();
   if (NULL == symbol)    return NULL; 
-  search_base_type_singleton->current_basetype_name = NULL;
-  search_base_type_singleton->current_basetype  = NULL; 
-  search_base_type_singleton->current_equivtype = NULL; 
-  symbol->accept(*search_base_type_singleton);
+  resolve(symbol);
   return (symbol_c *)search_base_type_singleton->current_basetype_name;
 }
 
@@ -117,11 +116,11 @@ void *search_base_type_c::handle_datatype_identifier(token_c *type_name) {
   /* look up the type declaration... */
   type_symtable_t::iterator iter1 = type_symtable.find(type_name);
   if (iter1 != type_symtable.end())
-    return iter1->second->accept(*this); // iter1->second is the type_decl 
+    return visit_type_decl(type_name, iter1->second); // iter1->second is the type_decl 
     
   function_block_type_symtable_t::iterator iter2  = function_block_type_symtable.find(type_name);
   if (iter2 != function_block_type_symtable.end())
-    return iter2->second->accept(*this); // iter2->second is the type_decl 
+    return visit_type_decl(type_name, iter2->second); // iter2->second is the type_decl 
   
   /* Type declaration not found!! */
   ERROR;
@@ -129,6 +128,35 @@ void *search_base_type_c::handle_datatype_identifier(token_c *type_name) {
   return NULL;
 }
 
+
+/* Visit the type declaration of the datatype named type_name, or reuse the result of a previous visit (see type_decl_results) */
+void *search_base_type_c::visit_type_decl(token_c *type_name, symbol_c *type_decl) {
+  std::map<symbol_c *, type_decl_result_t>::iterator iter = type_decl_results.find(type_decl);
+  if (iter == type_decl_results.end()) {
+    symbol_c *prev_equivtype        = this->current_equivtype;
+    bool      prev_equivtype_forced = this->current_equivtype_forced;
+    this->current_equivtype        = NULL;
+    this->current_equivtype_forced = false;
+    type_decl_result_t result;
+    result.basetype         = (symbol_c *)type_decl->accept(*this);
+    result.basetype_name    = (this->current_basetype_name == type_name)? NULL : this->current_basetype_name;
+    result.current_basetype = this->current_basetype;
+    result.equivtype        = this->current_equivtype;
+    result.equivtype_forced = this->current_equivtype_forced;
+    iter = type_decl_results.insert(std::make_pair(type_decl, result)).first;
+    this->current_equivtype        = prev_equivtype;
+    this->current_equivtype_forced = prev_equivtype_forced;
+  }
+  
+  this->current_basetype_name = (NULL != iter->second.basetype_name)? iter->second.basetype_name : type_name;
+  this->current_basetype      = iter->second.current_basetype;
+  /* A subrange_type_declaration_c overrides the current_equivtype, the other symbols only set it if it is still NULL */
+  if ((iter->second.equivtype_forced) || (NULL == this->current_equivtype))
+    this->current_equivtype = iter->second.equivtype;
+  this->current_equivtype_forced = this->current_equivtype_forced || iter->second.equivtype_forced;
+  return iter->second.basetype;
+}
+
 void *search_base_type_c::visit(                 identifier_c *type_name) {return handle_datatype_identifier(type_name);}  
 void *search_base_type_c::visit(derived_datatype_identifier_c *type_name) {return handle_datatype_identifier(type_name);}  
 void *search_base_type_c::visit(         poutype_identifier_c *type_name) {return handle_datatype_identifier(type_name);}  
@@ -237,6 +265,7 @@ void *search_base_type_c::visit(simple_spec_init_c *symbol) {
 /*  subrange_type_name ':' subrange_spec_init */
 void *search_base_type_c::visit(subrange_type_declaration_c *symbol) {
   this->current_equivtype = symbol;
+  this->current_equivtype_forced = true;
   return symbol->subrange_spec_init->accept(*this);
 }
 
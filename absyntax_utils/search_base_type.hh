@@ -70,11 +70,32 @@ class search_base_type_c: public null_visitor_c {
     symbol_c *current_basetype_name;
     symbol_c *current_basetype;
     symbol_c *current_equivtype;
+    bool      current_equivtype_forced; /* current_equivtype was set by a subrange_type_declaration_c (which overrides any previous value) */
     static search_base_type_c *search_base_type_singleton; // Make this a singleton class!
+
+    /* The result of visiting each type declaration referenced by a datatype name, so that each chain of
+     * TYPE declarations (e.g. TYPE t1 : t2; END_TYPE, TYPE t2 : t3; END_TYPE, ...) is only followed once.
+     * The key is the type declaration stored in the type_symtable (or function_block_type_symtable).
+     * These are never deleted, so unlike the (possibly temporary) symbols we are asked about, they can
+     * safely be used as keys.
+     * Visiting a type declaration always starts with current_basetype_name pointing to the datatype name,
+     * and current_basetype == NULL. current_equivtype however may already have been set, so we store
+     * the value it takes when starting off with NULL, and whether it was forced (see current_equivtype_forced).
+     */
+    typedef struct {
+      symbol_c *basetype;        /* the value returned by the visit */
+      symbol_c *basetype_name;   /* NULL if it was left pointing to the datatype name */
+      symbol_c *current_basetype;
+      symbol_c *equivtype;
+      bool      equivtype_forced;
+    } type_decl_result_t;
+    std::map<symbol_c *, type_decl_result_t> type_decl_results;
     
   private:  
     static void create_singleton(void);
+    static symbol_c *resolve(symbol_c *symbol);
     void *handle_datatype_identifier(token_c *type_name);
+    void *visit_type_decl(token_c *type_name, symbol_c *type_decl);
 
   public:
     search_base_type_c(void);
@@ -88,6 +88,7 @@
 
 
 #include "absyntax_utils.hh"
+#include <ctype.h>  /* required for toupper() */
 
 
 
@@ -96,17 +97,75 @@
 search_var_instance_decl_c::search_var_instance_decl_c(symbol_c *search_scope) {
   this->current_vartype = none_vt;
   this->search_scope = search_scope;
-  this->search_name = NULL;
+  this->current_index = NULL;
   this->current_type_decl = NULL;
   this->current_option = none_opt;
 }
 
+std::map<symbol_c *, search_var_instance_decl_c::scope_index_t> search_var_instance_decl_c::declaration_index;
+
+
+void search_var_instance_decl_c::invalidate_declaration_index(symbol_c *search_scope) {
+  if (NULL == search_scope) declaration_index.clear();
+  else                      declaration_index.erase(search_scope);
+}
+
+
+static std::string index_key(token_c *name) {
+  /* identifiers are case insensitive */
+  std::string key = name->value;
+  for (std::string::iterator c = key.begin(); c != key.end(); ++c) *c = toupper(*c);
+  return key;
+}
+
+
+/* Search for the declaration of the variable in the declaration_index.
+ * The first search in each scope builds the index of that scope, by visiting the scope
+ * in the same way as when searching for a single variable, but adding every variable found
+ * along the way to the index (see is_search_name() ).
+ */
+search_var_instance_decl_c::decl_info_t search_var_instance_decl_c::search(symbol_c *variable) {
+  decl_info_t info = {NULL, none_vt, none_opt};
+
+  token_c *name = get_var_name_c::get_name(variable);
+  if (NULL == name) return info; // does not match any declaration
+
+  std::map<symbol_c *, scope_index_t>::iterator scope_index = declaration_index.find(search_scope);
+  if (scope_index == declaration_index.end()) {
+    scope_index = declaration_index.insert(std::make_pair(search_scope, scope_index_t())).first;
+    this->current_index     = &(scope_index->second);
+    this->current_vartype   = none_vt;
+    this->current_option    = none_opt;
+    this->current_type_decl = NULL;
+    search_scope->accept(*this);
+    this->current_index     = NULL;
+  }
+
+  scope_index_t::iterator iter = scope_index->second.find(index_key(name));
+  if (iter != scope_index->second.end())
+    info = iter->second;
+  return info;
+}
+
+
+/* Is 'name' the variable being searched for?
+ * While building the index of a scope it never is. Instead, the variable is added to the index,
+ * together with the declaration that a search for it would return ('decl') and the current var
+ * type and option, and the remaining declarations of the scope are then visited too.
+ */
+bool search_var_instance_decl_c::is_search_name(symbol_c *name, symbol_c *decl) {
+  token_c *token = dynamic_cast<token_c *>(name);
+  if ((NULL == token) || (NULL == current_index)) return false;
+  decl_info_t info = {decl, current_vartype, current_option};
+  /* insert() does not replace an existing entry so, just like in a search, the first declaration found is kept. */
+  current_index->insert(std::make_pair(index_key(token), info));
+  return false;
+}
+
+
 symbol_c *search_var_instance_decl_c::get_decl(symbol_c *variable) {
-  this->current_vartype = none_vt;
-  this->current_option  = none_opt;
-  this->search_name = get_var_name_c::get_name(variable);
   if (NULL == search_scope) return NULL; // NOTE: This is not an ERROR! declaration_check_c, for e.g., relies on this returning NULL!
-  return (symbol_c *)search_scope->accept(*this);
+  return search(variable).decl;
 }
 
 symbol_c *search_var_instance_decl_c::get_basetype_decl(symbol_c *variable) {
@@ -114,21 +173,13 @@ symbol_c *search_var_instance_decl_c::get_basetype_decl(symbol_c *variable) {
 }
 
 search_var_instance_decl_c::vt_t search_var_instance_decl_c::get_vartype(symbol_c *variable) {
-  this->current_vartype = none_vt;
-  this->current_option  = none_opt;
-  this->search_name = get_var_name_c::get_name(variable);
   if (NULL == search_scope) ERROR;
-  search_scope->accept(*this);
-  return this->current_vartype;
+  return search(variable).vartype;
 }
 
 search_var_instance_decl_c::opt_t search_var_instance_decl_c::get_option(symbol_c *variable) {
-  this->current_vartype = none_vt;
-  this->current_option  = none_opt;
-  this->search_name = get_var_name_c::get_name(variable);
   if (NULL == search_scope) ERROR;
-  search_scope->accept(*this);
-  return this->current_option;
+  return search(variable).option;
 }
 
 
@@ -209,14 +260,14 @@ void *search_var_instance_decl_c::visit(input_output_declarations_c *symbol) {
 
 /* ENO : BOOL */
 void *search_var_instance_decl_c::visit(eno_param_declaration_c *symbol) {
-  if (compare_identifiers(symbol->name, search_name) == 0)
+  if (is_search_name(symbol->name, symbol->type))
     return symbol->type;
   return NULL;
 }
 
 /* EN : BOOL */
 void *search_var_instance_decl_c::visit(en_param_declaration_c *symbol) {
-  if (compare_identifiers(symbol->name, search_name) == 0)
+  if (is_search_name(symbol->name, symbol->type_decl))
     return symbol->type_decl;
   return NULL;
 }
@@ -313,7 +364,7 @@ void *search_var_instance_decl_c::visit(var1_init_decl_c *symbol) {
 void *search_var_instance_decl_c::visit(var1_list_c *symbol) {
   list_c *list = symbol;
   for(int i = 0; i < list->n; i++) {
-    if (compare_identifiers(list->get_element(i), search_name) == 0)
+    if (is_search_name(list->get_element(i), current_type_decl))
    /* by now, current_type_decl should be != NULL */
       return current_type_decl;
   }
@@ -335,7 +386,7 @@ void *search_var_instance_decl_c::visit(fb_name_decl_c *symbol) {
 void *search_var_instance_decl_c::visit(fb_name_list_c *symbol) {
   list_c *list = symbol;
   for(int i = 0; i < list->n; i++) {
-    if (compare_identifiers(list->get_element(i), search_name) == 0)
+    if (is_search_name(list->get_element(i), current_type_decl))
     /* by now, current_fb_declaration should be != NULL */
       return current_type_decl;
   }
@@ -378,7 +429,7 @@ void *search_var_instance_decl_c::visit(structured_var_declaration_c *symbol) {
 /*  global_var_name ':' (simple_specification|subrange_specification|enumerated_specification|array_specification|prev_declared_structure_type_name|function_block_type_name */
 // SYM_REF2(external_declaration_c, global_var_name, specification)
 void *search_var_instance_decl_c::visit(external_declaration_c *symbol) {
-  if (compare_identifiers(symbol->global_var_name, search_name) == 0)
+  if (is_search_name(symbol->global_var_name, symbol->specification))
       return symbol->specification;
   return NULL;
 }
@@ -398,7 +449,7 @@ void *search_var_instance_decl_c::visit(global_var_decl_c *symbol) {
 /*| global_var_name location */
 //SYM_REF2(global_var_spec_c, global_var_name, location)
 void *search_var_instance_decl_c::visit(global_var_spec_c *symbol) {
-  if (symbol->global_var_name != NULL && compare_identifiers(symbol->global_var_name, search_name) == 0)
+  if (symbol->global_var_name != NULL && is_search_name(symbol->global_var_name, current_type_decl))
       return current_type_decl;
   else
     return symbol->location->accept(*this);
@@ -409,7 +460,7 @@ void *search_var_instance_decl_c::visit(global_var_spec_c *symbol) {
 void *search_var_instance_decl_c::visit(global_var_list_c *symbol) {
   list_c *list = symbol;
   for(int i = 0; i < list->n; i++) {
-    if (compare_identifiers(list->get_element(i), search_name) == 0)
+    if (is_search_name(list->get_element(i), current_type_decl))
       /* by now, current_type_decl should be != NULL */
       return current_type_decl;
   }
@@ -420,7 +471,7 @@ void *search_var_instance_decl_c::visit(global_var_list_c *symbol) {
 /* variable_name -> may be NULL ! */
 //SYM_REF4(located_var_decl_c, variable_name, location, located_var_spec_init, unused)
 void *search_var_instance_decl_c::visit(located_var_decl_c *symbol) {
-  if (symbol->variable_name != NULL && compare_identifiers(symbol->variable_name, search_name) == 0)
+  if (symbol->variable_name != NULL && is_search_name(symbol->variable_name, symbol->located_var_spec_init))
     return symbol->located_var_spec_init;
   else {
     current_type_decl = symbol->located_var_spec_init;
@@ -436,7 +487,7 @@ void *search_var_instance_decl_c::visit(located_var_decl_c *symbol) {
 /*  AT direct_variable */
 // SYM_REF2(location_c, direct_variable, unused)
 void *search_var_instance_decl_c::visit(location_c *symbol) {
-  if (compare_identifiers(symbol->direct_variable, search_name) == 0)
+  if (is_search_name(symbol->direct_variable, current_type_decl))
     return current_type_decl;
   else
     return NULL;
@@ -492,7 +543,7 @@ void *search_var_instance_decl_c::visit(function_declaration_c *symbol) {
   /* functions have a variable named after themselves, to store
    * the variable that will be returned!!
    */
-  if (compare_identifiers(symbol->derived_function_name, search_name) == 0)
+  if (is_search_name(symbol->derived_function_name, symbol->type_name))
       return symbol->type_name;
 
   /* no need to search through all the body, so we only
@@ -549,7 +600,7 @@ void *search_var_instance_decl_c::visit(program_declaration_c *symbol) {
 /* INITIAL_STEP step_name ':' action_association_list END_STEP */
 // SYM_REF2(initial_step_c, step_name, action_association_list)
 void *search_var_instance_decl_c::visit(initial_step_c *symbol) {
-  if (compare_identifiers(symbol->step_name, search_name) == 0)
+  if (is_search_name(symbol->step_name, symbol))
       return symbol;
   return NULL;
 }
@@ -557,7 +608,7 @@ void *search_var_instance_decl_c::visit(initial_step_c *symbol) {
 /* STEP step_name ':' action_association_list END_STEP */
 // SYM_REF2(step_c, step_name, action_association_list)
 void *search_var_instance_decl_c::visit(step_c *symbol) {
-  if (compare_identifiers(symbol->step_name, search_name) == 0)
+  if (is_search_name(symbol->step_name, symbol))
       return symbol;
   return NULL;
 }
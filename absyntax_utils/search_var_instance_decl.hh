@@ -88,6 +88,10 @@
  */
 
 
+#include <map>
+#include <string>
+
+
 class search_var_instance_decl_c: public search_visitor_c {
 
   public:
@@ -135,9 +139,34 @@ class search_var_instance_decl_c: public search_visitor_c {
     vt_t      get_vartype       (symbol_c *variable_instance_name);
     opt_t     get_option        (symbol_c *variable_instance_name);
 
+    /* Forget the declarations found in 'search_scope' (or in all the scopes, if NULL).
+     * Must be called by any code that adds or removes variable declarations after
+     * they have been searched for (e.g. remove_unused_code_c).
+     */
+    static void invalidate_declaration_index(symbol_c *search_scope = NULL);
+
+  private:
+    /* The result of searching for a variable in a scope. */
+    typedef struct {
+      symbol_c *decl;
+      vt_t      vartype;
+      opt_t     option;
+    } decl_info_t;
+
+    /* The variables declared in each scope (POU, configuration, resource, ...), indexed by
+     * their (upper case) name. The index of a scope is built the first time a variable is
+     * searched for in that scope, and is shared by all the instances of this class, since
+     * they are usually short lived (one per POU, per statement, ...).
+     */
+    typedef std::map<std::string, decl_info_t> scope_index_t;
+    static std::map<symbol_c *, scope_index_t> declaration_index;
+
+    decl_info_t search(symbol_c *variable_instance_name);
+    bool is_search_name(symbol_c *name, symbol_c *decl);
+
   private:
     symbol_c *search_scope;
-    symbol_c *search_name;
+    scope_index_t *current_index;  /* the index being built */
     symbol_c *current_type_decl;
     /* variable used to store the type of variable currently being processed... */
     /* Will contain a single value of generate_c_vardecl_c::XXXX_vt */
@@ -0,0 +1,778 @@
+/*
+ *  matiec - a compiler for the programming languages defined in IEC 61131-3
+ *
+ *  Copyright (C) 2014  Mario de Sousa (msousa@fe.up.pt)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+/*
+ * An IEC 61131-3 compiler.
+ *
+ * Based on the
+ * FINAL DRAFT - IEC 61131-3, 2nd Ed. (2001-12-10)
+ *
+ */
+
+/*
+ *  Save an AST to a (compact, binary) file, and load it back again.
+ *  Please read the comments in serialize_ast.hh for more details.
+ */
+
+#include "serialize_ast.hh"
+
+#include "../main.hh" // required for ERROR() and ERROR_MSG() macros.
+
+#include <stdio.h>
+#include <string.h>  // required for strlen(), strdup(), memcpy()
+#include <errno.h>
+#include <string>
+#include <vector>
+#include <map>
+
+
+
+/* Must be incremented whenever the format of the file changes, or the class specific
+ * annotations (i.e. the members declared in the __VA_ARGS__ of absyntax.def) change.
+ */
+static const unsigned int serialize_ast_version = 2;
+static const char         serialize_ast_magic[] = "MATIECAST";
+
+
+
+/* The id of each class of absyntax.def (i.e. its position in absyntax.def) */
+#define SYM_LIST(class_name_c, ...)                                             class_name_c##_sid,
+#define SYM_TOKEN(class_name_c, ...)                                            class_name_c##_sid,
+#define SYM_REF0(class_name_c, ...)                                             class_name_c##_sid,
+#define SYM_REF1(class_name_c, ref1, ...)                                       class_name_c##_sid,
+#define SYM_REF2(class_name_c, ref1, ref2, ...)                                 class_name_c##_sid,
+#define SYM_REF3(class_name_c, ref1, ref2, ref3, ...)                           class_name_c##_sid,
+#define SYM_REF4(class_name_c, ref1, ref2, ref3, ref4, ...)                     class_name_c##_sid,
+#define SYM_REF5(class_name_c, ref1, ref2, ref3, ref4, ref5, ...)               class_name_c##_sid,
+#define SYM_REF6(class_name_c, ref1, ref2, ref3, ref4, ref5, ref6, ...)         class_name_c##_sid,
+
+typedef enum {
+  #include "../absyntax/absyntax.def"
+  symbol_class_count
+} symbol_class_t;
+
+#undef SYM_LIST
+#undef SYM_TOKEN
+#undef SYM_REF0
+#undef SYM_REF1
+#undef SYM_REF2
+#undef SYM_REF3
+#undef SYM_REF4
+#undef SYM_REF5
+#undef SYM_REF6
+
+
+
+/* The name of each class of absyntax.def, and of its refX members. Used to compute the fingerprint. */
+#define SYM_LIST(class_name_c, ...)                                             #class_name_c " list",
+#define SYM_TOKEN(class_name_c, ...)                                            #class_name_c " token",
+#define SYM_REF0(class_name_c, ...)                                             #class_name_c,
+#define SYM_REF1(class_name_c, ref1, ...)                                       #class_name_c " " #ref1,
+#define SYM_REF2(class_name_c, ref1, ref2, ...)                                 #class_name_c " " #ref1 " " #ref2,
+#define SYM_REF3(class_name_c, ref1, ref2, ref3, ...)                           #class_name_c " " #ref1 " " #ref2 " " #ref3,
+#define SYM_REF4(class_name_c, ref1, ref2, ref3, ref4, ...)                     #class_name_c " " #ref1 " " #ref2 " " #ref3 " " #ref4,
+#define SYM_REF5(class_name_c, ref1, ref2, ref3, ref4, ref5, ...)               #class_name_c " " #ref1 " " #ref2 " " #ref3 " " #ref4 " " #ref5,
+#define SYM_REF6(class_name_c, ref1, ref2, ref3, ref4, ref5, ref6, ...)         #class_name_c " " #ref1 " " #ref2 " " #ref3 " " #ref4 " " #ref5 " " #ref6,
+
+static const char *symbol_class_description[] = {
+  #include "../absyntax/absyntax.def"
+  NULL
+};
+
+#undef SYM_LIST
+#undef SYM_TOKEN
+#undef SYM_REF0
+#undef SYM_REF1
+#undef SYM_REF2
+#undef SYM_REF3
+#undef SYM_REF4
+#undef SYM_REF5
+#undef SYM_REF6
+
+
+static uint64_t symbol_class_fingerprint(void) {
+  /* FNV-1a hash */
+  uint64_t hash = 14695981039346656037ULL;
+  for (int i = 0; symbol_class_description[i] != NULL; i++)
+    for (const char *c = symbol_class_description[i]; ; c++) {
+      hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+      if (*c == '\0') break;
+    }
+  return hash;
+}
+
+
+
+/* Create a new (empty) symbol of the given class */
+#define SYM_LIST(class_name_c, ...)                                             case class_name_c##_sid: return new class_name_c();
+#define SYM_TOKEN(class_name_c, ...)                                            case class_name_c##_sid: return new class_name_c(NULL);
+#define SYM_REF0(class_name_c, ...)                                             case class_name_c##_sid: return new class_name_c();
+#define SYM_REF1(class_name_c, ref1, ...)                                       case class_name_c##_sid: return new class_name_c();
+#define SYM_REF2(class_name_c, ref1, ref2, ...)                                 case class_name_c##_sid: return new class_name_c();
+#define SYM_REF3(class_name_c, ref1, ref2, ref3, ...)                           case class_name_c##_sid: return new class_name_c();
+#define SYM_REF4(class_name_c, ref1, ref2, ref3, ref4, ...)                     case class_name_c##_sid: return new class_name_c();
+#define SYM_REF5(class_name_c, ref1, ref2, ref3, ref4, ref5, ...)               case class_name_c##_sid: return new class_name_c();
+#define SYM_REF6(class_name_c, ref1, ref2, ref3, ref4, ref5, ref6, ...)         case class_name_c##_sid: return new class_name_c();
+
+static symbol_c *create_symbol(uint64_t class_id) {
+  switch (class_id) {
+    #include "../absyntax/absyntax.def"
+    default: return NULL;
+  }
+}
+
+#undef SYM_LIST
+#undef SYM_TOKEN
+#undef SYM_REF0
+#undef SYM_REF1
+#undef SYM_REF2
+#undef SYM_REF3
+#undef SYM_REF4
+#undef SYM_REF5
+#undef SYM_REF6
+
+
+
+/* The datatype objects shared by the whole compiler. These are never saved, and the references
+ * to them are saved as their position in this list.
+ * NOTE: New entries must only be added to the end of the list, or serialize_ast_version must be updated.
+ */
+static symbol_c *shared_symbols[] = {
+  &get_datatype_info_c::invalid_type_name,
+  &get_datatype_info_c::any_type_name,
+  &get_datatype_info_c::lreal_type_name,
+  &get_datatype_info_c::real_type_name,
+  &get_datatype_info_c::lint_type_name,
+  &get_datatype_info_c::dint_type_name,
+  &get_datatype_info_c::int_type_name,
+  &get_datatype_info_c::sint_type_name,
+  &get_datatype_info_c::ulint_type_name,
+  &get_datatype_info_c::udint_type_name,
+  &get_datatype_info_c::uint_type_name,
+  &get_datatype_info_c::usint_type_name,
+  &get_datatype_info_c::lword_type_name,
+  &get_datatype_info_c::dword_type_name,
+  &get_datatype_info_c::word_type_name,
+  &get_datatype_info_c::byte_type_name,
+  &get_datatype_info_c::bool_type_name,
+  &get_datatype_info_c::wstring_type_name,
+  &get_datatype_info_c::string_type_name,
+  &get_datatype_info_c::dt_type_name,
+  &get_datatype_info_c::date_type_name,
+  &get_datatype_info_c::tod_type_name,
+  &get_datatype_info_c::time_type_name,
+  &get_datatype_info_c::safelreal_type_name,
+  &get_datatype_info_c::safereal_type_name,
+  &get_datatype_info_c::safelint_type_name,
+  &get_datatype_info_c::safedint_type_name,
+  &get_datatype_info_c::safeint_type_name,
+  &get_datatype_info_c::safesint_type_name,
+  &get_datatype_info_c::safeulint_type_name,
+  &get_datatype_info_c::safeudint_type_name,
+  &get_datatype_info_c::safeuint_type_name,
+  &get_datatype_info_c::safeusint_type_name,
+  &get_datatype_info_c::safelword_type_name,
+  &get_datatype_info_c::safedword_type_name,
+  &get_datatype_info_c::safeword_type_name,
+  &get_datatype_info_c::safebyte_type_name,
+  &get_datatype_info_c::safebool_type_name,
+  &get_datatype_info_c::safewstring_type_name,
+  &get_datatype_info_c::safestring_type_name,
+  &get_datatype_info_c::safedt_type_name,
+  &get_datatype_info_c::safedate_type_name,
+  &get_datatype_info_c::safetod_type_name,
+  &get_datatype_info_c::safetime_type_name,
+  NULL
+};
+
+
+
+
+/* The class that does the real work.
+ *
+ * Saving and loading the contents of each symbol is done by the same code (the xfer_XXX() methods),
+ * which either writes the value to the output, or reads the value from the input, depending on the
+ * current mode. This guarantees that the contents are always read in the same order they were written.
+ *
+ * Saving is done in two steps:
+ *   - collect_mode: find all the symbols reachable from the root, and all the strings they use.
+ *   - save_mode:    write the contents of each symbol.
+ * Loading is also done in two steps:
+ *   - create all the symbols (empty), as their classes are stored at the start of the file.
+ *   - load_mode:    read the contents of each symbol.
+ */
+class ast_archive_c: public null_visitor_c {
+  public:
+    typedef enum {collect_mode, save_mode, load_mode} mode_t;
+
+  private:
+    mode_t mode;
+    int    class_id;     /* the class of the last visited symbol */
+    bool   annotations;  /* save/load the annotations too, or only the syntax tree? */
+
+    /* used in collect_mode and save_mode */
+    std::vector<int>                  symbol_class;  /* the class of each symbol in symbols */
+    std::map<symbol_c *, uint64_t>    symbol_index;
+    std::map<symbol_c *, uint64_t>    shared_index;
+    std::map<std::string, uint64_t>   string_index;
+    std::vector<std::string>          string_list;
+    std::string                       output;
+
+    /* used in load_mode */
+    std::vector<const char *>         strings;
+    const unsigned char              *input;
+    const unsigned char              *input_end;
+    bool                              input_error;
+
+  public:
+    std::vector<symbol_c *>           symbols;  /* all the symbols, in the order in which they are saved */
+
+  public:
+    ast_archive_c(void) {
+      input = input_end = NULL;
+      input_error = false;
+      annotations = true;
+      for (uint64_t i = 0; shared_symbols[i] != NULL; i++)
+        shared_index[shared_symbols[i]] = i;
+    }
+
+
+    /*************************************/
+    /* Saving and loading a complete AST */
+    /*************************************/
+    const std::string &save(symbol_c *tree_root, bool annotations_) {
+      /* find all the symbols... */
+      mode = collect_mode;
+      annotations = annotations_;
+      xfer_symbol(tree_root);
+      for (size_t i = 0; i < symbols.size(); i++) {  // NOTE: symbols.size() grows while we iterate!
+        symbols[i]->accept(*this);
+        symbol_class.push_back(class_id);
+      }
+
+      /* ...and write them out. */
+      output.clear();
+      mode = save_mode;
+      for (const char *c = serialize_ast_magic; *c != '\0'; c++) output.push_back(*c);
+      put_unsigned(serialize_ast_version);
+      put_unsigned(symbol_class_fingerprint());
+      put_unsigned(annotations);
+
+      put_unsigned(string_list.size());
+      for (size_t i = 0; i < string_list.size(); i++) {
+        put_unsigned(string_list[i].size());
+        output.append(string_list[i]);
+      }
+
+      put_unsigned(symbols.size());
+      for (size_t i = 0; i < symbols.size(); i++)
+        put_unsigned(symbol_class[i]);
+      /* the root... */
+      xfer_symbol(tree_root);
+      /* ...and the contents of each symbol */
+      output.reserve(output.size() + 16 * symbols.size());
+      for (size_t i = 0; i < symbols.size(); i++)
+        symbols[i]->accept(*this);
+
+      return output;
+    }
+
+
+    /* returns NULL if the data is not valid */
+    symbol_c *load(const unsigned char *data, size_t size) {
+      mode        = load_mode;
+      input       = data;
+      input_end   = data + size;
+      input_error = false;
+
+      size_t magic_len = strlen(serialize_ast_magic);
+      if ((size < magic_len) || (memcmp(data, serialize_ast_magic, magic_len) != 0))
+        return NULL;
+      input += magic_len;
+      if (get_unsigned() != serialize_ast_version)      return NULL;
+      if (get_unsigned() != symbol_class_fingerprint()) return NULL;
+      annotations = (get_unsigned() != 0);
+
+      uint64_t string_count = get_unsigned();
+      if (string_count > (uint64_t)(input_end - input)) return NULL;
+      for (uint64_t i = 0; (i < string_count) && !input_error; i++) {
+        uint64_t len = get_unsigned();
+        if (len > (uint64_t)(input_end - input)) return NULL;
+        char *str = (char *)malloc(len + 1);
+        if (NULL == str) ERROR_MSG("out of memory");
+        memcpy(str, input, len);
+        str[len] = '\0';
+        input += len;
+        strings.push_back(str);
+      }
+
+      uint64_t symbol_count = get_unsigned();
+      if (symbol_count > (uint64_t)(input_end - input)) return NULL;
+      for (uint64_t i = 0; (i < symbol_count) && !input_error; i++) {
+        symbol_c *symbol = create_symbol(get_unsigned());
+        if (NULL == symbol) return NULL;
+        symbols.push_back(symbol);
+      }
+
+      symbol_c *tree_root = NULL;
+      xfer_symbol(tree_root);
+      for (size_t i = 0; (i < symbols.size()) && !input_error; i++)
+        symbols[i]->accept(*this);
+
+      if (input_error || (input != input_end))
+        return NULL;
+      return tree_root;
+    }
+
+
+  private:
+    /*****************************/
+    /* Encoding of basic values  */
+    /*****************************/
+    void put_unsigned(uint64_t value) {
+      do {
+        unsigned char byte = value & 0x7F;
+        value >>= 7;
+        if (value != 0) byte |= 0x80;
+        output.push_back(byte);
+      } while (value != 0);
+    }
+
+    uint64_t get_unsigned(void) {
+      uint64_t value = 0;
+      for (int shift = 0; shift < 64; shift += 7) {
+        if (input >= input_end) {input_error = true; return 0;}
+        unsigned char byte = *(input++);
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return value;
+      }
+      input_error = true;
+      return 0;
+    }
+
+    void xfer_unsigned(uint64_t &value) {
+      if      (mode == save_mode) put_unsigned(value);
+      else if (mode == load_mode) value = get_unsigned();
+    }
+
+    /* zig-zag encoding, so small negative values also take up few bytes */
+    void xfer_signed(int64_t &value) {
+      uint64_t encoded = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+      xfer_unsigned(encoded);
+      if (mode == load_mode) value = (int64_t)(encoded >> 1) ^ -(int64_t)(encoded & 1);
+    }
+
+    void xfer_real(real64_t &value) {
+      uint64_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      xfer_unsigned(bits);
+      if (mode == load_mode) memcpy(&value, &bits, sizeof(bits));
+    }
+
+    void xfer(bool &value)                   {uint64_t v = value; xfer_unsigned(v); value = (v != 0);}
+    void xfer(int &value)                    {int64_t  v = value; xfer_signed(v);   value = v;}
+    void xfer(long int &value)               {int64_t  v = value; xfer_signed(v);   value = v;}
+    void xfer(unsigned long long int &value) {uint64_t v = value; xfer_unsigned(v); value = v;}
+
+    void xfer(const char *&value) {
+      uint64_t ref = 0;
+      if (mode == collect_mode) {
+        if ((NULL != value) && (string_index.find(value) == string_index.end())) {
+          string_index[value] = string_list.size();
+          string_list.push_back(value);
+        }
+        return;
+      }
+      if ((mode == save_mode) && (NULL != value))
+        ref = string_index[value] + 1;
+      xfer_unsigned(ref);
+      if (mode == load_mode) {
+        if (ref > strings.size()) {input_error = true; ref = 0;}
+        value = (0 == ref)? NULL : strings[ref - 1];
+      }
+    }
+
+
+    /*****************************/
+    /* References to symbols     */
+    /*****************************/
+    template<typename symbol_type> void xfer_symbol(symbol_type *&symbol) {
+      symbol_c *sym = symbol;
+      std::map<symbol_c *, uint64_t>::iterator iter;
+
+      switch (mode) {
+        case collect_mode:
+          if ((NULL == sym) || (shared_index.find(sym) != shared_index.end())) return;
+          if (symbol_index.find(sym) != symbol_index.end()) return;
+          symbol_index[sym] = symbols.size();
+          symbols.push_back(sym);
+          return;
+
+        case save_mode: {
+          uint64_t ref = 0;
+          if (NULL != sym) {
+            if ((iter = shared_index.find(sym)) != shared_index.end()) ref = 2 * iter->second + 2;
+            else                                                       ref = 2 * symbol_index[sym] + 1;
+          }
+          put_unsigned(ref);
+          return;
+        }
+
+        case load_mode: {
+          uint64_t ref = get_unsigned();
+          sym = NULL;
+          if (0 != ref) {
+            uint64_t n = (ref - 1) / 2;
+            if      (((ref % 2) == 1) && (n < symbols.size()))                              sym = symbols[n];
+            else if (((ref % 2) == 0) && (n < sizeof(shared_symbols)/sizeof(symbol_c *) - 1)) sym = shared_symbols[n];
+            else    input_error = true;
+          }
+          symbol = dynamic_cast<symbol_type *>(sym);
+          if ((NULL != sym) && (NULL == symbol)) input_error = true;
+          return;
+        }
+      }
+    }
+
+    /* A refX member of a symbol. When only the syntax tree is loaded, the parent is not stored in the file,
+     * and is set here instead (the syntax tree is a tree, so each symbol is referenced by a single refX).
+     */
+    void xfer_ref(symbol_c *&ref, symbol_c *symbol) {
+      xfer_symbol(ref);
+      if ((mode == load_mode) && !annotations && (NULL != ref) && (shared_index.find(ref) == shared_index.end()))
+        ref->parent = symbol;
+    }
+
+    void xfer(std::vector<symbol_c *> &list) {
+      uint64_t count = list.size();
+      xfer_unsigned(count);
+      if (mode == load_mode) {
+        if (count > (uint64_t)(input_end - input)) {input_error = true; return;}
+        list.resize(count);
+      }
+      for (uint64_t i = 0; i < count; i++)
+        xfer_symbol(list[i]);
+    }
+
+    void xfer(std::vector<int> &list) {
+      uint64_t count = list.size();
+      xfer_unsigned(count);
+      if (mode == load_mode) {
+        if (count > (uint64_t)(input_end - input)) {input_error = true; return;}
+        list.resize(count);
+      }
+      for (uint64_t i = 0; i < count; i++)
+        xfer(list[i]);
+    }
+
+    void xfer(symbol_c::enumvalue_symtable_t &symtable) {
+      uint64_t count = symtable.size();
+      xfer_unsigned(count);
+      if (mode != load_mode) {
+        for (symbol_c::enumvalue_symtable_t::iterator iter = symtable.begin(); iter != symtable.end(); iter++) {
+          const char *name  = iter->first.c_str();
+          symbol_c   *value = iter->second;
+          xfer(name);
+          xfer_symbol(value);
+        }
+        return;
+      }
+      if (count > (uint64_t)(input_end - input)) {input_error = true; return;}
+      for (uint64_t i = 0; i < count; i++) {
+        const char *name  = NULL;
+        symbol_c   *value = NULL;
+        xfer(name);
+        xfer_symbol(value);
+        if (NULL == name) {input_error = true; return;}
+        symtable.insert(std::pair<std::string, symbol_c *>(name, value));
+      }
+    }
+
+
+    /*****************************/
+    /* Constant folding results  */
+    /*****************************/
+    void xfer_value(int64_t  &value) {xfer_signed(value);}
+    void xfer_value(uint64_t &value) {xfer_unsigned(value);}
+    void xfer_value(real64_t &value) {xfer_real(value);}
+    void xfer_value(bool     &value) {xfer(value);}
+
+    template<typename value_type> void xfer(const_value_c::const_value__<value_type> &const_value) {
+      typedef enum {undefined_cv, const_cv, overflow_cv, nonconst_cv} status_t;
+      uint64_t   status = const_value.is_valid()   ? const_cv
+                        : const_value.is_overflow()? overflow_cv
+                        : const_value.is_nonconst()? nonconst_cv
+                        :                            undefined_cv;
+      value_type value  = (status == const_cv)? const_value.get() : 0;
+
+      xfer_unsigned(status);
+      if (status == const_cv) xfer_value(value);
+      if (mode != load_mode)  return;
+      switch (status) {
+        case undefined_cv:                                   break;
+        case const_cv:     const_value.set(value);           break;
+        case overflow_cv:  const_value.set_overflow();       break;
+        case nonconst_cv:  const_value.set_nonconst();       break;
+        default:           input_error = true;               break;
+      }
+    }
+
+
+    /*****************************/
+    /* Contents of symbols       */
+    /*****************************/
+    /* The members common to all symbols */
+    void xfer_common(symbol_c *symbol) {
+      if (annotations) xfer_symbol(symbol->parent);
+      xfer_symbol(symbol->token);
+      xfer(symbol->first_line);
+      xfer(symbol->first_column);
+      xfer(symbol->first_file);
+      xfer(symbol->first_order);
+      xfer(symbol->last_line);
+      xfer(symbol->last_column);
+      xfer(symbol->last_file);
+      xfer(symbol->last_order);
+      if (!annotations) return;
+      /* stage 3 annotations */
+      xfer(symbol->candidate_datatypes);
+      xfer_symbol(symbol->datatype);
+      xfer_symbol(symbol->scope);
+      xfer(symbol->const_value._int64);
+      xfer(symbol->const_value._uint64);
+      xfer(symbol->const_value._real64);
+      xfer(symbol->const_value._bool);
+    }
+
+    /* The elements of a list */
+    void xfer_list(list_c *list) {
+      uint64_t count = list->n;
+      xfer_unsigned(count);
+      if ((mode == load_mode) && (count > (uint64_t)(input_end - input))) {input_error = true; return;}
+      for (uint64_t i = 0; i < count; i++) {
+        symbol_c   *element     = (mode == load_mode)? NULL : list->get_element(i);
+        const char *token_value = (mode == load_mode)? NULL : list->get_element_token_value(i);
+        xfer_symbol(element);
+        xfer(token_value);
+        if ((mode == load_mode) && !input_error) {
+          /* add_element() may change the parent of the element, which is however loaded separately
+           * (unless only the syntax tree is being loaded, in which case add_element() sets the parent)
+           */
+          symbol_c *parent = (NULL == element)? NULL : element->parent;
+          list->add_element(element, token_value);
+          if ((NULL != element) && annotations) element->parent = parent;
+        }
+      }
+    }
+
+    /* The class specific annotations (i.e. the members declared in the __VA_ARGS__ of absyntax.def).
+     * The compiler chooses the most specific of the following methods for each class, which for
+     * most classes is the first one (that does nothing).
+     */
+    void xfer_extras(symbol_c *symbol) {}
+
+    void xfer_extras(library_c                   *symbol) {xfer(symbol->enumvalue_symtable);}
+    void xfer_extras(function_declaration_c      *symbol) {xfer(symbol->enumvalue_symtable);}
+    void xfer_extras(function_block_declaration_c*symbol) {xfer(symbol->enumvalue_symtable);}
+    void xfer_extras(program_declaration_c       *symbol) {xfer(symbol->enumvalue_symtable);}
+    void xfer_extras(configuration_declaration_c *symbol) {xfer(symbol->enumvalue_symtable);}
+    void xfer_extras(resource_declaration_c      *symbol) {xfer(symbol->enumvalue_symtable);}
+
+    void xfer_extras(subrange_c                  *symbol) {xfer(symbol->dimension);}
+    void xfer_extras(subscript_list_c            *symbol) {xfer(symbol->range_proof);}
+
+    void xfer_extras(il_instruction_c            *symbol) {xfer(symbol->prev_il_instruction); xfer(symbol->next_il_instruction);}
+    void xfer_extras(il_simple_instruction_c     *symbol) {xfer(symbol->prev_il_instruction); xfer(symbol->next_il_instruction);}
+
+    template<typename function_call_type> void xfer_function_call(function_call_type *symbol) {
+      xfer_symbol(symbol->called_function_declaration);
+      xfer(symbol->extensible_param_count);
+      xfer(symbol->candidate_functions);
+    }
+    void xfer_extras(il_function_call_c          *symbol) {xfer_function_call(symbol);}
+    void xfer_extras(il_formal_funct_call_c      *symbol) {xfer_function_call(symbol);}
+    void xfer_extras(function_invocation_c       *symbol) {xfer_function_call(symbol);}
+
+    void xfer_extras(il_fb_call_c                *symbol) {xfer_symbol(symbol->called_fb_declaration);}
+    void xfer_extras(fb_invocation_c             *symbol) {xfer_symbol(symbol->called_fb_declaration);}
+    void xfer_extras(S_operator_c                *symbol) {xfer_symbol(symbol->called_fb_declaration);}
+    void xfer_extras(R_operator_c                *symbol) {xfer_symbol(symbol->called_fb_declaration);}
+    void xfer_extras(S1_operator_c               *symbol) {xfer_symbol(symbol->called_fb_declaration);}
+    void xfer_extras(R1_operator_c               *symbol) {xfer_symbol(symbol->called_fb_declaration);}
+    void xfer_extras(CLK_operator_c              *symbol) {xfer_symbol(symbol->called_fb_declaration);}
+    void xfer_extras(CU_operator_c               *symbol) {xfer_symbol(symbol->called_fb_declaration);}
+    void xfer_extras(CD_operator_c               *symbol) {xfer_symbol(symbol->called_fb_declaration);}
+    void xfer_extras(PV_operator_c               *symbol) {xfer_symbol(symbol->called_fb_declaration);}
+    void xfer_extras(IN_operator_c               *symbol) {xfer_symbol(symbol->called_fb_declaration);}
+    void xfer_extras(PT_operator_c               *symbol) {xfer_symbol(symbol->called_fb_declaration);}
+
+    void xfer_extras(ADD_operator_c              *symbol) {xfer(symbol->deprecated_operation);}
+    void xfer_extras(SUB_operator_c              *symbol) {xfer(symbol->deprecated_operation);}
+    void xfer_extras(MUL_operator_c              *symbol) {xfer(symbol->deprecated_operation);}
+    void xfer_extras(DIV_operator_c              *symbol) {xfer(symbol->deprecated_operation);}
+    void xfer_extras(add_expression_c            *symbol) {xfer(symbol->deprecated_operation);}
+    void xfer_extras(sub_expression_c            *symbol) {xfer(symbol->deprecated_operation);}
+    void xfer_extras(mul_expression_c            *symbol) {xfer(symbol->deprecated_operation);}
+    void xfer_extras(div_expression_c            *symbol) {xfer(symbol->deprecated_operation);}
+
+
+    /*****************************/
+    /* The visitor methods       */
+    /*****************************/
+    /* NOTE: The refX members are handled before the members common to all symbols, as
+     *       list_c::add_element() changes the location of the list (when loading).
+     */
+    #define SYM_LIST(class_name_c, ...)                                                         \
+    void *visit(class_name_c *symbol) {                                                         \
+      class_id = class_name_c##_sid;                                                            \
+      if (annotations) xfer_extras(symbol);                                                     \
+      xfer_list(symbol); xfer_common(symbol);                                                   \
+      return NULL;                                                                              \
+    }
+    #define SYM_TOKEN(class_name_c, ...)                                                        \
+    void *visit(class_name_c *symbol) {                                                         \
+      class_id = class_name_c##_sid;                                                            \
+      xfer(symbol->value);                                                                      \
+      if (annotations) xfer_extras(symbol);                                                     \
+      xfer_common(symbol);                                                                      \
+      return NULL;                                                                              \
+    }
+    #define SYM_REF0(class_name_c, ...)                                                         \
+    void *visit(class_name_c *symbol) {                                                         \
+      class_id = class_name_c##_sid;                                                            \
+      if (annotations) xfer_extras(symbol);                                                     \
+      xfer_common(symbol);                                                                      \
+      return NULL;                                                                              \
+    }
+    #define SYM_REF1(class_name_c, ref1, ...)                                                   \
+    void *visit(class_name_c *symbol) {                                                         \
+      class_id = class_name_c##_sid;                                                            \
+      xfer_ref(symbol->ref1, symbol);                                                           \
+      if (annotations) xfer_extras(symbol);                                                     \
+      xfer_common(symbol);                                                                      \
+      return NULL;                                                                              \
+    }
+    #define SYM_REF2(class_name_c, ref1, ref2, ...)                                             \
+    void *visit(class_name_c *symbol) {                                                         \
+      class_id = class_name_c##_sid;                                                            \
+      xfer_ref(symbol->ref1, symbol); xfer_ref(symbol->ref2, symbol);                           \
+      if (annotations) xfer_extras(symbol);                                                     \
+      xfer_common(symbol);                                                                      \
+      return NULL;                                                                              \
+    }
+    #define SYM_REF3(class_name_c, ref1, ref2, ref3, ...)                                       \
+    void *visit(class_name_c *symbol) {                                                         \
+      class_id = class_name_c##_sid;                                                            \
+      xfer_ref(symbol->ref1, symbol); xfer_ref(symbol->ref2, symbol); xfer_ref(symbol->ref3, symbol); \
+      if (annotations) xfer_extras(symbol);                                                     \
+      xfer_common(symbol);                                                                      \
+      return NULL;                                                                              \
+    }
+    #define SYM_REF4(class_name_c, ref1, ref2, ref3, ref4, ...)                                 \
+    void *visit(class_name_c *symbol) {                                                         \
+      class_id = class_name_c##_sid;                                                            \
+      xfer_ref(symbol->ref1, symbol); xfer_ref(symbol->ref2, symbol); xfer_ref(symbol->ref3, symbol); \
+      xfer_ref(symbol->ref4, symbol);                                                           \
+      if (annotations) xfer_extras(symbol);                                                     \
+      xfer_common(symbol);                                                                      \
+      return NULL;                                                                              \
+    }
+    #define SYM_REF5(class_name_c, ref1, ref2, ref3, ref4, ref5, ...)                           \
+    void *visit(class_name_c *symbol) {                                                         \
+      class_id = class_name_c##_sid;                                                            \
+      xfer_ref(symbol->ref1, symbol); xfer_ref(symbol->ref2, symbol); xfer_ref(symbol->ref3, symbol); \
+      xfer_ref(symbol->ref4, symbol); xfer_ref(symbol->ref5, symbol);                           \
+      if (annotations) xfer_extras(symbol);                                                     \
+      xfer_common(symbol);                                                                      \
+      return NULL;                                                                              \
+    }
+    #define SYM_REF6(class_name_c, ref1, ref2, ref3, ref4, ref5, ref6, ...)                     \
+    void *visit(class_name_c *symbol) {                                                         \
+      class_id = class_name_c##_sid;                                                            \
+      xfer_ref(symbol->ref1, symbol); xfer_ref(symbol->ref2, symbol); xfer_ref(symbol->ref3, symbol); \
+      xfer_ref(symbol->ref4, symbol); xfer_ref(symbol->ref5, symbol); xfer_ref(symbol->ref6, symbol); \
+      if (annotations) xfer_extras(symbol);                                                     \
+      xfer_common(symbol);                                                                      \
+      return NULL;                                                                              \
+    }
+
+  public:
+    #include "../absyntax/absyntax.def"
+
+    #undef SYM_LIST
+    #undef SYM_TOKEN
+    #undef SYM_REF0
+    #undef SYM_REF1
+    #undef SYM_REF2
+    #undef SYM_REF3
+    #undef SYM_REF4
+    #undef SYM_REF5
+    #undef SYM_REF6
+};
+
+
+
+
+bool serialize_ast_c::save(symbol_c *tree_root, const char *filename, bool annotations) {
+  ast_archive_c archive;
+  const std::string &data = archive.save(tree_root, annotations);
+
+  FILE *file = fopen(filename, "wb");
+  if (NULL == file) {
+    fprintf(stderr, "Error opening file %s for writing: %s\n", filename, strerror(errno));
+    return false;
+  }
+  bool ok = (fwrite(data.data(), 1, data.size(), file) == data.size());
+  ok = (fclose(file) == 0) && ok;
+  if (!ok)
+    fprintf(stderr, "Error writing file %s: %s\n", filename, strerror(errno));
+  return ok;
+}
+
+
+
+symbol_c *serialize_ast_c::load(const char *filename) {
+  FILE *file = fopen(filename, "rb");
+  if (NULL == file) {
+    fprintf(stderr, "Error opening file %s: %s\n", filename, strerror(errno));
+    return NULL;
+  }
+
+  std::vector<unsigned char> data;
+  unsigned char buffer[65536];
+  size_t len;
+  while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    data.insert(data.end(), buffer, buffer + len);
+  bool read_error = ferror(file);
+  fclose(file);
+  if (read_error) {
+    fprintf(stderr, "Error reading file %s\n", filename);
+    return NULL;
+  }
+
+  ast_archive_c archive;
+  symbol_c *tree_root = data.empty()? NULL : archive.load(&data[0], data.size());
+  if (NULL == tree_root)
+    fprintf(stderr, "File %s is not a valid AST file, or was created by an incompatible version of the compiler.\n", filename);
+  return tree_root;
+}
@@ -0,0 +1,106 @@
+/*
+ *  matiec - a compiler for the programming languages defined in IEC 61131-3
+ *
+ *  Copyright (C) 2014  Mario de Sousa (msousa@fe.up.pt)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+/*
+ * An IEC 61131-3 compiler.
+ *
+ * Based on the
+ * FINAL DRAFT - IEC 61131-3, 2nd Ed. (2001-12-10)
+ *
+ */
+
+/*
+ *  Save an AST to a (compact, binary) file, and load it back again.
+ *
+ *  Every symbol reachable from the root of the AST is saved. This includes not only the
+ *  symbols referenced by the refX members of each symbol (i.e. the tree itself), but also the
+ *  symbols referenced by the annotations (parent, token, datatype, candidate_datatypes, scope,
+ *  called_function_declaration, the enumvalue_symtable, ...). The annotations themselves are
+ *  saved too, so that an AST saved after stage 3 may be loaded and handed directly to stage 4
+ *  (iec2c saves the checked AST with '-A <ast_file>', and generates its code with '-L <ast_file>').
+ *  The AST is therefore saved as a graph, and loading it back recreates exactly the same graph.
+ *
+ *  The datatype objects shared by the whole compiler (get_datatype_info_c::int_type_name, ...)
+ *  are not saved. References to these objects are saved as references to the shared objects, so
+ *  that once loaded they again point to the same objects.
+ *
+ *  Alternatively, only the syntax tree may be saved (i.e. the symbols referenced by the refX members
+ *  of each symbol, their tokens and their locations), without any annotations. The AST loaded back
+ *  is then the same as the one built by stage 1_2 (the parent of each symbol is set while loading),
+ *  and does not depend on any other symbol (e.g. the standard library, referenced by the datatype
+ *  annotations), so a sub-tree of the AST may also be saved this way.
+ *
+ *  The annotations of stage 4 (anotations_map) are not saved, as these depend on which stage 4 is used.
+ *
+ *  File format
+ *  -----------
+ *  All integers are stored as variable length (LEB128) integers. Signed integers are first
+ *  zig-zag encoded, and real values are stored as the 64 bits of their IEEE 754 representation.
+ *  References to symbols are stored as 0 (NULL), 2*n+1 (the n'th symbol saved in the file), or
+ *  2*n+2 (the n'th datatype object shared by the whole compiler).
+ *
+ *    "MATIECAST"  file identification
+ *    version      the version of the file format (i.e. of this code)
+ *    fingerprint  a hash of the names of the classes (and their refX members) in absyntax.def
+ *    annotations  1 if the annotations were saved, 0 if only the syntax tree was saved
+ *    strings      the number of strings, followed by each string (length and chars).
+ *                 All strings (token values, file names, ...) are stored only once, and
+ *                 are referenced by their position in this list.
+ *    symbols      the number of symbols, followed by the class of each symbol
+ *                 (its position in absyntax.def)
+ *    ...          the contents of each symbol (refX members, class specific annotations,
+ *                 elements of lists, and finally the members common to all symbols)
+ *
+ *  Whenever absyntax.def changes (classes or refX members are added, removed or reordered)
+ *  the fingerprint also changes, and the files saved with the older version will no longer be
+ *  loaded. The class specific annotations (i.e. the members declared in the __VA_ARGS__ of the
+ *  absyntax.def entries) are not covered by the fingerprint, so whenever these change the
+ *  serialize_ast_version must be updated by hand.
+ */
+
+#ifndef _SERIALIZE_AST_HH
+#define _SERIALIZE_AST_HH
+
+#include "absyntax_utils.hh"
+
+
+class serialize_ast_c {
+  private: // this is a purely static class. No need for constructors!
+     serialize_ast_c(void) {};
+    ~serialize_ast_c(void) {};
+
+  public:
+    /* Save the AST (i.e. everything reachable from tree_root) to the file.
+     * If annotations is false, only the syntax tree below tree_root is saved.
+     * Returns false (after printing an error message) if the file could not be written.
+     */
+    static bool      save(symbol_c *tree_root, const char *filename, bool annotations = true);
+    /* Load an AST previously saved with save().
+     * Returns NULL (after printing an error message) if the file could not be read, or was not
+     * saved by a compatible version of the compiler.
+     */
+    static symbol_c *load(const char *filename);
+};
+
+
+#endif /* _SERIALIZE_AST_HH */
@@ -1,136 +1,290 @@
-#ifndef __ACCESSOR_H
-#define __ACCESSOR_H
-
-#define __INITIAL_VALUE(...) __VA_ARGS__
-
-// variable declaration macros
-#define __DECLARE_VAR(type, name)\
-	__IEC_##type##_t name;
-#define __DECLARE_GLOBAL(type, domain, name)\
-	__IEC_##type##_t domain##__##name;\
-	static __IEC_##type##_t *GLOBAL__##name = &(domain##__##name);\
-	void __INIT_GLOBAL_##name(type value) {\
-		(*GLOBAL__##name).value = value;\
-	}\
-	IEC_BYTE __IS_GLOBAL_##name##_FORCED(void) {\
-		return (*GLOBAL__##name).flags & __IEC_FORCE_FLAG;\
-	}\
-	type* __GET_GLOBAL_##name(void) {\
-		return &((*GLOBAL__##name).value);\
-	}
-#define __DECLARE_GLOBAL_FB(type, domain, name)\
-	type domain##__##name;\
-	static type *GLOBAL__##name = &(domain##__##name);\
-	type* __GET_GLOBAL_##name(void) {\
-		return &(*GLOBAL__##name);\
-	}\
-	extern void type##_init__(type* data__, BOOL retain);
-#define __DECLARE_GLOBAL_LOCATION(type, location)\
-	extern type *location;
-#define __DECLARE_GLOBAL_LOCATED(type, resource, name)\
-	__IEC_##type##_p resource##__##name;\
-	static __IEC_##type##_p *GLOBAL__##name = &(resource##__##name);\
-	void __INIT_GLOBAL_##name(type value) {\
-		*((*GLOBAL__##name).value) = value;\
-	}\
-	IEC_BYTE __IS_GLOBAL_##name##_FORCED(void) {\
-		return (*GLOBAL__##name).flags & __IEC_FORCE_FLAG;\
-	}\
-	type* __GET_GLOBAL_##name(void) {\
-		return (*GLOBAL__##name).value;\
-	}
-#define __DECLARE_GLOBAL_PROTOTYPE(type, name)\
-    extern type* __GET_GLOBAL_##name(void);
-#define __DECLARE_EXTERNAL(type, name)\
-	__IEC_##type##_p name;
-#define __DECLARE_EXTERNAL_FB(type, name)\
-	type* name;
-#define __DECLARE_LOCATED(type, name)\
-	__IEC_##type##_p name;
-
-
-// variable initialization macros
-#define __INIT_RETAIN(name, retained)\
-    name.flags |= retained?__IEC_RETAIN_FLAG:0;
-#define __INIT_VAR(name, initial, retained)\
-	name.value = initial;\
-	__INIT_RETAIN(name, retained)
-#define __INIT_GLOBAL(type, name, initial, retained)\
-    {\
-	    type temp = initial;\
-	    __INIT_GLOBAL_##name(temp);\
-	    __INIT_RETAIN((*GLOBAL__##name), retained)\
-    }
-#define __INIT_GLOBAL_FB(type, name, retained)\
-	type##_init__(&(*GLOBAL__##name), retained);
-#define __INIT_GLOBAL_LOCATED(domain, name, location, retained)\
-	domain##__##name.value = location;\
-	__INIT_RETAIN(domain##__##name, retained)
-#define __INIT_EXTERNAL(type, global, name, retained)\
-    {\
-		name.value = __GET_GLOBAL_##global();\
-		__INIT_RETAIN(name, retained)\
-    }
-#define __INIT_EXTERNAL_FB(type, global, name, retained)\
-	name = __GET_GLOBAL_##global();
-#define __INIT_LOCATED(type, location, name, retained)\
-	{\
-		extern type *location;\
-		name.value = location;\
-		__INIT_RETAIN(name, retained)\
-    }
-#define __INIT_LOCATED_VALUE(name, initial)\
-	*(name.value) = initial;
-
-
-// variable getting macros
-#define __GET_VAR(name, ...)\
-	name.value __VA_ARGS__
-#define __GET_EXTERNAL(name, ...)\
-	((name.flags & __IEC_FORCE_FLAG) ? name.fvalue __VA_ARGS__ : (*(name.value)) __VA_ARGS__)
-#define __GET_EXTERNAL_FB(name, ...)\
-	__GET_VAR(((*name) __VA_ARGS__))
-#define __GET_LOCATED(name, ...)\
-	((name.flags & __IEC_FORCE_FLAG) ? name.fvalue __VA_ARGS__ : (*(name.value)) __VA_ARGS__)
-
-#define __GET_VAR_BY_REF(name, ...)\
-	((name.flags & __IEC_FORCE_FLAG) ? &(name.fvalue __VA_ARGS__) : &(name.value __VA_ARGS__))
-#define __GET_EXTERNAL_BY_REF(name, ...)\
-	((name.flags & __IEC_FORCE_FLAG) ? &(name.fvalue __VA_ARGS__) : &((*(name.value)) __VA_ARGS__))
-#define __GET_EXTERNAL_FB_BY_REF(name, ...)\
-	__GET_EXTERNAL_BY_REF(((*name) __VA_ARGS__))
-#define __GET_LOCATED_BY_REF(name, ...)\
-	((name.flags & __IEC_FORCE_FLAG) ? &(name.fvalue __VA_ARGS__) : &((*(name.value)) __VA_ARGS__))
-
-#define __GET_VAR_REF(name, ...)\
-	(&(name.value __VA_ARGS__))
-#define __GET_EXTERNAL_REF(name, ...)\
-	(&((*(name.value)) __VA_ARGS__))
-#define __GET_EXTERNAL_FB_REF(name, ...)\
-	(&(__GET_VAR(((*name) __VA_ARGS__))))
-#define __GET_LOCATED_REF(name, ...)\
-	(&((*(name.value)) __VA_ARGS__))
-
-#define __GET_VAR_DREF(name, ...)\
-	(*(name.value __VA_ARGS__))
-#define __GET_EXTERNAL_DREF(name, ...)\
-	(*((*(name.value)) __VA_ARGS__))
-#define __GET_EXTERNAL_FB_DREF(name, ...)\
-	(*(__GET_VAR(((*name) __VA_ARGS__))))
-#define __GET_LOCATED_DREF(name, ...)\
-	(*((*(name.value)) __VA_ARGS__))
-
-
-// variable setting macros
-#define __SET_VAR(prefix, name, suffix, new_value)\
-	if (!(prefix name.flags & __IEC_FORCE_FLAG)) prefix name.value suffix = new_value
-#define __SET_EXTERNAL(prefix, name, suffix, new_value)\
-	{extern IEC_BYTE __IS_GLOBAL_##name##_FORCED(void);\
-    if (!(prefix name.flags & __IEC_FORCE_FLAG || __IS_GLOBAL_##name##_FORCED()))\
-		(*(prefix name.value)) suffix = new_value;}
-#define __SET_EXTERNAL_FB(prefix, name, suffix, new_value)\
-	__SET_VAR((*(prefix name)), suffix, new_value)
-#define __SET_LOCATED(prefix, name, suffix, new_value)\
-	if (!(prefix name.flags & __IEC_FORCE_FLAG)) *(prefix name.value) suffix = new_value
-
-#endif //__ACCESSOR_H
+#ifndef __ACCESSOR_H
+#define __ACCESSOR_H
+
+#define __INITIAL_VALUE(...) __VA_ARGS__
+
+// storage class of the body of the small FBs inlined in the code calling them (iec2c -O f)
+#ifndef __INLINE_FB_BODY
+#ifdef __GNUC__
+#define __INLINE_FB_BODY static inline __attribute__((always_inline))
+#else
+#define __INLINE_FB_BODY static inline
+#endif
+#endif
+
+// runtime check of the array subscripts not proven to always be within the array limits (iec2c -O a)
+// The offset of the subscript from the lower limit of the dimension is clamped to the dimension,
+// i.e. out of range subscripts access the first or last element (like the values assigned to subrange
+// variables are clamped to the subrange). Define __ARRAY_INDEX before including this file to handle
+// out of range subscripts differently.
+#ifndef __ARRAY_INDEX
+static inline unsigned long long __array_index(long long offset, unsigned long long size) {
+  if (offset < 0) return 0;
+  if ((unsigned long long)offset >= size) return size - 1;
+  return offset;
+}
+#define __ARRAY_INDEX(offset, size) __array_index(offset, size)
+#endif
+
+// dirty tracking (card marking) used by the delta backup functions (iec2c -O d)
+// Every write done through the setter macros (and through the pointers handed
+// to functions for their output parameters) marks the cards (small, fixed size
+// chunks of memory) it touches as dirty. Cards are hashed into a fixed size table,
+// so two distinct cards may share an entry: this may only result in data that
+// did not change being included in a delta backup, never the opposite.
+#ifdef ENABLE_DIRTY_TRACKING
+#ifndef __DIRTY_CARD_SHIFT
+#define __DIRTY_CARD_SHIFT 6      /* 64 byte cards */
+#endif
+#ifndef __DIRTY_CARD_COUNT
+#define __DIRTY_CARD_COUNT 16384  /* must be a power of 2 */
+#endif
+extern unsigned char __dirty_cards[__DIRTY_CARD_COUNT];
+#define __DIRTY_CARD(addr) ((((unsigned long)(addr)) >> __DIRTY_CARD_SHIFT) & (__DIRTY_CARD_COUNT - 1))
+static inline void *__mark_dirty(void *ptr, unsigned long size) {
+	unsigned long card = ((unsigned long)ptr) >> __DIRTY_CARD_SHIFT;
+	unsigned long last = (((unsigned long)ptr) + size - 1) >> __DIRTY_CARD_SHIFT;
+	for (; card <= last; card++)
+		__dirty_cards[card & (__DIRTY_CARD_COUNT - 1)] = 1;
+	return ptr;
+}
+// mark the object pointed to by ptr as dirty, and return ptr (evaluated only once)
+#define __DIRTY_PTR(ptr) ((__typeof__(ptr))__mark_dirty((ptr), sizeof(*(ptr))))
+#define __MARK_DIRTY(first, last)\
+	do {__mark_dirty((void *)(first), (char *)((last) + 1) - (char *)(first));} while (0)
+#else
+#define __DIRTY_PTR(ptr) (ptr)
+#define __MARK_DIRTY(first, last) do {} while (0)
+#endif
+
+#if defined(ENABLE_RETAIN_IMAGE) || defined(ENABLE_SHARED_SNAPSHOT)
+/* entry of the tables describing the layout of the retain image and of the shared snapshot,
+ * i.e. the contiguous copies of the RETAIN variables (see config_retain_init__())
+ * and of all the variables (see config_snapshot_init__()) */
+typedef struct {
+	void *varptr;
+	unsigned long offset;
+	unsigned long size;
+	const char *type;
+	const char *name;
+} __image_entry_t;
+#define __IMAGE_ENTRY(name, type, path)\
+	{&(name.value), 0, sizeof(name.value), type, path},
+#define __IMAGE_TABLE_END\
+	{NULL, 0, 0, NULL, NULL}
+#endif
+
+// sparse SFC engine (iec2c -O s)
+// __active_step_list holds the steps that are active, or have been deactivated during the
+// current scan (i.e. X or prev_state set), and __active_action_list the actions that are
+// active, stored, or have a pending timed set/reset. All other steps and actions are idle,
+// and are not looked at.
+// Both the active steps list and the list of the transitions to test in the current scan are
+// kept sorted, so the steps and transitions are handled in the same order as when all of them
+// are looked at.
+#define __SFC_SORTED_INSERT(list, count, value)\
+	{UINT __j = (count)++;\
+	 while (__j > 0 && list[__j - 1] > (value)) {list[__j] = list[__j - 1]; __j--;}\
+	 list[__j] = (value);}
+#define __SFC_LIST_STEP(prefix, step)\
+	if (!(prefix __step_list[step].X.value) && !(prefix __step_list[step].prev_state))\
+		__SFC_SORTED_INSERT(prefix __active_step_list, prefix __nb_active_steps, step)
+#define __SFC_LIST_ACTION(prefix, action)\
+	if (!(prefix __action_listed[action])) {\
+		prefix __action_listed[action] = 1;\
+		prefix __active_action_list[prefix __nb_active_actions++] = action;}
+
+#ifdef ENABLE_SHARED_SNAPSHOT
+/* header of the shared memory block where the variables are published at the end of each scan,
+ * followed by the variables' values (see config_snapshot_publish__()), and by the description
+ * of their layout: an array of 'entries' __shared_snapshot_entry_t starting 'layout' bytes
+ * after the start of the block, followed by the names and types of the variables. */
+typedef struct {
+	unsigned long magic;
+	unsigned long version;   /* version of the layout */
+	unsigned long sequence;  /* seqlock: odd while the values are being written */
+	unsigned long size;      /* of the values following this header */
+	unsigned long entries;   /* number of variables */
+	unsigned long layout;    /* offset of the layout description */
+} __shared_snapshot_t;
+/* offsets of the value (in the values), and of the name and type (in the block) of a variable */
+typedef struct {
+	unsigned long offset;
+	unsigned long size;
+	unsigned long name;
+	unsigned long type;
+} __shared_snapshot_entry_t;
+#define __SHARED_SNAPSHOT_MAGIC 0x49454354UL
+#define __SHARED_SNAPSHOT_DATA(snapshot) ((char *)(snapshot) + sizeof(__shared_snapshot_t))
+#define __SHARED_SNAPSHOT_LAYOUT(snapshot) ((__shared_snapshot_entry_t *)((char *)(snapshot) + (snapshot)->layout))
+#define __SHARED_SNAPSHOT_STRING(snapshot, offset) ((const char *)(snapshot) + (offset))
+
+/* for the readers of the snapshot:
+ *    entry = __shared_snapshot_find(snapshot, "CONFIG0.RES1.INSTANCE0.COUNTER");
+ *    do {
+ *      sequence = __shared_snapshot_read_begin(snapshot);
+ *      ... read the values from __SHARED_SNAPSHOT_DATA(snapshot) + entry->offset ...
+ *    } while (__shared_snapshot_read_retry(snapshot, sequence));
+ *  The layout description does not change while the version stays the same.
+ */
+static inline unsigned long __shared_snapshot_read_begin(__shared_snapshot_t *snapshot) {
+	unsigned long sequence;
+	while ((sequence = __atomic_load_n(&snapshot->sequence, __ATOMIC_ACQUIRE)) & 1);
+	return sequence;
+}
+static inline int __shared_snapshot_read_retry(__shared_snapshot_t *snapshot, unsigned long sequence) {
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&snapshot->sequence, __ATOMIC_RELAXED) != sequence;
+}
+static inline __shared_snapshot_entry_t *__shared_snapshot_find(__shared_snapshot_t *snapshot, const char *name) {
+	unsigned long i;
+	if (snapshot->magic != __SHARED_SNAPSHOT_MAGIC) return NULL;
+	for (i = 0; i < snapshot->entries; i++)
+		if (strcmp(__SHARED_SNAPSHOT_STRING(snapshot, __SHARED_SNAPSHOT_LAYOUT(snapshot)[i].name), name) == 0)
+			return &__SHARED_SNAPSHOT_LAYOUT(snapshot)[i];
+	return NULL;
+}
+#endif
+
+// debug hooks: the debugger may force the value of any variable, so the accessor macros
+// must check the force flags. Compiling with DISABLE_DEBUG_HOOKS (iec2c -O n) removes these
+// checks, for production builds the debugger is never attached to.
+#ifdef DISABLE_DEBUG_HOOKS
+#define __IS_FORCED(var) 0
+#define __IS_GLOBAL_FORCED(name) 0
+#else
+#define __IS_FORCED(var) ((var).flags & __IEC_FORCE_FLAG)
+#define __IS_GLOBAL_FORCED(name) __IS_GLOBAL_##name##_FORCED()
+#endif
+
+// variable declaration macros
+#define __DECLARE_VAR(type, name)\
+	__IEC_##type##_t name;
+#define __DECLARE_GLOBAL(type, domain, name)\
+	__IEC_##type##_t domain##__##name;\
+	static __IEC_##type##_t *GLOBAL__##name = &(domain##__##name);\
+	void __INIT_GLOBAL_##name(type value) {\
+		(*GLOBAL__##name).value = value;\
+	}\
+	IEC_BYTE __IS_GLOBAL_##name##_FORCED(void) {\
+		return (*GLOBAL__##name).flags & __IEC_FORCE_FLAG;\
+	}\
+	type* __GET_GLOBAL_##name(void) {\
+		return &((*GLOBAL__##name).value);\
+	}
+#define __DECLARE_GLOBAL_FB(type, domain, name)\
+	type domain##__##name;\
+	static type *GLOBAL__##name = &(domain##__##name);\
+	type* __GET_GLOBAL_##name(void) {\
+		return &(*GLOBAL__##name);\
+	}\
+	extern void type##_init__(type* data__, BOOL retain);
+#define __DECLARE_GLOBAL_LOCATION(type, location)\
+	extern type *location;
+#define __DECLARE_GLOBAL_LOCATED(type, resource, name)\
+	__IEC_##type##_p resource##__##name;\
+	static __IEC_##type##_p *GLOBAL__##name = &(resource##__##name);\
+	void __INIT_GLOBAL_##name(type value) {\
+		*((*GLOBAL__##name).value) = value;\
+	}\
+	IEC_BYTE __IS_GLOBAL_##name##_FORCED(void) {\
+		return (*GLOBAL__##name).flags & __IEC_FORCE_FLAG;\
+	}\
+	type* __GET_GLOBAL_##name(void) {\
+		return (*GLOBAL__##name).value;\
+	}
+#define __DECLARE_GLOBAL_PROTOTYPE(type, name)\
+    extern type* __GET_GLOBAL_##name(void);
+#define __DECLARE_EXTERNAL(type, name)\
+	__IEC_##type##_p name;
+#define __DECLARE_EXTERNAL_FB(type, name)\
+	type* name;
+#define __DECLARE_LOCATED(type, name)\
+	__IEC_##type##_p name;
+
+
+// variable initialization macros
+#define __INIT_RETAIN(name, retained)\
+    name.flags |= retained?__IEC_RETAIN_FLAG:0;
+#define __INIT_VAR(name, initial, retained)\
+	name.value = initial;\
+	__INIT_RETAIN(name, retained)
+#define __INIT_GLOBAL(type, name, initial, retained)\
+    {\
+	    type temp = initial;\
+	    __INIT_GLOBAL_##name(temp);\
+	    __INIT_RETAIN((*GLOBAL__##name), retained)\
+    }
+#define __INIT_GLOBAL_FB(type, name, retained)\
+	type##_init__(&(*GLOBAL__##name), retained);
+#define __INIT_GLOBAL_LOCATED(domain, name, location, retained)\
+	domain##__##name.value = location;\
+	__INIT_RETAIN(domain##__##name, retained)
+#define __INIT_EXTERNAL(type, global, name, retained)\
+    {\
+		name.value = __GET_GLOBAL_##global();\
+		__INIT_RETAIN(name, retained)\
+    }
+#define __INIT_EXTERNAL_FB(type, global, name, retained)\
+	name = __GET_GLOBAL_##global();
+#define __INIT_LOCATED(type, location, name, retained)\
+	{\
+		extern type *location;\
+		name.value = location;\
+		__INIT_RETAIN(name, retained)\
+    }
+#define __INIT_LOCATED_VALUE(name, initial)\
+	*(name.value) = initial;
+
+
+// variable getting macros
+#define __GET_VAR(name, ...)\
+	name.value __VA_ARGS__
+#define __GET_EXTERNAL(name, ...)\
+	(__IS_FORCED(name) ? name.fvalue __VA_ARGS__ : (*(name.value)) __VA_ARGS__)
+#define __GET_EXTERNAL_FB(name, ...)\
+	__GET_VAR(((*name) __VA_ARGS__))
+#define __GET_LOCATED(name, ...)\
+	(__IS_FORCED(name) ? name.fvalue __VA_ARGS__ : (*(name.value)) __VA_ARGS__)
+
+#define __GET_VAR_BY_REF(name, ...)\
+	(__IS_FORCED(name) ? &(name.fvalue __VA_ARGS__) : __DIRTY_PTR(&(name.value __VA_ARGS__)))
+#define __GET_EXTERNAL_BY_REF(name, ...)\
+	(__IS_FORCED(name) ? &(name.fvalue __VA_ARGS__) : __DIRTY_PTR(&((*(name.value)) __VA_ARGS__)))
+#define __GET_EXTERNAL_FB_BY_REF(name, ...)\
+	__GET_EXTERNAL_BY_REF(((*name) __VA_ARGS__))
+#define __GET_LOCATED_BY_REF(name, ...)\
+	(__IS_FORCED(name) ? &(name.fvalue __VA_ARGS__) : __DIRTY_PTR(&((*(name.value)) __VA_ARGS__)))
+
+#define __GET_VAR_REF(name, ...)\
+	(&(name.value __VA_ARGS__))
+#define __GET_EXTERNAL_REF(name, ...)\
+	(&((*(name.value)) __VA_ARGS__))
+#define __GET_EXTERNAL_FB_REF(name, ...)\
+	(&(__GET_VAR(((*name) __VA_ARGS__))))
+#define __GET_LOCATED_REF(name, ...)\
+	(&((*(name.value)) __VA_ARGS__))
+
+#define __GET_VAR_DREF(name, ...)\
+	(*(name.value __VA_ARGS__))
+#define __GET_EXTERNAL_DREF(name, ...)\
+	(*((*(name.value)) __VA_ARGS__))
+#define __GET_EXTERNAL_FB_DREF(name, ...)\
+	(*(__GET_VAR(((*name) __VA_ARGS__))))
+#define __GET_LOCATED_DREF(name, ...)\
+	(*((*(name.value)) __VA_ARGS__))
+
+
+// variable setting macros
+#define __SET_VAR(prefix, name, suffix, new_value)\
+	if (!__IS_FORCED(prefix name)) *__DIRTY_PTR(&(prefix name.value suffix)) = new_value
+#define __SET_EXTERNAL(prefix, name, suffix, new_value)\
+	{extern IEC_BYTE __IS_GLOBAL_##name##_FORCED(void);\
+    if (!(__IS_FORCED(prefix name) || __IS_GLOBAL_FORCED(name)))\
+		*__DIRTY_PTR(&((*(prefix name.value)) suffix)) = new_value;}
+#define __SET_EXTERNAL_FB(prefix, name, suffix, new_value)\
+	__SET_VAR((*(prefix name)), suffix, new_value)
+#define __SET_LOCATED(prefix, name, suffix, new_value)\
+	if (!__IS_FORCED(prefix name)) *__DIRTY_PTR(&(*(prefix name.value) suffix)) = new_value
+
+#endif //__ACCESSOR_H
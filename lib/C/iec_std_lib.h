@@ -115,6 +115,9 @@ typedef struct {
 #define __LWORD_LITERAL(value) __literal(LWORD,value,__64b_sufix)
 
 
+/* The IL implicit variable of the C code generated by older versions of iec2c.
+ * (It is now mapped onto one C variable per data type, see generate_c_il.cc)
+ */
 typedef union __IL_DEFVAR_T {
     BOOL    BOOLvar;
 
@@ -148,6 +148,22 @@ typedef struct {
   TIME reset_remaining_time;  // time before reset will be requested
 } ACTION;
 
+/* Compact step and action types, used instead of STEP and ACTION (iec2c -O c option) in the
+ * charts that never use the time the steps have been active (stepname.T, L and D qualifiers),
+ * or the timed action qualifiers (SL, SD and DS), respectively. Their leading members are
+ * those of STEP and ACTION. */
+typedef struct {
+  __IEC_BOOL_t X;  // state;  --> current step state. 0 : inative, 1: active
+  BOOL prev_state; // previous step state. 0 : inative, 1: active
+} UNTIMED_STEP;
+
+typedef struct {
+  BOOL stored;  // action storing state. 0 : not stored, 1: stored
+  __IEC_BOOL_t state; // current action state. 0 : inative, 1: active
+  BOOL set;   // set have been requested (reset each time the body is evaluated)
+  BOOL reset; // reset have been requested (reset each time the body is evaluated)
+} UNTIMED_ACTION;
+
 /* Extra debug types for SFC */
 #define __ANY_SFC(DO) DO(STEP) DO(TRANSITION) DO(ACTION)
 
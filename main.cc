@@ -109,7 +109,8 @@ void error_exit(const char *file_name, int line_no, const char *errmsg, ...) {
 
 
 static void printusage(const char *cmd) {
-  printf("\nsyntax: %s [<options>] [-O <output_options>] [-I <include_directory>] [-T <target_directory>] <input_file>\n", cmd);
+  printf("\nsyntax: %s [<options>] [-O <output_options>] [-I <include_directory>] [-T <target_directory>] [-m <module_file>] [-M <module_file> ...] [-A <ast_file>] <input_file> [<input_file> ...]\n", cmd);
+  printf("       %s [-O <output_options>] [-T <target_directory>] -L <ast_file>\n", cmd);
   printf(" -h : show this help message\n");
   printf(" -v : print version number\n");  
   printf(" -f : display full token location on error messages\n");
@@ -125,6 +126,15 @@ static void printusage(const char *cmd) {
   printf(" -b : allow functions returning VOID                 (a non-standard extension!)\n");
   printf(" -e : disable generation of implicit EN and ENO parameters.\n");
   printf(" -c : create conversion functions for enumerated data types\n");
+  printf(" -u : remove the POUs, and the variables of Functions and FBs, that are never used (and list them)\n");
+  printf(" -S : print statistics of the semantic analysis (number of function declarations matched against function calls)\n");
+  printf(" -m : compile a library module, and save its interface to <module_file> (e.g. -m mylib.mod)\n");
+  printf("        generates mylib.c and mylib.h instead of POUS.c and POUS.h\n");
+  printf(" -M : import the library module saved in <module_file> (may be used more than once)\n");
+  printf("        mylib.c (generated when compiling the module) must be linked with the project\n");
+  printf(" -A : save the checked AST (i.e. after the semantic analysis) to <ast_file>\n");
+  printf(" -L : generate the code of the checked AST loaded from <ast_file>, instead of compiling input files\n");
+  printf("        the options of the semantic analysis used when saving <ast_file> apply\n");
   printf(" -O : options for output (code generation) stage. Available options for %s are...\n", cmd);
   runtime_options.allow_missing_var_in    = false; /* disable: allow definition and invocation of POUs with no input, output and in_out parameters! */
   stage4_print_options();
@@ -161,11 +171,22 @@ int main(int argc, char **argv) {
 
   /* Default values for the command line options... */
   runtime_options.relaxed_datatype_model    = false; /* by default use the strict datatype equivalence model */
+  runtime_options.remove_unused_code        = false; /* by default generate code for all POUs and variables */
+  runtime_options.print_statistics          = false; /* by default do not print any statistics */
+
+  /* Default values for the command line options... */
+  runtime_options.export_module             = NULL;  /* by default do not save the interface of the library */
+  runtime_options.import_modules            = new const char *[argc];  /* -M can not be used more than argc times */
+  runtime_options.import_module_count       = 0;     /* by default do not import any library modules */
+
+  /* Default values for the command line options... */
+  runtime_options.save_checked_ast          = NULL;  /* by default do not save the checked AST */
+  runtime_options.load_checked_ast          = NULL;  /* by default compile the input files */
   
   /******************************************/
   /*   Parse command line options...        */
   /******************************************/
-  while ((optres = getopt(argc, argv, ":nehvfplsrRabicI:T:O:")) != -1) {
+  while ((optres = getopt(argc, argv, ":nehvfplsrRabicuSI:T:O:m:M:A:L:")) != -1) {
     switch(optres) {
     case 'h':
       printusage(argv[0]);
@@ -186,6 +207,8 @@ int main(int argc, char **argv) {
     case 'c': runtime_options.conversion_functions     = true;  break;
     case 'n': runtime_options.nested_comments          = true;  break;
     case 'e': runtime_options.disable_implicit_en_eno  = true;  break;
+    case 'u': runtime_options.remove_unused_code       = true;  break;
+    case 'S': runtime_options.print_statistics         = true;  break;
     case 'I':
       /* NOTE: To improve the usability under windows:
        *       We delete last char's path if it ends with "\".
@@ -205,7 +228,19 @@ int main(int argc, char **argv) {
     case 'O':
       if (stage4_parse_options(optarg) < 0) errflg++;
       break;
-    case ':':       /* -I, -T, or -O without operand */
+    case 'm':
+      runtime_options.export_module = optarg;
+      break;
+    case 'M':
+      runtime_options.import_modules[runtime_options.import_module_count++] = optarg;
+      break;
+    case 'A':
+      runtime_options.save_checked_ast = optarg;
+      break;
+    case 'L':
+      runtime_options.load_checked_ast = optarg;
+      break;
+    case ':':       /* -I, -T, -O, -m, -M, -A or -L without operand */
       fprintf(stderr, "Option -%c requires an operand\n", optopt);
       errflg++;
       break;
@@ -220,13 +255,19 @@ int main(int argc, char **argv) {
     }
   }
 
-  if (optind == argc) {
+  if ((optind == argc) && (runtime_options.load_checked_ast == NULL)) {
     fprintf(stderr, "Missing input file\n");
     errflg++;
   }
 
-  if (optind > argc) {
-    fprintf(stderr, "Too many input files\n");
+  if ((optind != argc) && (runtime_options.load_checked_ast != NULL)) {
+    fprintf(stderr, "Input files may not be given together with option -L\n");
+    errflg++;
+  }
+
+  if (runtime_options.remove_unused_code && (runtime_options.export_module != NULL)) {
+    /* the POUs of a library module are used by code we do not see (the projects importing the module) */
+    fprintf(stderr, "Options -u and -m may not be used together\n");
     errflg++;
   }
 
@@ -239,24 +280,42 @@ int main(int argc, char **argv) {
   /***************************/
   /*   Run the compiler...   */
   /***************************/
-  /* 1st Pass */
-  if (stage1_2(argv[optind], &tree_root) < 0)
-    return EXIT_FAILURE;
-
-  /* 2nd Pass */
-    /* basically loads some symbol tables to speed up look ups later on */
-  absyntax_utils_init(tree_root);  
-    /* moved to bison, although it could perfectly well still be here instead of in bison code. */
-  //add_en_eno_param_decl_c::add_to(tree_root);
+  if (runtime_options.load_checked_ast != NULL) {
+    /* The AST was already checked (and annotated) by stage 3 when it was saved */
+    if ((tree_root = serialize_ast_c::load(runtime_options.load_checked_ast)) == NULL)
+      return EXIT_FAILURE;
+    absyntax_utils_init(tree_root);
+    ordered_tree_root = tree_root;
+  } else {
+    /* 1st Pass */
+    if (stage1_2(argc - optind, argv + optind, &tree_root) < 0)
+      return EXIT_FAILURE;
+
+    /* 2nd Pass */
+      /* basically loads some symbol tables to speed up look ups later on */
+    absyntax_utils_init(tree_root);  
+      /* moved to bison, although it could perfectly well still be here instead of in bison code. */
+    //add_en_eno_param_decl_c::add_to(tree_root);
+
+    /* Do semantic verification of code */
+    if (stage3(tree_root, &ordered_tree_root) < 0)
+      return EXIT_FAILURE;
+  }
 
-  /* Do semantic verification of code */
-  if (stage3(tree_root, &ordered_tree_root) < 0)
-    return EXIT_FAILURE;
+  /* Save the checked AST, so its code may later be generated without parsing and checking it again */
+  if (runtime_options.save_checked_ast != NULL)
+    if (!serialize_ast_c::save(ordered_tree_root, runtime_options.save_checked_ast))
+      return EXIT_FAILURE;
   
   /* 3rd Pass */
   if (stage4(ordered_tree_root, builddir) < 0)
     return EXIT_FAILURE;
 
+  /* Save the interface of the library module (the C code has just been generated by stage 4) */
+  if (runtime_options.export_module != NULL)
+    if (!library_module_c::save(tree_root, runtime_options.export_module))
+      return EXIT_FAILURE;
+
   /* 4th Pass */
   /* Call gcc, g++, or whatever... */
   /* Currently implemented in the Makefile! */
@@ -55,6 +55,17 @@ typedef struct {
 	
    /* options specific to stage3 */
 	bool relaxed_datatype_model;   /* Use the relaxed datatype equivalence model, instead of the default strict equivalence model */
+	bool remove_unused_code;       /* Remove the POUs and internal variables that are never used from the generated code */
+	bool print_statistics;         /* Print statistics of the semantic analysis on stderr (e.g. function declarations matched against function calls) */
+
+   /* options specific to library modules (see absyntax_utils/library_module.hh) */
+	const char  *export_module;    /* Save the interface of the library being compiled to this module file (NULL => do not save) */
+	const char **import_modules;   /* The module files to import before parsing the input files... */
+	int          import_module_count; /* ...and how many there are */
+
+   /* options specific to the checked AST files (see absyntax_utils/serialize_ast.hh) */
+	const char  *save_checked_ast; /* Save the AST (with the stage 3 annotations) to this file, before running stage 4 (NULL => do not save) */
+	const char  *load_checked_ast; /* Load the AST from this file, instead of running stages 1_2 and 3 on the input files (NULL => do not load) */
 } runtime_options_t;
 
 extern runtime_options_t runtime_options;
@@ -103,6 +103,7 @@ void yyerror (const char *error_msg);
 #include "create_enumtype_conversion_functions.hh"
 
 #include "../absyntax_utils/add_en_eno_param_decl.hh"	/* required for  add_en_eno_param_decl_c */
+#include "../absyntax_utils/library_module.hh"	/* required for  library_module_c */
 
 /* an ugly hack!!
  * We will probably not need it when we decide
@@ -8748,8 +8749,8 @@ NULL
 extern const char *INCLUDE_DIRECTORIES[];
 
 
-static int parse_files(const char *libfilename, const char *filename) {
-  /* first parse the standard library file... */  
+/* parse the standard library file... */
+static int parse_library_file(const char *libfilename) {
   /*   Do not debug the standard library, even if debug flag is set!
   #if YYDEBUG
     yydebug = 1;
@@ -8787,7 +8788,12 @@ static int parse_files(const char *libfilename, const char *filename) {
         library_element_symtable.end())
       library_element_symtable.insert(standard_function_block_names[i], standard_function_block_name_token);
 
-  /* now parse the input file... */
+  return 0;
+}
+
+
+/* parse the input file... */
+static int parse_main_file(const char *filename) {
   #if YYDEBUG
     yydebug = 1;
   #endif
@@ -8822,9 +8828,88 @@ static int parse_files(const char *libfilename, const char *filename) {
 
 
 
+/* add the name of a datatype or POU declared in a library module to the library_element_symtable,
+ * with the same token that would have been used had the module been parsed.
+ */
+static int import_module_name(symbol_c *name, int token, const char *filename) {
+  token_c *name_token = dynamic_cast<token_c *>(name);
+  if (NULL == name_token) ERROR;
+
+  library_element_symtable_t::iterator iter = library_element_symtable.find(name_token->value);
+  if ((iter != library_element_symtable.end()) && (iter->second != token)) {
+    fprintf (stderr, "\nError importing library module %s: %s has already been declared. Bailing out!\n", filename, name_token->value);
+    return -1;
+  }
+  library_element_symtable.insert(name_token->value, token);
+  return 0;
+}
+
+
+static int import_module_element(symbol_c *element, const char *filename) {
+  { function_declaration_c       *d = dynamic_cast<function_declaration_c       *>(element);
+    if (NULL != d) return import_module_name(d->derived_function_name, prev_declared_derived_function_name_token,       filename);}
+  { function_block_declaration_c *d = dynamic_cast<function_block_declaration_c *>(element);
+    if (NULL != d) return import_module_name(d->fblock_name,           prev_declared_derived_function_block_name_token, filename);}
+  { program_declaration_c        *d = dynamic_cast<program_declaration_c        *>(element);
+    if (NULL != d) return import_module_name(d->program_type_name,     prev_declared_program_type_name_token,           filename);}
+
+  data_type_declaration_c *data_type_declaration = dynamic_cast<data_type_declaration_c *>(element);
+  list_c *type_declaration_list = (NULL == data_type_declaration)? NULL : dynamic_cast<list_c *>(data_type_declaration->type_declaration_list);
+  if (NULL == type_declaration_list) ERROR;
+  for (int i = 0; i < type_declaration_list->n; i++) {
+    symbol_c *decl = type_declaration_list->get_element(i);
+    int res = 0;
+    #define IMPORT_TYPE_NAME(class_name_c, name, token) \
+      if (NULL != dynamic_cast<class_name_c *>(decl)) res = import_module_name(dynamic_cast<class_name_c *>(decl)->name, token, filename); else
+    IMPORT_TYPE_NAME(    simple_type_declaration_c,     simple_type_name, prev_declared_simple_type_name_token)
+    IMPORT_TYPE_NAME(  subrange_type_declaration_c,   subrange_type_name, prev_declared_subrange_type_name_token)
+    IMPORT_TYPE_NAME(enumerated_type_declaration_c, enumerated_type_name, prev_declared_enumerated_type_name_token)
+    IMPORT_TYPE_NAME(     array_type_declaration_c,           identifier, prev_declared_array_type_name_token)
+    IMPORT_TYPE_NAME( structure_type_declaration_c,  structure_type_name, prev_declared_structure_type_name_token)
+    IMPORT_TYPE_NAME(    string_type_declaration_c,     string_type_name, prev_declared_string_type_name_token)
+    IMPORT_TYPE_NAME(              ref_type_decl_c,        ref_type_name, prev_declared_ref_type_name_token)
+    ERROR;
+    #undef IMPORT_TYPE_NAME
+    if (res < 0) return res;
+  }
+  return 0;
+}
+
+
+/* import the interface of a library module (see absyntax_utils/library_module.hh) */
+static int import_module_file(const char *filename) {
+  library_c *module = library_module_c::load(filename);
+  if (NULL == module)
+    return -4;
+
+  /* The code of the module has already been generated when the module was compiled, so
+   * we add its library elements enclosed in {disable code generation} ... {enable code generation},
+   * just like the library elements of the standard library.
+   * The names of the datatypes and POUs are added to the library_element_symtable, so the
+   * module is used by the input files in exactly the same way as if it had been parsed.
+   */
+  if (tree_root == NULL)
+    tree_root = new library_c();
+  list_c *library = (list_c *)tree_root;
+  library->add_element(new disable_code_generation_pragma_c());
+  for (int i = 0; i < module->n; i++) {
+    symbol_c *element = module->get_element(i);
+    if (import_module_element(element, filename) < 0)
+      return -5;
+    element->parent = NULL;  /* so add_element() sets the parent to the library it is moved to */
+    library->add_element(element);
+  }
+  library->add_element(new enable_code_generation_pragma_c());
+  return 0;
+}
+
+
 
 
-/* We parse the input source code twice!!
+
+/* Forward references (i.e. using a POU or a datatype before it has been declared) are only
+ * allowed when pre-parsing has been requested in the command line. In this case we parse the
+ * input source code twice!!
  *  1st pass -->  Pre-parsing
  *  -------------------------
  *  The intention of the first pass is to fill up the library_element_symtable with the names of all
@@ -8835,7 +8920,7 @@ static int parse_files(const char *libfilename, const char *filename) {
  *  however are parsed normally!
  *
  *  At the end of the pre-parsing, the AST will contain only the derived datatype declarations,
- *  and this tree will be trown away (by simply resetting tree_root = NULL).
+ *  and this tree will be trown away (by simply resetting tree_root).
  *  More importantly, the library_element_symtable will contain the names of all the POUs and 
  *  derived datatypes.
  *
@@ -8851,9 +8936,32 @@ static int parse_files(const char *libfilename, const char *filename) {
  *
  *  Declaring variables of datatypes that have not yet been declared will also be possible, as the
  *  datatypes will also already be in the library_element_symtable!
- */
-
-int stage2__(const char *filename, 
+ *
+ * NOTE: Only the input files are pre-parsed. The standard library does not use forward references,
+ *       so it is parsed (normally) only once, before the input files are pre-parsed.
+ *       Each file is therefore fully parsed only once. The pre-parsing itself is cheap, as flex
+ *       skips over the POUs (which is where almost all the source code is) in large chunks.
+ *
+ * NOTE: It would be nice to do without the pre-parsing altogether, by delaying the classification
+ *       of the identifiers until they have all been declared. However, the token flex hands to bison
+ *       for a datatype name depends on the kind of datatype (prev_declared_structure_type_name_token,
+ *       prev_declared_array_type_name_token, ...), and it is this token that allows bison to choose
+ *       between the many grammar rules that would otherwise be ambiguous. A name-only scanner would
+ *       have to duplicate the grammar of the datatype declarations to find out the kind of each
+ *       datatype, which is exactly what the pre-parsing does.
+ *
+ * NOTE: Several input files may be given. These are all parsed into the same AST (i.e. the same library_c),
+ *       in the order they are given, as if they had been concatenated into a single file. When pre-parsing
+ *       is requested, all the input files are pre-parsed before any of them is parsed, so a POU
+ *       may also use the POUs and datatypes declared in any of the other files.
+ *       Note that the files are parsed one after the other, and not in parallel. Both flex and bison keep
+ *       their state in global variables (yylval, yylloc, the flex buffers, the include stack, the tracking
+ *       of the current line and column, the variable_name_symtable, ...), so several files can only be
+ *       parsed simultaneously once both the lexical and the syntax parsers have been made reentrant.
+ */
+
+int stage2__(int file_count,
+             const char * const *filenames,
              symbol_c **tree_root_ref
             ) {             
   char *libfilename = NULL;
@@ -8867,25 +8975,43 @@ int stage2__(const char *filename,
     exit(EXIT_FAILURE);
   }
 
+  /*************************************/
+  /* Parse the standard library...!    */
+  /*************************************/
+  tree_root = NULL;
+  rst_preparse_state();
+  if (parse_library_file(libfilename) < 0)
+    exit(EXIT_FAILURE);
+
+  /*************************************/
+  /* Import the library modules...!    */
+  /*************************************/
+  for (int i = 0; i < runtime_options.import_module_count; i++)
+    if (import_module_file(runtime_options.import_modules[i]) < 0)
+      exit(EXIT_FAILURE);
+
   /*******************************/
   /* Do the  PRE parsing run...! */
   /*******************************/
   if (runtime_options.pre_parsing) {
     // fprintf (stderr, "----> Starting pre-parsing!\n");
+    symbol_c *library_tree_root = tree_root;
     tree_root = NULL;
     set_preparse_state();
-    if (parse_files(libfilename, filename) < 0)
-      exit(EXIT_FAILURE);
+    for (int i = 0; i < file_count; i++)
+      if (parse_main_file(filenames[i]) < 0)
+        exit(EXIT_FAILURE);
     // TODO: delete the current AST. For the moment, we leave all the objects in memory (not much of an issue in a program that always runs to completion).
+    rst_preparse_state();
+    tree_root = library_tree_root;
   }
   /*******************************/
   /* Do the main parsing run...! */
   /*******************************/
   // fprintf (stderr, "----> Starting normal parsing!\n");
-  tree_root = NULL;
-  rst_preparse_state();
-  if (parse_files(libfilename, filename) < 0)
-    exit(EXIT_FAILURE);
+  for (int i = 0; i < file_count; i++)
+    if (parse_main_file(filenames[i]) < 0)
+      exit(EXIT_FAILURE);
   
 
   /* Final clean-up... */
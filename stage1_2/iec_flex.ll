@@ -67,14 +67,31 @@
  */
 %option case-insensitive
 
-/* Have the generated lexical analyser keep track of the
- * line number it is currently analysing.
- * This is used to pass up to the syntax parser
- * the number of the line on which the current
- * token was found. It will enable the syntax parser
- * to generate more informatve error messages...
+/* We do not ask flex to keep track of the line number it is
+ * currently analysing (%option yylineno), as this is already
+ * done by our own tracking functions (see UpdateTracking()),
+ * which also keep track of the column number, and handle
+ * the include files.
+ * The yylineno option would only make flex count the
+ * newlines of every token a second time!
  */
-%option yylineno
+
+/* Generate full (uncompressed) tables, i.e. a faster scanner at
+ * the expense of a larger one. Equivalence classes (ecs) keep
+ * the tables reasonably small.
+ * Note that full tables can not be used with flex's reject action
+ * (nor with variable trailing context), which is why the keywords
+ * that are only enabled by a command line option are handed back
+ * as identifiers with keyword_as_identifier() instead of being rejected.
+ * Meta equivalence classes are only used by compressed tables.
+ */
+%option full
+%option ecs
+%option nometa-ecs
+/* With full tables flex would generate a 7 bit scanner by default,
+ * but the input files may contain 8 bit characters (e.g. in comments).
+ */
+%option 8bit
 
 /* required for the use of the yy_pop_state() and
  * yy_push_state() functions
@@ -91,7 +108,9 @@
  */
 %option noyy_top_state
 
-/* We will be using unput() in our flex code, so we cannot set the following option!... */
+/* We will be using unput() in our flex code (in unput_and_mark() and unput_bodystate_buffer()),
+ * so we cannot set the following option!...
+ */
 /*
 %option nounput
 */
@@ -126,6 +145,20 @@
 /* Required for strdup() */
 #include <string.h>
 
+/* Required for the include stack, and the list of memory mapped files */
+#include <vector>
+#include <map>
+
+/* Input files are memory mapped (with mmap()) whenever the OS supports it. See scan_file_buffer(). */
+#ifndef __WIN32__
+#include <unistd.h>
+#endif
+#if defined(_POSIX_MAPPED_FILES) && (_POSIX_MAPPED_FILES > 0)
+#define MMAP_INPUT_FILES
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 /* Required only for the declaration of abstract syntax classes
  * (class symbol_c; class token_c; class list_c;)
  * These will not be used in flex, but the token type union defined
@@ -166,12 +199,11 @@ const char *current_filename = NULL;
 /*
  *extern YYLTYPE yylloc;
 b*/
-#define YY_INPUT(buf,result,max_size)  {\
-    result = GetNextChar(buf, max_size);\
-    if (  result <= 0  )\
-      result = YY_NULL;\
-    }
 
+/* NOTE: We do not define YY_INPUT, as flex never reads from the input files directly.
+ *       Each file is read into memory in a single go, and then scanned from there
+ *       (see scan_file_buffer() ).
+ */
 
 /* Macro that is executed for every action.
  * We use it to pass the location of the token
@@ -250,7 +282,15 @@ int  isempty_bodystate_buffer(void);
 void     del_bodystate_buffer(void);
 
 
-int GetNextChar(char *b, int maxBuffer);
+/* Keep only the first n chars of the current token, and return the remaining text to the input stream. */
+void shorten_token(int n);
+/* Number of chars in the identifier at the start of text. */
+int identifier_length(const char *text);
+/* Hand the first n chars of a keyword that has not been enabled back to bison as an identifier. */
+int keyword_as_identifier(int n);
+
+YY_BUFFER_STATE scan_file_buffer(FILE *filehandle);
+void delete_file_buffer(YY_BUFFER_STATE buffer);
 %}
 
 
@@ -566,14 +606,16 @@ typedef struct {
     int currentChar;
     int lineLength;
     int currentTokenStart;
-    FILE *in_file;
   } tracking_t;
 
 /* A forward declaration of a function defined at the end of this file. */
 void FreeTracking(tracking_t *tracking);
 
 
-#define MAX_INCLUDE_DEPTH 16
+/* The include stack grows as required, so this limit only serves to catch
+ * a file that (directly or indirectly) includes itself.
+ */
+#define MAX_INCLUDE_DEPTH 1024
 
 typedef struct {
 	  YY_BUFFER_STATE buffer_state;
@@ -583,8 +625,7 @@ typedef struct {
 
 tracking_t * current_tracking = NULL;
 tracking_t  previous_tracking;
-include_stack_t include_stack[MAX_INCLUDE_DEPTH];
-int include_stack_ptr = 0;
+std::vector<include_stack_t> include_stack;
 
 const char *INCLUDE_DIRECTORIES[] = {
 	DEFAULT_LIBDIR,
@@ -1045,14 +1086,14 @@ incompl_location	%[IQM]\*
 			       *       from the main input file, after we have reached the end. For this to work
 			       *       correctly, we cannot close the main input file!
 			       * 
-			       *       This is why we WILL be called with include_stack_ptr == 0 multiple times,
+			       *       This is why we WILL be called with an empty include_stack multiple times,
 			       *       and why we must handle it as a special case
-			       *       that leaves the include_stack_ptr unchanged, and returns END_OF_INPUT once again.
+			       *       that leaves the include_stack unchanged, and returns END_OF_INPUT once again.
 			       * 
 			       *       As a corollory, flex can never safely close the main input file, and we must ask
 			       *       bison to close it!
 			       */
-			  if (include_stack_ptr == 0) {
+			  if (include_stack.empty()) {
 			      // fclose(yyin);           // Must not do this!!
 			      // FreeTracking(current_tracking); // Must not do this!!
 			      /* yyterminate() terminates the scanner and returns a 0 to the 
@@ -1065,12 +1106,13 @@ incompl_location	%[IQM]\*
 			       */ 	
 			    yyterminate();
 			  } else {
-			    fclose(yyin);
+			    /* NOTE: the included file was closed as soon as it was read into memory (see handle_include_file_() ),
+			     *       and the memory will be released by delete_file_buffer()
+			     */
 			    FreeTracking(current_tracking);
-			    --include_stack_ptr;
-			    yy_delete_buffer(YY_CURRENT_BUFFER);
-			    yy_switch_to_buffer((include_stack[include_stack_ptr]).buffer_state);
-			    current_tracking = include_stack[include_stack_ptr].env;
+			    delete_file_buffer(YY_CURRENT_BUFFER);
+			    yy_switch_to_buffer(include_stack.back().buffer_state);
+			    current_tracking = include_stack.back().env;
 			      /* removing constness of char *. This is safe actually,
 			       * since the only real const char * that is stored on the stack is
 			       * the first one (i.e. the one that gets stored in include_stack[0],
@@ -1083,7 +1125,8 @@ incompl_location	%[IQM]\*
 			     *       messages during semantic analysis (stage 3)
 			     */
 			    /* free((char *)current_filename); */
-			    current_filename = include_stack[include_stack_ptr].filename;
+			    current_filename = include_stack.back().filename;
+			    include_stack.pop_back();
 			    yy_push_state(include_end);
 			  }
 			}
@@ -1115,7 +1158,15 @@ END_FUNCTION			unput_text(0); BEGIN(INITIAL);
 END_FUNCTION_BLOCK		unput_text(0); BEGIN(INITIAL);
 END_PROGRAM			unput_text(0); BEGIN(INITIAL);
 END_CONFIGURATION		unput_text(0); BEGIN(INITIAL);
-.|\n				{}/* Ignore text inside POU! (including the '\n' character!)) */
+	/* Ignore text inside POU! (including the '\n' character!))
+	 * The text is skipped in chunks as large as possible, as handling each char with its own
+	 * action would make this pre-parsing almost as slow as the real parsing.
+	 * Whole identifiers are skipped at once, so that an identifier ending in END_FUNCTION
+	 * (or END_PROGRAM, ...) is not mistaken for the end of the POU.
+	 */
+{identifier}			{}
+[^A-Za-z_(]+			{}
+.				{}
 }
 
 
@@ -1362,8 +1413,10 @@ END_CONFIGURATION	BEGIN(INITIAL); return END_CONFIGURATION;
 		   return token;
 		 }
 		 // otherwise, leave it for the other lexical parser rules... 
+		 // NOTE: this requires flex's reject action, which can not be used with full tables,
+		 //       so the '%option full' must also be removed when re-activating this code!
 		 // fprintf(stderr, "rejecting\n"); 
-		 REJECT;
+		 // (reject the text here)
 		}
  */
 
@@ -1380,10 +1433,10 @@ END_CONFIGURATION	BEGIN(INITIAL); return END_CONFIGURATION;
 	/******************************************************/
 
 
-REF	{if (get_opt_ref_standard_extensions()) return REF;        else{REJECT;}}		/* Keyword in IEC 61131-3 v3 */
-DREF	{if (get_opt_ref_standard_extensions()) return DREF;       else{REJECT;}}		/* Keyword in IEC 61131-3 v3 */
-REF_TO	{if (get_opt_ref_standard_extensions()) return REF_TO;     else{REJECT;}}		/* Keyword in IEC 61131-3 v3 */
-NULL	{if (get_opt_ref_standard_extensions()) return NULL_token; else{REJECT;}}		/* Keyword in IEC 61131-3 v3 */
+REF	{if (get_opt_ref_standard_extensions()) return REF;        else {return keyword_as_identifier(yyleng);}}		/* Keyword in IEC 61131-3 v3 */
+DREF	{if (get_opt_ref_standard_extensions()) return DREF;       else {return keyword_as_identifier(yyleng);}}		/* Keyword in IEC 61131-3 v3 */
+REF_TO	{if (get_opt_ref_standard_extensions()) return REF_TO;     else {return keyword_as_identifier(yyleng);}}		/* Keyword in IEC 61131-3 v3 */
+NULL	{if (get_opt_ref_standard_extensions()) return NULL_token; else {return keyword_as_identifier(yyleng);}}		/* Keyword in IEC 61131-3 v3 */
 
 EN	return EN;			/* Keyword */
 ENO	return ENO;			/* Keyword */
@@ -1395,14 +1448,14 @@ ENO	return ENO;			/* Keyword */
 TRUE		return TRUE;		/* Keyword */
 BOOL#1  	return boolean_true_literal_token;
 BOOL#TRUE	return boolean_true_literal_token;
-SAFEBOOL#1	{if (get_opt_safe_extensions()) {return safeboolean_true_literal_token;} else{REJECT;}} /* Keyword (Data Type) */ 
-SAFEBOOL#TRUE	{if (get_opt_safe_extensions()) {return safeboolean_true_literal_token;} else{REJECT;}} /* Keyword (Data Type) */
+SAFEBOOL#1	{if (get_opt_safe_extensions()) {return safeboolean_true_literal_token;} else {return keyword_as_identifier(8);}} /* Keyword (Data Type) */ 
+SAFEBOOL#TRUE	{if (get_opt_safe_extensions()) {return safeboolean_true_literal_token;} else {return keyword_as_identifier(8);}} /* Keyword (Data Type) */
 
 FALSE		return FALSE;		/* Keyword */
 BOOL#0  	return boolean_false_literal_token;
 BOOL#FALSE  	return boolean_false_literal_token;
-SAFEBOOL#0	{if (get_opt_safe_extensions()) {return safeboolean_false_literal_token;} else{REJECT;}} /* Keyword (Data Type) */ 
-SAFEBOOL#FALSE	{if (get_opt_safe_extensions()) {return safeboolean_false_literal_token;} else{REJECT;}} /* Keyword (Data Type) */
+SAFEBOOL#0	{if (get_opt_safe_extensions()) {return safeboolean_false_literal_token;} else {return keyword_as_identifier(8);}} /* Keyword (Data Type) */ 
+SAFEBOOL#FALSE	{if (get_opt_safe_extensions()) {return safeboolean_false_literal_token;} else {return keyword_as_identifier(8);}} /* Keyword (Data Type) */
 
 
 	/************************/
@@ -1459,7 +1512,7 @@ DATE_AND_TIME	return DATE_AND_TIME;	/* Keyword (Data Type) */
 TIME_OF_DAY	return TIME_OF_DAY;	/* Keyword (Data Type) */
 
 					/* A non-standard extension! */
-VOID		{if (runtime_options.allow_void_datatype) {return VOID;}          else {REJECT;}} 
+VOID		{if (runtime_options.allow_void_datatype) {return VOID;}          else {return keyword_as_identifier(yyleng);}} 
 
 
 	/*****************************************************************/
@@ -1475,39 +1528,39 @@ VOID		{if (runtime_options.allow_void_datatype) {return VOID;}          else {RE
          *        We only support these extensions and keywords
          *        if the apropriate command line option is given.
          */
-SAFEBOOL	     {if (get_opt_safe_extensions()) {return SAFEBOOL;}          else {REJECT;}} 
+SAFEBOOL	     {if (get_opt_safe_extensions()) {return SAFEBOOL;}          else {return keyword_as_identifier(yyleng);}} 
 
-SAFEBYTE	     {if (get_opt_safe_extensions()) {return SAFEBYTE;}          else {REJECT;}} 
-SAFEWORD	     {if (get_opt_safe_extensions()) {return SAFEWORD;}          else {REJECT;}} 
-SAFEDWORD	     {if (get_opt_safe_extensions()) {return SAFEDWORD;}         else{REJECT;}}
-SAFELWORD	     {if (get_opt_safe_extensions()) {return SAFELWORD;}         else{REJECT;}}
+SAFEBYTE	     {if (get_opt_safe_extensions()) {return SAFEBYTE;}          else {return keyword_as_identifier(yyleng);}} 
+SAFEWORD	     {if (get_opt_safe_extensions()) {return SAFEWORD;}          else {return keyword_as_identifier(yyleng);}} 
+SAFEDWORD	     {if (get_opt_safe_extensions()) {return SAFEDWORD;}         else {return keyword_as_identifier(yyleng);}}
+SAFELWORD	     {if (get_opt_safe_extensions()) {return SAFELWORD;}         else {return keyword_as_identifier(yyleng);}}
                
-SAFEREAL	     {if (get_opt_safe_extensions()) {return SAFESINT;}          else{REJECT;}}
-SAFELREAL    	     {if (get_opt_safe_extensions()) {return SAFELREAL;}         else{REJECT;}}
+SAFEREAL	     {if (get_opt_safe_extensions()) {return SAFESINT;}          else {return keyword_as_identifier(yyleng);}}
+SAFELREAL    	     {if (get_opt_safe_extensions()) {return SAFELREAL;}         else {return keyword_as_identifier(yyleng);}}
                   
-SAFESINT	     {if (get_opt_safe_extensions()) {return SAFESINT;}          else{REJECT;}}
-SAFEINT	             {if (get_opt_safe_extensions()) {return SAFEINT;}           else{REJECT;}}
-SAFEDINT	     {if (get_opt_safe_extensions()) {return SAFEDINT;}          else{REJECT;}}
-SAFELINT             {if (get_opt_safe_extensions()) {return SAFELINT;}          else{REJECT;}}
+SAFESINT	     {if (get_opt_safe_extensions()) {return SAFESINT;}          else {return keyword_as_identifier(yyleng);}}
+SAFEINT	             {if (get_opt_safe_extensions()) {return SAFEINT;}           else {return keyword_as_identifier(yyleng);}}
+SAFEDINT	     {if (get_opt_safe_extensions()) {return SAFEDINT;}          else {return keyword_as_identifier(yyleng);}}
+SAFELINT             {if (get_opt_safe_extensions()) {return SAFELINT;}          else {return keyword_as_identifier(yyleng);}}
 
-SAFEUSINT            {if (get_opt_safe_extensions()) {return SAFEUSINT;}         else{REJECT;}}
-SAFEUINT             {if (get_opt_safe_extensions()) {return SAFEUINT;}          else{REJECT;}}
-SAFEUDINT            {if (get_opt_safe_extensions()) {return SAFEUDINT;}         else{REJECT;}}
-SAFEULINT            {if (get_opt_safe_extensions()) {return SAFEULINT;}         else{REJECT;}}
+SAFEUSINT            {if (get_opt_safe_extensions()) {return SAFEUSINT;}         else {return keyword_as_identifier(yyleng);}}
+SAFEUINT             {if (get_opt_safe_extensions()) {return SAFEUINT;}          else {return keyword_as_identifier(yyleng);}}
+SAFEUDINT            {if (get_opt_safe_extensions()) {return SAFEUDINT;}         else {return keyword_as_identifier(yyleng);}}
+SAFEULINT            {if (get_opt_safe_extensions()) {return SAFEULINT;}         else {return keyword_as_identifier(yyleng);}}
 
  /* SAFESTRING and SAFEWSTRING are not yet supported, i.e. checked correctly, in the semantic analyser (stage 3) */
  /*  so it is best not to support them at all... */
  /*
-SAFEWSTRING          {if (get_opt_safe_extensions()) {return SAFEWSTRING;}       else{REJECT;}}
-SAFESTRING           {if (get_opt_safe_extensions()) {return SAFESTRING;}        else{REJECT;}}
+SAFEWSTRING          {if (get_opt_safe_extensions()) {return SAFEWSTRING;}       else {return keyword_as_identifier(yyleng);}}
+SAFESTRING           {if (get_opt_safe_extensions()) {return SAFESTRING;}        else {return keyword_as_identifier(yyleng);}}
  */
 
-SAFETIME             {if (get_opt_safe_extensions()) {return SAFETIME;}          else{REJECT;}}
-SAFEDATE             {if (get_opt_safe_extensions()) {return SAFEDATE;}          else{REJECT;}}
-SAFEDT               {if (get_opt_safe_extensions()) {return SAFEDT;}            else{REJECT;}}
-SAFETOD              {if (get_opt_safe_extensions()) {return SAFETOD;}           else{REJECT;}}
-SAFEDATE_AND_TIME    {if (get_opt_safe_extensions()) {return SAFEDATE_AND_TIME;} else{REJECT;}}
-SAFETIME_OF_DAY      {if (get_opt_safe_extensions()) {return SAFETIME_OF_DAY;}   else{REJECT;}}
+SAFETIME             {if (get_opt_safe_extensions()) {return SAFETIME;}          else {return keyword_as_identifier(yyleng);}}
+SAFEDATE             {if (get_opt_safe_extensions()) {return SAFEDATE;}          else {return keyword_as_identifier(yyleng);}}
+SAFEDT               {if (get_opt_safe_extensions()) {return SAFEDT;}            else {return keyword_as_identifier(yyleng);}}
+SAFETOD              {if (get_opt_safe_extensions()) {return SAFETOD;}           else {return keyword_as_identifier(yyleng);}}
+SAFEDATE_AND_TIME    {if (get_opt_safe_extensions()) {return SAFEDATE_AND_TIME;} else {return keyword_as_identifier(yyleng);}}
+SAFETIME_OF_DAY      {if (get_opt_safe_extensions()) {return SAFETIME_OF_DAY;}   else {return keyword_as_identifier(yyleng);}}
 
 	/********************************/
 	/* B 1.3.2 - Generic data types */
@@ -1907,8 +1960,16 @@ _			/* do nothing - eat it up!*/
 	/*****************************************/
 	/* B.1.1 Letters, digits and identifiers */
 	/*****************************************/
-<st_state>{identifier}/({st_whitespace_or_pragma_or_comment})"=>"	{yylval.ID=strdup(yytext); return sendto_identifier_token;}
-<il_state>{identifier}/({il_whitespace_or_pragma_or_comment})"=>"	{yylval.ID=strdup(yytext); return sendto_identifier_token;}
+	/* NOTE: The following two rules would be more naturally written with the trailing context
+	 *         {identifier}/({st_whitespace_or_pragma_or_comment})"=>"
+	 *       However, trailing context in which both the head and the tail have a variable length
+	 *       makes flex use the same (slow) machinery as the reject action for every single
+	 *       token, and can not be used with the '%option full'.
+	 *       We therefore match the whole text, and then return everything following the
+	 *       identifier to the input stream.
+	 */
+<st_state>{identifier}{st_whitespace_or_pragma_or_comment}"=>"	{shorten_token(identifier_length(yytext)); yylval.ID=strdup(yytext); return sendto_identifier_token;}
+<il_state>{identifier}{il_whitespace_or_pragma_or_comment}"=>"	{shorten_token(identifier_length(yytext)); yylval.ID=strdup(yytext); return sendto_identifier_token;}
 {identifier} 				{yylval.ID=strdup(yytext);
 					 // printf("returning identifier...: %s, %d\n", yytext, get_identifier_token(yytext));
 					 return get_identifier_token(yytext);}
@@ -1946,14 +2007,13 @@ _			/* do nothing - eat it up!*/
 
 #define MAX_LINE_LENGTH 1024
 
-tracking_t *GetNewTracking(FILE* in_file) {
+tracking_t *GetNewTracking(void) {
   tracking_t* new_env = new tracking_t;
   new_env->eof         = 0;
   new_env->lineNumber  = 1;
   new_env->currentChar = 0;
   new_env->lineLength  = 0;
   new_env->currentTokenStart = 0;
-  new_env->in_file = in_file;
   return new_env;
 }
 
@@ -1974,13 +2034,106 @@ void UpdateTracking(const char *text) {
 }
 
 
-/* GetNextChar: reads a character from input */
-int GetNextChar(char *b, int maxBuffer) {
-  int res = fgetc(current_tracking->in_file);
-  if ( res == EOF ) 
-    return 0;
-  *b = (char)res;
-  return 1;
+#ifdef MMAP_INPUT_FILES
+/* The memory mapped input files, indexed by the flex buffer scanning each of them. */
+typedef struct {
+	  void  *addr;
+	  size_t len;
+	} mapped_file_t;
+
+std::map<YY_BUFFER_STATE, mapped_file_t> mapped_files;
+
+
+/* Map the whole file into memory, and have flex scan it from there (also switches to the new buffer).
+ * Returns NULL if the file can not be mapped (e.g. it is a pipe, or it is empty).
+ *
+ * flex requires the text to be followed by two YY_END_OF_BUFFER_CHAR ('\0'). These are placed in the
+ * remainder of the last page of the mapping, which mmap() fills with zeros. Files that leave less
+ * than 2 bytes free in their last page are therefore not mapped, as accessing a page beyond the end
+ * of the file raises a SIGBUS.
+ * flex also changes the text while scanning it (it temporarily places a '\0' after each token, and
+ * unput() writes to it), so the file is mapped privately, i.e. these changes never reach the file.
+ */
+YY_BUFFER_STATE map_file_buffer(FILE *filehandle) {
+  struct stat file_stat;
+  int  fd = fileno(filehandle);
+  long page_size = sysconf(_SC_PAGESIZE);
+
+  if ((fstat(fd, &file_stat) != 0) || !S_ISREG(file_stat.st_mode) || (file_stat.st_size <= 0) || (page_size <= 0))
+    return NULL;
+
+  size_t len = file_stat.st_size;
+  if ((len % page_size == 0) || (len % page_size > (size_t)page_size - 2))
+    return NULL;
+
+  char *text = (char *)mmap(NULL, len + 2, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  if (MAP_FAILED == text)
+    return NULL;
+
+  text[len] = text[len+1] = YY_END_OF_BUFFER_CHAR;
+  YY_BUFFER_STATE buffer = yy_scan_buffer(text, len + 2);
+  if (NULL == buffer) ERROR;
+  mapped_files[buffer].addr = text;
+  mapped_files[buffer].len  = len + 2;
+  return buffer;
+}
+#endif
+
+
+/* Have flex scan the whole file from memory (also switches to the new buffer).
+ *
+ * The file is memory mapped whenever possible, and otherwise read into memory.
+ * Since flex never has to read more input into this buffer, it will never discard the text it has
+ * already scanned. This means that any text we return to the input stream with unput() 
+ * (e.g. the whole bodystate_buffer) will always fit into the buffer.
+ * Note that this was not true when flex read the file into its own buffer, which is why flex
+ * used to be fed a single character at a time!
+ *
+ * The memory is released by delete_file_buffer().
+ */
+YY_BUFFER_STATE scan_file_buffer(FILE *filehandle) {
+#ifdef MMAP_INPUT_FILES
+  YY_BUFFER_STATE mapped_buffer = map_file_buffer(filehandle);
+  if (NULL != mapped_buffer)
+    return mapped_buffer;
+#endif
+
+  size_t size = 65536, len = 0, n;
+  char  *text = NULL;
+
+  do {
+    if (len + 2 >= size) size *= 2;
+    if ((text = (char *)realloc(text, size)) == NULL) {
+      fprintf(stderr, "Out of memory!\n");
+      exit( 1 );
+    }
+    len += (n = fread(text + len, 1, size - len - 2, filehandle));
+  } while (n > 0);
+
+  if (ferror(filehandle)) {
+    perror("Error reading file");
+    exit( 1 );
+  }
+
+  /* flex requires the buffer to end with two YY_END_OF_BUFFER_CHAR */
+  text[len] = text[len+1] = YY_END_OF_BUFFER_CHAR;
+  YY_BUFFER_STATE buffer = yy_scan_buffer(text, len + 2);
+  if (NULL == buffer) ERROR;
+  buffer->yy_is_our_buffer = 1; /* have yy_delete_buffer() free the text too */
+  return buffer;
+}
+
+
+/* Release a buffer (and the memory holding the text it scans) */
+void delete_file_buffer(YY_BUFFER_STATE buffer) {
+  yy_delete_buffer(buffer);
+#ifdef MMAP_INPUT_FILES
+  std::map<YY_BUFFER_STATE, mapped_file_t>::iterator mapped_file = mapped_files.find(buffer);
+  if (mapped_file != mapped_files.end()) {
+    munmap(mapped_file->second.addr, mapped_file->second.len);
+    mapped_files.erase(mapped_file);
+  }
+#endif
 }
 
 
@@ -1993,54 +2146,51 @@ int GetNextChar(char *b, int maxBuffer) {
 void print_include_stack(void) {
   int i;
 
-  if ((include_stack_ptr - 1) >= 0)
+  if (!include_stack.empty())
     fprintf (stderr, "in file "); 
-  for (i = include_stack_ptr - 1; i >= 0; i--)
+  for (i = include_stack.size() - 1; i >= 0; i--)
     fprintf (stderr, "included from file %s:%d\n", include_stack[i].filename, include_stack[i].env->lineNumber);
 }
 
 
 
-/* set the internal state variables of lexical analyser to process a new include file */
-void handle_include_file_(FILE *filehandle, const char *filename) {
-  if (include_stack_ptr >= MAX_INCLUDE_DEPTH) {
+/* save the internal state variables of lexical analyser in the include stack, before processing a new include file */
+void push_include_stack_(const char *filename) {
+  if (include_stack.size() >= MAX_INCLUDE_DEPTH) {
     fprintf(stderr, "Includes nested too deeply\n");
     exit( 1 );
   }
   
-  yyin = filehandle;
-  
-  include_stack[include_stack_ptr].buffer_state = YY_CURRENT_BUFFER;
-  include_stack[include_stack_ptr].env = current_tracking;
-  include_stack[include_stack_ptr].filename = current_filename;
+  include_stack_t include_state;
+  include_state.buffer_state = YY_CURRENT_BUFFER;
+  include_state.env = current_tracking;
+  include_state.filename = current_filename;
+  include_stack.push_back(include_state);
   
   current_filename = strdup(filename);
-  current_tracking = GetNewTracking(yyin);
-  include_stack_ptr++;
+  current_tracking = GetNewTracking();
+}
 
+
+/* set the internal state variables of lexical analyser to process a new include file */
+void handle_include_file_(FILE *filehandle, const char *filename) {
+  push_include_stack_(filename);
   /* switch input buffer to new file... */
-  yy_switch_to_buffer(yy_create_buffer(yyin, YY_BUF_SIZE));
+  scan_file_buffer(filehandle);
+  /* the whole file is now in memory, so we no longer need it open */
+  fclose(filehandle);
 }
 
 
 
 /* insert the code (in <source_code>) into the source code we are parsing.
- * This is done by creating an artificial file with that new source code, and then 'including' the file
+ * This is done by handling that new source code as if it had been included with the (*#include ... *) pragma,
+ * from an artificial file with no name.
  */
 void include_string_(const char *source_code) {
-  FILE *tmp_file = tmpfile();
-  
-  if(tmp_file == NULL) {
-    perror("Error creating temp file.");
-    exit(EXIT_FAILURE);
-  }
-
-  fwrite((void *)source_code, 1, strlen(source_code), tmp_file);
-  rewind(tmp_file);
-
-  /* now parse the tmp file, by asking flex to handle it as if it had been included with the (*#include ... *) pragma... */
-  handle_include_file_(tmp_file, "");
-//fclose(tmp_file);  /* do NOT close file. It must only be closed when we finish reading from it! */
+  push_include_stack_("");
+  /* switch input buffer to a copy of the new source code... */
+  yy_scan_string(source_code);
 }
 
 
@@ -2102,19 +2252,45 @@ void unput_char(const char c) {
 
 
 /* return all the text in the current token back to the input stream, except the first n chars. */
+/* NOTE: yytext will then contain only the first n chars of the token. */
 void unput_text(int n) {
-  if (n < 0) ERROR;
-  signed int i; // must be signed! The iterartion may end with -1 when this function is called with n=0 !!
+  if ((n < 0) || (n > yyleng)) ERROR;
 
-  char *yycopy = strdup( yytext ); /* unput_char() destroys yytext, so we copy it first */
-  for (int i = yyleng-1; i >= n; i--)
-    unput_char(yycopy[i]);
+  /* Since the text being returned is exactly the text just read by flex, we do not need to
+   * use unput(), which copies the text back to the input buffer one char at a time, and 
+   * destroys yytext. We simply ask flex to move its read pointer back!
+   */
+  yyless(n);
 
   *current_tracking = previous_tracking;
-  yycopy[n] = '\0';
-  UpdateTracking(yycopy);
-  
-  free(yycopy);
+  UpdateTracking(yytext);
+}
+
+
+/* Keep only the first n chars of the current token (i.e. yytext), and return the remaining
+ * text to the input stream. The location of the token (yylloc) is updated to match.
+ */
+void shorten_token(int n) {
+  unput_text(n);
+  yylloc.last_line   = current_tracking->lineNumber;
+  yylloc.last_column = current_tracking->currentChar - 1;
+}
+
+
+int identifier_length(const char *text) {
+  return strspn(text, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_");
+}
+
+
+/* Hand the first n chars of a keyword that has not been enabled (e.g. REF when the
+ * REF extensions were not requested in the command line) back to bison as an identifier,
+ * just like the {identifier} rule would have done. The remaining chars are returned to
+ * the input stream.
+ */
+int keyword_as_identifier(int n) {
+  shorten_token(n);
+  yylval.ID = strdup(yytext);
+  return get_identifier_token(yytext);
 }
 
 
@@ -2239,7 +2415,12 @@ FILE *parse_file(const char *filename) {
   if((filehandle = fopen(filename, "r")) != NULL) {
     yyin = filehandle;
     current_filename = strdup(filename);
-    current_tracking = GetNewTracking(yyin);
+    current_tracking = GetNewTracking();
+    /* release the buffer of the previously parsed file (if any)... */
+    if (YY_CURRENT_BUFFER != NULL)
+      delete_file_buffer(YY_CURRENT_BUFFER);
+    /* ...and switch to the new file. */
+    scan_file_buffer(filehandle);
   }
   return filehandle;
 }
@@ -167,10 +167,12 @@ int get_identifier_token(const char *identifier_str) {
   variable_name_symtable_t  ::iterator iter1;
   library_element_symtable_t::iterator iter2;
 
-  if ((iter1 = variable_name_symtable.find(identifier_str)) != variable_name_symtable.end())
+  std::string identifier(identifier_str); /* only build the std::string key once, for both lookups */
+
+  if ((iter1 = variable_name_symtable.find(identifier)) != variable_name_symtable.end())
     return iter1->second;
     
-  if ((iter2 = library_element_symtable.find(identifier_str)) != library_element_symtable.end())
+  if ((iter2 = library_element_symtable.find(identifier)) != library_element_symtable.end())
     return iter2->second;
   
   return identifier_token;
@@ -230,12 +232,13 @@ char *strdup3(const char *a, const char *b, const char *c) {
 /***********************************************************************/
 /***********************************************************************/
 
-int stage2__(const char *filename, 
+int stage2__(int file_count,
+             const char * const *filenames,
              symbol_c **tree_root_ref
             );
 
 
-int stage1_2(const char *filename, symbol_c **tree_root_ref) {
+int stage1_2(int file_count, const char * const *filenames, symbol_c **tree_root_ref) {
       /* NOTE: we only call stage2 (bison - syntax analysis) directly, as stage 2 will itself call stage1 (flex - lexical analysis)
        *       automatically as needed
        */
@@ -246,6 +249,6 @@ int stage1_2(const char *filename, symbol_c **tree_root_ref) {
        *       These callback functions will get their data from local (to this file) global variables...
        *       We now set those variables...
        */
-  return stage2__(filename, tree_root_ref);
+  return stage2__(file_count, filenames, tree_root_ref);
 }
 
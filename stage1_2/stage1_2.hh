@@ -45,7 +45,8 @@
 /* This file includes the interface through which the main function accesses the stage1_2 services */
 
 
-int stage1_2(const char *filename, symbol_c **tree_root);
+/* Parse the input files (in the given order) into a single library_c */
+int stage1_2(int file_count, const char * const *filenames, symbol_c **tree_root);
 
 
 
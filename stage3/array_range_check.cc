@@ -37,6 +37,16 @@
  *   - Check whether array subscript values fall within the allowed range.
  *     Note that for the checking of subscript values to work correctly, we need to have constant folding working too:
  *     array_var[8 + 99] can not be checked without constant folding.
+ *   - Determine which subscripts are guaranteed to always fall within the allowed range, so stage 4 may
+ *     leave out the runtime bounds check of those subscripts (iec2c -O a).
+ *     The range of values a subscript may take is determined from:
+ *       - its constant value (constant folding and propagation);
+ *       - the data type of the variables used as subscripts (e.g. USINT, or a subrange);
+ *       - the FOR loops with constant limits and increment, for their control variable;
+ *       - '+', '-' and '*' applied to any of the above.
+ *     The result is stored in subscript_list_c->range_proof (see absyntax.def).
+ *     Note that a forced variable may hold any value of its base type (forced values are neither clamped to the subrange,
+ *     nor changed by FOR loops), so proofs relying on the value of a variable are only valid if variables can not be forced.
  */
 
 
@@ -87,10 +97,86 @@ static inline int cmp_unsigned_signed(const uint64_t u, const int64_t s) {
   return -1;
 }
 
+/* Range of values (limited to the int64_t range) that a variable of a given data type may take.
+ * Returns false for data types that are not integers, and for ULINT.
+ * 'forceable' is set when a forced variable could take a value outside of the range.
+ */
+static bool get_type_range(symbol_c *type, int64_t &lower, int64_t &upper, bool &forceable) {
+  if (NULL == type) return false;
+  symbol_c *type_decl = search_base_type_c::get_equivtype_decl(type);
+  if (NULL == type_decl) return false;
+
+  /* subrange_type_name ':' subrange_spec_init */
+  if (typeid(*type_decl) == typeid(subrange_type_declaration_c)) type_decl = ((subrange_type_declaration_c *)type_decl)->subrange_spec_init;
+  /* subrange_specification ASSIGN signed_integer */
+  if (typeid(*type_decl) == typeid(subrange_spec_init_c))        type_decl = ((subrange_spec_init_c *)type_decl)->subrange_specification;
+  /* integer_type_name '(' subrange')' */
+  if (typeid(*type_decl) == typeid(subrange_specification_c)) {
+    subrange_c *subrange = (subrange_c *)((subrange_specification_c *)type_decl)->subrange;
+    if (NULL == subrange)
+      return get_type_range(((subrange_specification_c *)type_decl)->integer_type_name, lower, upper, forceable);
+    if (!VALID_CVALUE(int64, subrange->lower_limit) || !VALID_CVALUE(int64, subrange->upper_limit)) return false;
+    lower = GET_CVALUE(int64, subrange->lower_limit);
+    upper = GET_CVALUE(int64, subrange->upper_limit);
+    forceable = true;
+    return true;
+  }
+
+  type_decl = search_base_type_c::get_basetype_decl(type_decl);
+  if (NULL == type_decl) return false;
+  if ((typeid(*type_decl) == typeid(sint_type_name_c))  || (typeid(*type_decl) == typeid(safesint_type_name_c)))  {lower = INT8_MIN;  upper = INT8_MAX;   return true;}
+  if ((typeid(*type_decl) == typeid(int_type_name_c))   || (typeid(*type_decl) == typeid(safeint_type_name_c)))   {lower = INT16_MIN; upper = INT16_MAX;  return true;}
+  if ((typeid(*type_decl) == typeid(dint_type_name_c))  || (typeid(*type_decl) == typeid(safedint_type_name_c)))  {lower = INT32_MIN; upper = INT32_MAX;  return true;}
+  if ((typeid(*type_decl) == typeid(lint_type_name_c))  || (typeid(*type_decl) == typeid(safelint_type_name_c)))  {lower = INT64_MIN; upper = INT64_MAX;  return true;}
+  if ((typeid(*type_decl) == typeid(usint_type_name_c)) || (typeid(*type_decl) == typeid(safeusint_type_name_c))) {lower = 0;         upper = UINT8_MAX;  return true;}
+  if ((typeid(*type_decl) == typeid(uint_type_name_c))  || (typeid(*type_decl) == typeid(safeuint_type_name_c)))  {lower = 0;         upper = UINT16_MAX; return true;}
+  if ((typeid(*type_decl) == typeid(udint_type_name_c)) || (typeid(*type_decl) == typeid(safeudint_type_name_c))) {lower = 0;         upper = UINT32_MAX; return true;}
+  return false;
+}
+
+
+
+/* Find whether an expression reads any variable (i.e. whether its constant value, if any, may have been propagated from a variable) */
+class find_variables_c: public iterator_visitor_c {
+  private:
+    bool found;
+
+  public:
+    static bool find(symbol_c *symbol) {
+      find_variables_c find_variables;
+      find_variables.found = false;
+      symbol->accept(find_variables);
+      return find_variables.found;
+    }
+
+    void *visit(symbolic_variable_c *symbol) {found = true; return NULL;}
+    void *visit(direct_variable_c   *symbol) {found = true; return NULL;}
+};
+
+
+
+/* Collect the names of the variables whose address is taken with REF() */
+class find_referenced_variables_c: public iterator_visitor_c {
+  private:
+    std::set<std::string> &names;
+
+  public:
+    find_referenced_variables_c(std::set<std::string> &names_): names(names_) {}
+
+    void *visit(ref_expression_c *symbol) {
+      token_c *name = get_var_name_c::get_name(symbol->exp);
+      if (NULL != name) names.insert(name->value);
+      return NULL;
+    }
+};
+
+
+
 array_range_check_c::array_range_check_c(symbol_c *ignore) {
 	error_count = 0;
 	current_display_error_level = 0;
 	search_varfb_instance_type = NULL;
+	search_var_instance_decl = NULL;
 }
 
 
@@ -126,12 +212,22 @@ void array_range_check_c::check_bounds(array_variable_c *symbol) {
   l = (list_c *)symbol->subscript_list;
   var_decl = search_varfb_instance_type->get_basetype_decl(symbol->subscripted_variable);
   array_dimension_iterator_c array_dimension_iterator(var_decl);
+  std::vector<int> &range_proof = ((subscript_list_c *)symbol->subscript_list)->range_proof;
+  range_proof.assign(l->n, 0);
   for (int i =  0; i < l->n; i++) {
     subrange_c *dimension = array_dimension_iterator.next();
     /* mismatch between number of indexes/subscripts. This error will be caught in check_dimension_count() so we ignore it. */
     if (NULL == dimension) 
       return;
 
+    /* Try to prove that the subscript always lies within the limits */
+    int64_t lower, upper;
+    bool forceable = false;
+    if (   get_range(l->get_element(i), lower, upper, forceable)
+        && VALID_CVALUE(int64, dimension->lower_limit) && (lower >= GET_CVALUE(int64, dimension->lower_limit))
+        && VALID_CVALUE(int64, dimension->upper_limit) && (upper <= GET_CVALUE(int64, dimension->upper_limit)))
+      range_proof[i] = forceable? 2 : 1;
+
     /* Check lower limit */
     if ( VALID_CVALUE( int64, l->get_element(i)) && VALID_CVALUE( int64, dimension->lower_limit))
       if ( GET_CVALUE( int64, l->get_element(i)) < GET_CVALUE( int64, dimension->lower_limit) )
@@ -177,6 +273,92 @@ void array_range_check_c::check_bounds(array_variable_c *symbol) {
 
 
 
+/* Determine the range of values an expression used as an array subscript may take.
+ * Returns false if the range could not be determined.
+ * 'forceable' is set when the range is only valid as long as no variable is forced.
+ */
+#define MAX_RANGE_OPERAND ((int64_t)1 << 31)  /* limit the operands of '+', '-' and '*' so the results never overflow */
+bool array_range_check_c::get_range(symbol_c *expression, int64_t &lower, int64_t &upper, bool &forceable) {
+  if (NULL == expression) return false;
+
+  /* constant values */
+  if (VALID_CVALUE(int64, expression) || (VALID_CVALUE(uint64, expression) && (GET_CVALUE(uint64, expression) <= INT64_MAX))) {
+    lower = upper = VALID_CVALUE(int64, expression)? GET_CVALUE(int64, expression) : (int64_t)GET_CVALUE(uint64, expression);
+    if (find_variables_c::find(expression)) forceable = true;
+    return true;
+  }
+
+  /* '+', '-' and '*' */
+  if (   (typeid(*expression) == typeid(add_expression_c))
+      || (typeid(*expression) == typeid(sub_expression_c))
+      || (typeid(*expression) == typeid(mul_expression_c))) {
+    /* all three classes have the same layout... */
+    add_expression_c *binary = (add_expression_c *)expression;
+    int64_t l1, u1, l2, u2;
+    if (!get_range(binary->l_exp, l1, u1, forceable) || !get_range(binary->r_exp, l2, u2, forceable)) return false;
+    if ((l1 < -MAX_RANGE_OPERAND) || (u1 > MAX_RANGE_OPERAND) || (l2 < -MAX_RANGE_OPERAND) || (u2 > MAX_RANGE_OPERAND)) return false;
+    if (typeid(*expression) == typeid(add_expression_c)) {lower = l1 + l2; upper = u1 + u2; return true;}
+    if (typeid(*expression) == typeid(sub_expression_c)) {lower = l1 - u2; upper = u1 - l2; return true;}
+    int64_t p[4] = {l1 * l2, l1 * u2, u1 * l2, u1 * u2};
+    lower = upper = p[0];
+    for (int i = 1; i < 4; i++) {
+      if (p[i] < lower) lower = p[i];
+      if (p[i] > upper) upper = p[i];
+    }
+    return true;
+  }
+
+  /* '-' (negation) */
+  if (typeid(*expression) == typeid(neg_expression_c)) {
+    int64_t l1, u1;
+    if (!get_range(((neg_expression_c *)expression)->exp, l1, u1, forceable)) return false;
+    if ((l1 < -MAX_RANGE_OPERAND) || (u1 > MAX_RANGE_OPERAND)) return false;
+    lower = -u1; upper = -l1;
+    return true;
+  }
+
+  if (   (typeid(*expression) != typeid(symbolic_variable_c))
+      && (typeid(*expression) != typeid(array_variable_c))
+      && (typeid(*expression) != typeid(structured_variable_c)))
+    return false;
+
+  /* control variable of a FOR loop */
+  if (typeid(*expression) == typeid(symbolic_variable_c)) {
+    for (int i = control_variable_ranges.size() - 1; i >= 0; i--) {
+      if (compare_identifiers(((symbolic_variable_c *)expression)->var_name, control_variable_ranges[i].control_variable) == 0) {
+        lower = control_variable_ranges[i].lower;
+        upper = control_variable_ranges[i].upper;
+        forceable = true;
+        return true;
+      }
+    }
+  }
+
+  /* any variable: use the range of its data type.
+   * NOTE: the datatype annotation of a variable declared as a subrange is the subrange's base type (e.g. INT),
+   *       so we look for the data type in the variable's declaration instead.
+   */
+  if (!is_own_variable(expression)) return false;
+  symbol_c *type_id = search_varfb_instance_type->get_type_id(expression);
+  return get_type_range((NULL != type_id)? type_id : expression->datatype, lower, upper, forceable);
+}
+
+
+/* Is the variable (or the array or structure it is an element of) declared in the current POU, without being located?
+ * Only these variables are guaranteed to hold a value of their data type (e.g. within their subrange).
+ * Located variables (AT %IW0, AT %I*) are written by the I/O, VAR_IN_OUT variables may be bound to variables of
+ * another POU, and VAR_EXTERNAL variables to global variables, whose declared data type is not checked here.
+ */
+bool array_range_check_c::is_own_variable(symbol_c *variable) {
+	unsigned int vartype = search_var_instance_decl->get_vartype(variable);
+	return (   (search_var_instance_decl_c::input_vt   == vartype) || (search_var_instance_decl_c::output_vt == vartype)
+	        || (search_var_instance_decl_c::private_vt == vartype) || (search_var_instance_decl_c::temp_vt   == vartype));
+}
+
+
+
+
+
 /*************************/
 /* B.1 - Common elements */
 /*************************/
@@ -289,26 +471,100 @@ void *array_range_check_c::visit(array_initial_elements_c *symbol) {
 void *array_range_check_c::visit(array_variable_c *symbol) {
 	check_dimension_count(symbol);
 	check_bounds(symbol);
+	/* the subscripted variable, and the subscripts, may themselves contain array variables (e.g. a[b[1]]) */
+	symbol->subscripted_variable->accept(*this);
+	symbol->subscript_list->accept(*this);
+	return NULL;
+}
+
+
+
+/********************************/
+/* B 3.2.4 Iteration Statements */
+/********************************/
+/*  FOR control_variable ASSIGN expression TO expression [BY expression] DO statement_list END_FOR */
+// SYM_REF5(for_statement_c, control_variable, beg_expression, end_expression, by_expression, statement_list)
+void *array_range_check_c::visit(for_statement_c *symbol) {
+	symbol->control_variable->accept(*this);
+	symbol->beg_expression->accept(*this);
+	symbol->end_expression->accept(*this);
+	if (NULL != symbol->by_expression) symbol->by_expression->accept(*this);
+
+	/* visit the body of the loop, knowing the range of the control variable (if we can determine it) */
+	control_variable_range_t range;
+	bool known_range = get_control_variable_range(symbol, range);
+	if (known_range) control_variable_ranges.push_back(range);
+	symbol->statement_list->accept(*this);
+	if (known_range) control_variable_ranges.pop_back();
 	return NULL;
 }
 
 
+/* The body of the loop is executed with the control variable taking values between the beg and end expressions,
+ * as long as:
+ *   - the loop limits and increment are constant (they are re-evaluated on every iteration);
+ *   - the control variable is only changed by the loop itself. Direct assignments inside the loop are
+ *     forbidden (see lvalue_check_c), but we must also exclude variables that may be accessed through other names
+ *     (VAR_IN_OUT, VAR_EXTERNAL, VAR_GLOBAL, located variables, and variables passed to REF());
+ *   - incrementing the control variable past the end expression does not overflow and wrap around.
+ */
+bool array_range_check_c::get_control_variable_range(for_statement_c *symbol, control_variable_range_t &range) {
+	if (typeid(*symbol->control_variable) != typeid(symbolic_variable_c)) return false;
+
+	int64_t beg, end, by = 1;
+	if (!VALID_CVALUE(int64, symbol->beg_expression) || !VALID_CVALUE(int64, symbol->end_expression)) return false;
+	if ((NULL != symbol->by_expression) && !VALID_CVALUE(int64, symbol->by_expression)) return false;
+	beg = GET_CVALUE(int64, symbol->beg_expression);
+	end = GET_CVALUE(int64, symbol->end_expression);
+	if (NULL != symbol->by_expression) by = GET_CVALUE(int64, symbol->by_expression);
+
+	token_c *var_name = get_var_name_c::get_name(symbol->control_variable);
+	if (!is_own_variable(symbol->control_variable)) return false;
+	if (referenced_variables.find(var_name->value) != referenced_variables.end()) return false;
+
+	int64_t type_lower, type_upper;
+	bool forceable;
+	if (!get_type_range(symbol->control_variable->datatype, type_lower, type_upper, forceable)) return false;
+	if ((by > 0) && (end > type_upper - by)) return false;
+	if ((by < 0) && (end < type_lower - by)) return false;
+
+	range.control_variable = var_name;
+	/* The loop tests (control_variable <= end) when the increment is positive, and (control_variable >= end) otherwise */
+	range.lower = (by > 0)? beg : end;
+	range.upper = (by > 0)? end : beg;
+	return true;
+}
+
+
 /**************************************/
 /* B 1.5 - Program organisation units */
 /**************************************/
+void array_range_check_c::enter_pou(symbol_c *pou_decl, symbol_c *body) {
+	search_varfb_instance_type = new search_varfb_instance_type_c(pou_decl);
+	search_var_instance_decl   = new search_var_instance_decl_c  (pou_decl);
+	find_referenced_variables_c find_referenced_variables(referenced_variables);
+	body->accept(find_referenced_variables);
+}
+
+
+void array_range_check_c::leave_pou(void) {
+	delete search_varfb_instance_type;
+	delete search_var_instance_decl;
+	search_varfb_instance_type = NULL;
+	search_var_instance_decl   = NULL;
+	referenced_variables.clear();
+}
+
+
 /***********************/
 /* B 1.5.1 - Functions */
 /***********************/
 // SYM_REF4(function_declaration_c, derived_function_name, type_name, var_declarations_list, function_body)
 void *array_range_check_c::visit(function_declaration_c *symbol) {
 	symbol->var_declarations_list->accept(*this); // required for visiting subrange_c
-	search_varfb_instance_type = new search_varfb_instance_type_c(symbol);
-	// search_var_instance_decl = new search_var_instance_decl_c(symbol);
+	enter_pou(symbol, symbol->function_body);
 	symbol->function_body->accept(*this);
-	delete search_varfb_instance_type;
-	// delete search_var_instance_decl;
-	search_varfb_instance_type = NULL;
-	// search_var_instance_decl = NULL;
+	leave_pou();
 	return NULL;
 }
 
@@ -318,13 +574,9 @@ void *array_range_check_c::visit(function_declaration_c *symbol) {
 // SYM_REF3(function_block_declaration_c, fblock_name, var_declarations, fblock_body)
 void *array_range_check_c::visit(function_block_declaration_c *symbol) {
 	symbol->var_declarations->accept(*this); // required for visiting subrange_c
-	search_varfb_instance_type = new search_varfb_instance_type_c(symbol);
-	// search_var_instance_decl = new search_var_instance_decl_c(symbol);
+	enter_pou(symbol, symbol->fblock_body);
 	symbol->fblock_body->accept(*this);
-	delete search_varfb_instance_type;
-	// delete search_var_instance_decl;
-	search_varfb_instance_type = NULL;
-	// search_var_instance_decl = NULL;
+	leave_pou();
 	return NULL;
 }
 
@@ -334,13 +586,9 @@ void *array_range_check_c::visit(function_block_declaration_c *symbol) {
 // SYM_REF3(program_declaration_c, program_type_name, var_declarations, function_block_body)
 void *array_range_check_c::visit(program_declaration_c *symbol) {
 	symbol->var_declarations->accept(*this); // required for visiting subrange_c
-	search_varfb_instance_type = new search_varfb_instance_type_c(symbol);
-	// search_var_instance_decl = new search_var_instance_decl_c(symbol);
+	enter_pou(symbol, symbol->function_block_body);
 	symbol->function_block_body->accept(*this);
-	delete search_varfb_instance_type;
-	// delete search_var_instance_decl;
-	search_varfb_instance_type = NULL;
-	// search_var_instance_decl = NULL;
+	leave_pou();
 	return NULL;
 }
 
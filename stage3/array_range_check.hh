@@ -31,7 +31,8 @@
  *
  */
 
-// #include <vector>
+#include <vector>
+#include <set>
 #include "../absyntax_utils/absyntax_utils.hh"
 // #include "datatype_functions.hh"
 
@@ -40,12 +41,27 @@
 class array_range_check_c: public iterator_visitor_c {
 
   private:
+    /* The values taken by the control variable of a FOR loop, while executing the loop's body */
+    typedef struct {
+      token_c *control_variable;
+      int64_t  lower;
+      int64_t  upper;
+    } control_variable_range_t;
+
     search_varfb_instance_type_c *search_varfb_instance_type;
+    search_var_instance_decl_c   *search_var_instance_decl;
+    std::vector<control_variable_range_t> control_variable_ranges; /* of the FOR loops we are currently in */
+    std::set<std::string>                 referenced_variables;    /* variables of the current POU whose address is taken with REF() */
     int error_count;
     int current_display_error_level;
 
     void check_dimension_count(array_variable_c *symbol);
     void check_bounds(array_variable_c *symbol);
+    bool get_range(symbol_c *expression, int64_t &lower, int64_t &upper, bool &forceable);
+    bool is_own_variable(symbol_c *variable);
+    bool get_control_variable_range(for_statement_c *symbol, control_variable_range_t &range);
+    void enter_pou(symbol_c *pou_decl, symbol_c *body);
+    void leave_pou(void);
 
   public:
     array_range_check_c(symbol_c *ignore);
@@ -73,6 +89,11 @@ class array_range_check_c: public iterator_visitor_c {
     /*************************************/
     void *visit(array_variable_c *symbol);
 
+    /********************************/
+    /* B 3.2.4 Iteration Statements */
+    /********************************/
+    void *visit(for_statement_c *symbol);
+
     /**************************************/
     /* B 1.5 - Program organisation units */
     /**************************************/
@@ -135,6 +135,25 @@
  *    Also at join source points we use a meet semilattice rules to merge current values between a block
  *    and adjacent block.
  *
+ * NOTE 4
+ *    The constant_propagation_c is run twice by stage 3.
+ *    The first run is done before the data type checking, and only propagates the values of the
+ *    CONSTANT variables (needed to determine the size of arrays declared with symbolic constants,
+ *    and the datatype of the literals).
+ *    The second run (propagate_variables = true) is done once the datatype of every expression is
+ *    known, and propagates the values assigned to variables inside the POU bodies. This second
+ *    run is flow sensitive:
+ *      - the branches of IF and CASE statements are analysed starting from the same values, and the
+ *        values at the end of the branches that may be executed are then merged (meet);
+ *      - the variables assigned inside a loop (or in an IL instruction list, or an SFC) are 
+ *        considered to not have a constant value inside and after the loop;
+ *      - the variables that may change value behind our back (VAR_IN_OUT, non constant VAR_GLOBAL 
+ *        and VAR_EXTERNAL, located variables, and variables whose address is taken with REF()) are
+ *        never propagated;
+ *      - the value of an expression whose result does not fit in its datatype is not propagated,
+ *        as the generated C code will not compute that same value.
+ *    Stage 4 uses the results to replace the variables by literals, and to remove dead branches.
+ *
  */
 
 #include "constant_folding.hh"
@@ -225,14 +244,14 @@
  * - any * non_const = non_const
  * - constant * constant = constant  (if equal)
  * - constant * constant = non_const (if not equal)
+ * NOTE: The values stored in the maps are never undefined (a variable whose value is not known is stored as non_const,
+ *       or not stored at all), so the first rule is never used, and overflow is handled as non_const.
  */
 #define COMPUTE_MEET_SEMILATTICE(dtype, c1, c2, resValue) {\
-		if (( c1._##dtype.get()  != c2._##dtype.get() && c2._##dtype.is_valid() && c1._##dtype.is_valid()) ||\
-		    ( c1._##dtype.is_nonconst() && c2._##dtype.is_valid() ) ||\
-		    ( c2._##dtype.is_nonconst() && c1._##dtype.is_valid() )) {\
-			resValue._##dtype.set_nonconst();\
-		} else {\
+		if (c1._##dtype.is_valid() && c2._##dtype.is_valid() && (c1._##dtype.get() == c2._##dtype.get())) {\
 			resValue._##dtype.set(c1._##dtype.get());\
+		} else {\
+			resValue._##dtype.set_nonconst();\
 		}\
 }
 
@@ -592,18 +611,18 @@ static void CHECK_OVERFLOW_real64(symbol_c *res_ptr) {
 /***********************************************************************/
 
 
-/* TODO: FIXME !!!!!
- *   The following operation is wrong - it does not handle the comparisons of all possible datatypes correctly.
- *   The result of comparig the bool, int64, and uint64 are overwritten by the comparison of the real64 type!
+/* The comparison produces a single (bool) result, so we compare the first datatype in which both
+ * operands have a valid const value (the integer datatypes before real64, as these may have been rounded).
  */
 /* static void *handle_cmp(symbol_c *symbol, symbol_c *oper1, symbol_c *oper2, OPERATION) */
-#define handle_cmp(symbol, oper1, oper2, operation) {               \
-	if ((NULL == oper1) || (NULL == oper2)) return NULL;        \
-	DO_BINARY_OPER(  bool, operation, bool, oper1, oper2);     \
-	DO_BINARY_OPER(uint64, operation, bool, oper1, oper2);     \
-	DO_BINARY_OPER( int64, operation, bool, oper1, oper2);     \
-	DO_BINARY_OPER(real64, operation, bool, oper1, oper2);     \
-	return NULL;                                                \
+#define handle_cmp(symbol, oper1, oper2, operation) {                                                                                                   \
+	if ((NULL == oper1) || (NULL == oper2)) return NULL;                                                                                          \
+	if      (VALID_CVALUE(  bool, oper1) && VALID_CVALUE(  bool, oper2)) {SET_CVALUE(bool, symbol, GET_CVALUE(  bool, oper1) operation GET_CVALUE(  bool, oper2));} \
+	else if (VALID_CVALUE( int64, oper1) && VALID_CVALUE( int64, oper2)) {SET_CVALUE(bool, symbol, GET_CVALUE( int64, oper1) operation GET_CVALUE( int64, oper2));} \
+	else if (VALID_CVALUE(uint64, oper1) && VALID_CVALUE(uint64, oper2)) {SET_CVALUE(bool, symbol, GET_CVALUE(uint64, oper1) operation GET_CVALUE(uint64, oper2));} \
+	else if (VALID_CVALUE(real64, oper1) && VALID_CVALUE(real64, oper2)) {SET_CVALUE(bool, symbol, GET_CVALUE(real64, oper1) operation GET_CVALUE(real64, oper2));} \
+	else                                                                 {SET_NONCONST(bool, symbol);}                                            \
+	return NULL;                                                                                                                                  \
 }
 
 
@@ -1235,28 +1254,217 @@ void *constant_folding_c::visit(   not_expression_c *symbol) {symbol->  exp->acc
 /***********************************************************************/
 
 
-constant_propagation_c::constant_propagation_c(symbol_c *symbol)
+/* Collect the variables that may be written to by some code (assignments, FOR loops, output parameters of
+ * function and FB calls, IL ST/STN/S/R instructions, SFC action associations), and the variables whose
+ * address is taken with REF().
+ * The parameters of the function and FB calls are only handled when find_assigned is true, as these
+ * rely on the called_function_declaration and called_fb_declaration annotations, which are only
+ * set by the type safety analysis (the first constant propagation is run before it).
+ */
+class assigned_variables_c: public iterator_visitor_c {
+  public:
+    std::vector<symbol_c *> assigned;   /* the symbolic_variable_c (or identifier_c) that may be written to */
+    std::vector<symbol_c *> referenced; /* the symbolic_variable_c whose address is taken */
+
+    assigned_variables_c(bool find_assigned) {this->find_assigned = find_assigned;}
+
+  private:
+    bool find_assigned;
+
+    static void add(std::vector<symbol_c *> &list, symbol_c *variable) {
+      if (   (NULL != dynamic_cast<symbolic_variable_c *>(variable))
+          || (NULL != dynamic_cast<identifier_c        *>(variable)))
+        list.push_back(variable);
+    }
+
+    /* in_out parameters may be passed to a POU with ':=', and output parameters may also be passed non formally,
+     * so we consider that every variable passed to a POU that has such parameters may be changed by that POU.
+     */
+    static bool has_written_params(symbol_c *pou_decl, bool nonformal) {
+      if (NULL == pou_decl) return true; // play it safe!
+      function_param_iterator_c fp_iterator(pou_decl);
+      while (NULL != fp_iterator.next()) {
+        /* extensible parameters are always input parameters, and the iterator would never stop returning them! */
+        if (fp_iterator.is_extensible_param()) break;
+        if (fp_iterator.param_direction() == function_param_iterator_c::direction_inout)             return true;
+        if (fp_iterator.param_direction() == function_param_iterator_c::direction_out && nonformal) return true;
+      }
+      return false;
+    }
+
+    void add_params(symbol_c *param_list, symbol_c *pou_decl, bool nonformal) {
+      list_c *list = dynamic_cast<list_c *>(param_list);
+      if ((NULL == list) || !find_assigned || !has_written_params(pou_decl, nonformal)) return;
+      for (int i = 0; i < list->n; i++) {
+        symbol_c *param = list->get_element(i);
+        input_variable_param_assignment_c *st_param = dynamic_cast<input_variable_param_assignment_c *>(param);
+        il_param_assignment_c             *il_param = dynamic_cast<il_param_assignment_c             *>(param);
+        if (NULL != st_param) param = st_param->expression;
+        if (NULL != il_param) param = il_param->il_operand;
+        add(assigned, param);
+      }
+    }
+
+  public:
+    void *visit(ref_expression_c                   *symbol) {add(referenced, symbol->exp);              return iterator_visitor_c::visit(symbol);}
+    void *visit(assignment_statement_c             *symbol) {add(assigned,   symbol->l_exp);            return iterator_visitor_c::visit(symbol);}
+    void *visit(for_statement_c                    *symbol) {add(assigned,   symbol->control_variable); return iterator_visitor_c::visit(symbol);}
+    void *visit(output_variable_param_assignment_c *symbol) {add(assigned,   symbol->variable);         return iterator_visitor_c::visit(symbol);}
+    void *visit(il_param_out_assignment_c          *symbol) {add(assigned,   symbol->variable);         return iterator_visitor_c::visit(symbol);}
+    void *visit(action_association_c               *symbol) {add(assigned,   symbol->action_name);      return iterator_visitor_c::visit(symbol);}
+
+    void *visit(function_invocation_c *symbol) {
+      add_params(symbol->formal_param_list,    symbol->called_function_declaration, false);
+      add_params(symbol->nonformal_param_list, symbol->called_function_declaration, true);
+      return iterator_visitor_c::visit(symbol);
+    }
+    void *visit(fb_invocation_c *symbol) {
+      add_params(symbol->formal_param_list,    symbol->called_fb_declaration, false);
+      add_params(symbol->nonformal_param_list, symbol->called_fb_declaration, true);
+      return iterator_visitor_c::visit(symbol);
+    }
+    void *visit(il_function_call_c *symbol) {
+      add_params(symbol->il_operand_list,      symbol->called_function_declaration, true);
+      return iterator_visitor_c::visit(symbol);
+    }
+    void *visit(il_formal_funct_call_c *symbol) {
+      add_params(symbol->il_param_list,        symbol->called_function_declaration, false);
+      return iterator_visitor_c::visit(symbol);
+    }
+    void *visit(il_fb_call_c *symbol) {
+      add_params(symbol->il_operand_list,      symbol->called_fb_declaration, true);
+      add_params(symbol->il_param_list,        symbol->called_fb_declaration, false);
+      return iterator_visitor_c::visit(symbol);
+    }
+    void *visit(il_simple_operation_c *symbol) {
+      symbol_c *il_operator = symbol->il_simple_operator;
+      if (   (NULL != dynamic_cast<ST_operator_c  *>(il_operator)) || (NULL != dynamic_cast<STN_operator_c *>(il_operator))
+          || (NULL != dynamic_cast<S_operator_c   *>(il_operator)) || (NULL != dynamic_cast<R_operator_c   *>(il_operator))
+          || (NULL != dynamic_cast<S1_operator_c  *>(il_operator)) || (NULL != dynamic_cast<R1_operator_c  *>(il_operator)))
+        add(assigned, symbol->il_operand);
+      return iterator_visitor_c::visit(symbol);
+    }
+};
+
+
+static const char *get_assigned_var_name(symbol_c *variable) {
+  symbolic_variable_c *symbolic_variable = dynamic_cast<symbolic_variable_c *>(variable);
+  token_c             *token             = dynamic_cast<token_c             *>(variable);
+  if (NULL != symbolic_variable) token = get_var_name_c::get_name(symbolic_variable->var_name);
+  if (NULL == token) ERROR;
+  return token->value;
+}
+
+
+static const_value_c nonconst_value(void) {
+  const_value_c value;
+  value. _int64.set_nonconst();
+  value._uint64.set_nonconst();
+  value._real64.set_nonconst();
+  value.  _bool.set_nonconst();
+  return value;
+}
+
+
+/* Get the range of values that may be stored in an integer (or bit string) datatype. Returns false if not an integer datatype. */
+static bool get_integer_range(symbol_c *datatype, int64_t *min, uint64_t *max) {
+  if (NULL == datatype) return false;
+  #ifdef __INTEGER_RANGE__
+    #error __INTEGER_RANGE__ macro already exists. Choose another name!
+  #endif
+  #define __INTEGER_RANGE__(type_name, min_value, max_value)                                                              \
+    if ((typeid(*datatype) == typeid(type_name##_type_name_c)) || (typeid(*datatype) == typeid(safe##type_name##_type_name_c))) \
+      {*min = min_value; *max = max_value; return true;}
+  __INTEGER_RANGE__( sint,  INT8_MIN,  INT8_MAX);
+  __INTEGER_RANGE__(  int, INT16_MIN, INT16_MAX);
+  __INTEGER_RANGE__( dint, INT32_MIN, INT32_MAX);
+  __INTEGER_RANGE__( lint, INT64_MIN, INT64_MAX);
+  __INTEGER_RANGE__(usint,         0,  UINT8_MAX);
+  __INTEGER_RANGE__( uint,         0, UINT16_MAX);
+  __INTEGER_RANGE__(udint,         0, UINT32_MAX);
+  __INTEGER_RANGE__(ulint,         0, UINT64_MAX);
+  __INTEGER_RANGE__( byte,         0,  UINT8_MAX);
+  __INTEGER_RANGE__( word,         0, UINT16_MAX);
+  __INTEGER_RANGE__(dword,         0, UINT32_MAX);
+  __INTEGER_RANGE__(lword,         0, UINT64_MAX);
+  #undef __INTEGER_RANGE__
+  return false;
+}
+
+
+static bool is_lreal(symbol_c *datatype) {
+  if (NULL == datatype) return false;
+  return ((typeid(*datatype) == typeid(lreal_type_name_c)) || (typeid(*datatype) == typeid(safelreal_type_name_c)));
+}
+
+
+/* The const values are computed using 64 bit integers and doubles, while the generated C code computes them
+ * using the datatype of each expression. Remove the values the generated code would not compute.
+ */
+static void fit_to_datatype(const_value_c &value, symbol_c *datatype) {
+  int64_t  min;
+  uint64_t max;
+  if (get_integer_range(datatype, &min, &max)) {
+    if (value. _int64.is_valid() && ((value._int64.get() < min) || ((value._int64.get() >= 0) && ((uint64_t)value._int64.get() > max))))
+      value. _int64.set_nonconst();
+    if (value._uint64.is_valid() && (value._uint64.get() > max))
+      value._uint64.set_nonconst();
+  }
+  if (get_datatype_info_c::is_ANY_REAL_compatible(datatype) && !is_lreal(datatype))
+    value._real64.set_nonconst(); // REAL is computed with 32 bit floats
+}
+
+
+/* The value of a variable we may propagate, given the value stored in the values[] map.
+ * We only propagate the values of variables of the elementary BOOL, ANY_INT, ANY_BIT and LREAL datatypes,
+ * and only in the channels (int64, uint64, real64, bool) that make sense for the variable's datatype.
+ * Note that subranges are excluded, as the generated C code limits the value stored in the variable.
+ */
+static const_value_c get_var_value(const_value_c stored_value, symbol_c *datatype) {
+  const_value_c value = nonconst_value();
+  int64_t  min;
+  uint64_t max;
+  if (get_datatype_info_c::is_BOOL_compatible(datatype)) {
+    if (stored_value._bool.is_valid())    value._bool = stored_value._bool;
+  } else if (get_integer_range(datatype, &min, &max)) {
+    if (stored_value. _int64.is_valid())  value. _int64 = stored_value. _int64;
+    if (stored_value._uint64.is_valid())  value._uint64 = stored_value._uint64;
+    fit_to_datatype(value, datatype);
+  } else if (is_lreal(datatype)) {
+    if (stored_value._real64.is_valid())  value._real64 = stored_value._real64;
+  }
+  return value;
+}
+
+
+constant_propagation_c::constant_propagation_c(symbol_c *symbol, bool propagate_variables)
   : constant_folding_c(symbol) {
     current_resource = NULL;
     current_configuration = NULL;
     fixed_init_value_ = false;
+    untracked_var_decl_ = false;
     function_pou_ = false;
     values = NULL;
+    untracked_vars = NULL;
+    propagate_variables_ = propagate_variables;
+    dead_code_ = false;
   }
 
 
 constant_propagation_c::~constant_propagation_c(void) {}
 
 
-static constant_propagation_c::map_values_t inner_left_join_values(constant_propagation_c::map_values_t m1, constant_propagation_c::map_values_t m2) {
-	constant_propagation_c::map_values_t::const_iterator itr;
-	constant_propagation_c::map_values_t ret;
+/* Returns the values of the variables that have a known value in both maps (i.e. both paths) */
+constant_propagation_c::map_values_t constant_propagation_c::inner_left_join_values(map_values_t m1, map_values_t m2) {
+	map_values_t::const_iterator itr;
+	map_values_t ret;
 
 	itr = m1.begin();
 	for ( ; itr != m1.end(); ++itr) {
 		std::string name = itr->first;
 		const_value_c value;
 
+		/* A variable missing from one of the maps has an unknown value in that path, so we leave it out of the result */
 		if (m2.count(name) > 0) {
 			const_value_c c1 = itr->second;
 			const_value_c c2 = m2[name];
@@ -1264,14 +1472,50 @@ static constant_propagation_c::map_values_t inner_left_join_values(constant_prop
 			COMPUTE_MEET_SEMILATTICE (uint64, c1, c2, value);
 			COMPUTE_MEET_SEMILATTICE ( int64, c1, c2, value);
 			COMPUTE_MEET_SEMILATTICE (  bool, c1, c2, value);
-		} else
-			value = m1[name];
-		ret[name] = value;
+			ret[name] = value;
+		}
 	}
 
 	return ret;
 }
 
+
+/* Store the value assigned to a variable in the values[] map */
+void constant_propagation_c::set_var_value(symbol_c *variable, const_value_c value) {
+	/* The variable being assigned does not have the assigned value before the assignment, so it must
+	 * not be annotated with a const value (stage4 would otherwise replace the variable by a literal!)
+	 */
+	variable->const_value = nonconst_value();
+	/* Only simple variables are tracked (i.e. not array elements nor structure elements) */
+	symbolic_variable_c *symbolic_variable = dynamic_cast<symbolic_variable_c *>(variable);
+	if (NULL == symbolic_variable) return;
+	std::string varName = get_var_name_c::get_name(symbolic_variable->var_name)->value;
+	if ((NULL != untracked_vars) && (untracked_vars->count(varName) > 0)) return;
+	(*values)[varName] = value;
+}
+
+
+/* The variables that may be written to by the code can no longer be considered to have a constant value */
+void constant_propagation_c::kill_assigned_vars(symbol_c *code) {
+	assigned_variables_c assigned_variables(true);
+	code->accept(assigned_variables);
+	for (unsigned int i = 0; i < assigned_variables.assigned.size(); i++) {
+		(*values)[get_assigned_var_name(assigned_variables.assigned[i])] = nonconst_value();
+		assigned_variables.assigned[i]->const_value = nonconst_value();
+	}
+}
+
+
+/* Variables whose address is taken may be changed (through the pointer) anywhere in the POU,
+ * so we never propagate their values.
+ */
+void constant_propagation_c::untrack_referenced_vars(symbol_c *code) {
+	assigned_variables_c assigned_variables(false);
+	code->accept(assigned_variables);
+	for (unsigned int i = 0; i < assigned_variables.referenced.size(); i++)
+		(*untracked_vars)[get_assigned_var_name(assigned_variables.referenced[i])] = true;
+}
+
 /***************************/
 /* B 0 - Programming Model */
 /***************************/
@@ -1390,9 +1634,16 @@ void *constant_propagation_c::visit(library_c *symbol) {
 /*********************/
 #if DO_CONSTANT_PROPAGATION__
 void *constant_propagation_c::visit(symbolic_variable_c *symbol) {
+	if (!propagate_variables_) return NULL;
+	/* NOTE: a variable that is not in the values[] map has an unknown value. We must set it as non_const
+	 *       (and not leave it undefined) since the same POU may be visited more than once.
+	 */
 	std::string varName = get_var_name_c::get_name(symbol->var_name)->value;
+	symbol->const_value = nonconst_value();
+	if (dead_code_ || (NULL == values))                                        return NULL;
+	if ((NULL != untracked_vars) && (untracked_vars->count(varName) > 0))      return NULL;
 	if (values->count(varName) > 0) 
-		symbol->const_value = (*values)[varName];
+		symbol->const_value = get_var_value((*values)[varName], symbol->datatype);
 	return NULL;
 }
 #endif  // DO_CONSTANT_PROPAGATION__
@@ -1409,10 +1660,12 @@ void *constant_propagation_c::visit(symbolic_constant_c *symbol) {
 /* B 1.4.3 - Declaration & Initialisation */
 /******************************************/
   
-void *constant_propagation_c::handle_var_decl(symbol_c *var_list, bool fixed_init_value) {
-  fixed_init_value_ = fixed_init_value;
+void *constant_propagation_c::handle_var_decl(symbol_c *var_list, bool fixed_init_value, bool untracked_var) {
+  fixed_init_value_   = fixed_init_value;
+  untracked_var_decl_ = untracked_var;
   var_list->accept(*this); 
-  fixed_init_value_ = false; 
+  fixed_init_value_   = false; 
+  untracked_var_decl_ = false; 
   return NULL;
 }
 
@@ -1459,10 +1712,17 @@ void *constant_propagation_c::handle_var_list_decl(symbol_c *var_list, symbol_c
   
   // Handle the situation (2) mentioned above, i.e. handle the instantiation of non-FB variables. 
   // --------------------------------------------------------------------------------------------
+  list_c *list = dynamic_cast<list_c *>(var_list);
+  if (untracked_var_decl_ && (NULL != untracked_vars) && (NULL != list)) {
+    for (int i = 0; i < list->n; i++) {
+      token_c *var_name = dynamic_cast<token_c *>(list->get_element(i));
+      if (NULL != var_name) (*untracked_vars)[var_name->value] = true;
+    }
+  }
+
   if (NULL == init_value)   {return NULL;} // this is some datatype for which no initial value exists! Do nothing and return.
   init_value->accept(*this); // necessary when handling default initial values, that were not constant folded in the call type_decl->accept(*this)
   
-  list_c *list = dynamic_cast<list_c *>(var_list);
   if (NULL == list) ERROR;
   for (int i = 0; i < list->n; i++) {
     token_c *var_name = dynamic_cast<token_c *>(list->get_element(i));
@@ -1546,7 +1806,8 @@ void *constant_propagation_c::visit(output_declarations_c *symbol) {return handl
 //SYM_REF1(input_output_declarations_c, var_declaration_list)
 // NOTE: Input variables can take any initial value, so we can not set the const_value annotation => we set fixed_init_value to false !!!
 //       We must still visit it iteratively, to set the const_value of all literals in the type declarations.
-void *constant_propagation_c::visit(input_output_declarations_c *symbol) {return handle_var_decl(symbol->var_declaration_list, false);}
+// NOTE: In/Out variables may also be changed through the variable passed as a parameter => we never propagate their values!
+void *constant_propagation_c::visit(input_output_declarations_c *symbol) {return handle_var_decl(symbol->var_declaration_list, false, true);}
 
 /* helper symbol for input_output_declarations */
 /* var_declaration_list var_declaration ';' */
@@ -1561,7 +1822,7 @@ void *constant_propagation_c::visit(input_output_declarations_c *symbol) {return
 /* VAR [CONSTANT] var_init_decl_list END_VAR */
 /* option -> may be NULL ! */
 //SYM_REF2(var_declarations_c, option, var_init_decl_list)
-void *constant_propagation_c::visit(var_declarations_c *symbol) {return handle_var_decl(symbol->var_init_decl_list, false);}
+void *constant_propagation_c::visit(var_declarations_c *symbol) {return handle_var_decl(symbol->var_init_decl_list, is_constant(symbol->option));}
 
 /*  VAR RETAIN var_init_decl_list END_VAR */
 //SYM_REF1(retentive_var_declarations_c, var_init_decl_list)             // Not needed since we inherit from iterator_visitor_c!
@@ -1577,10 +1838,17 @@ SYM_REF2(located_var_declarations_c, option, located_var_decl_list)
 /* helper symbol for located_var_declarations */
 /* located_var_decl_list located_var_decl ';' */
 SYM_LIST(located_var_decl_list_c)
+#endif
+
 /*  [variable_name] location ':' located_var_spec_init */
 /* variable_name -> may be NULL ! */
-SYM_REF3(located_var_decl_c, variable_name, location, located_var_spec_init)
-#endif
+//SYM_REF3(located_var_decl_c, variable_name, location, located_var_spec_init)
+// NOTE: Located variables may be changed by the I/O (or through another variable located at the same address) => we never propagate their values!
+void *constant_propagation_c::visit(located_var_decl_c *symbol) {
+  if ((NULL != symbol->variable_name) && (NULL != untracked_vars))
+    (*untracked_vars)[get_var_name_c::get_name(symbol->variable_name)->value] = true;
+  return iterator_visitor_c::visit(symbol);
+}
 
 /*| VAR_EXTERNAL [CONSTANT] external_declaration_list END_VAR */
 /* option -> may be NULL ! */
@@ -1627,6 +1895,9 @@ void *constant_propagation_c::visit(external_declaration_c *symbol) {
   if (fixed_init_value_) {
 //  (*values)[symbol->global_var_name->get_value()] = symbol->specification->const_value;
     (*values)[get_var_name_c::get_name(symbol->global_var_name)->value] = symbol->specification->const_value;
+  } else if (NULL != untracked_vars) {
+    // non constant global variables may be changed by any other POU => we never propagate their values!
+    (*untracked_vars)[get_var_name_c::get_name(symbol->global_var_name)->value] = true;
   }
   // If the datatype specification is a subrange or array, do constant folding of all the literals in that type declaration... (ex: literals in array subrange limits)
   symbol->specification->accept(*this);  // should never get to change the const_value of the symbol->specification symbol (only its children!).
@@ -1656,7 +1927,7 @@ void *constant_propagation_c::visit(external_declaration_c *symbol) {
  * Nevertheless, since constant folding is idem-potent, it is simpler to just call handle_var_decl() instead
  * of writing some code specific for this situation!
  */
-void *constant_propagation_c::visit(global_var_declarations_c *symbol) {return handle_var_decl(symbol->global_var_decl_list, is_constant(symbol->option));}
+void *constant_propagation_c::visit(global_var_declarations_c *symbol) {return handle_var_decl(symbol->global_var_decl_list, is_constant(symbol->option), !is_constant(symbol->option));}
 
 
 /* helper symbol for global_var_declarations */
@@ -1740,18 +2011,23 @@ SYM_LIST(var_init_decl_list_c)
 //SYM_REF4(function_declaration_c, derived_function_name, type_name, var_declarations_list, function_body, enumvalue_symtable_t enumvalue_symtable;)
 void *constant_propagation_c::visit(function_declaration_c *symbol) {
 	map_values_t local_values, *prev_pou_values;
+	map_names_t  local_untracked_vars, *prev_untracked_vars;
 	prev_pou_values = values; // store the current values map of whoever called this Function (a program, configuration, or resource)
 	values = &local_values;
+	prev_untracked_vars = untracked_vars;
+	untracked_vars = &local_untracked_vars;
 	var_global_values.push(); /* Create inner scope - Not really needed, but do it just to be consistent. */
 
 	/* Add initial value of all declared variables into Values map. */
 	function_pou_ = true;
 	symbol->var_declarations_list->accept(*this);
 	function_pou_ = false;
+	untrack_referenced_vars(symbol->function_body);
 	symbol->function_body->accept(*this);
 
 	var_global_values.pop(); /* Delete inner scope */
 	values = prev_pou_values;
+	untracked_vars = prev_untracked_vars;
 	return NULL;
 }
 
@@ -1780,17 +2056,22 @@ void *constant_propagation_c::visit(function_var_decls_c *symbol) {return handle
 //SYM_REF3(function_block_declaration_c, fblock_name, var_declarations, fblock_body, enumvalue_symtable_t enumvalue_symtable;)
 void *constant_propagation_c::visit(function_block_declaration_c *symbol) {
 	map_values_t local_values, *prev_pou_values;
+	map_names_t  local_untracked_vars, *prev_untracked_vars;
 	prev_pou_values = values; // store the current values map of whoever instantited this FB (a program, configuration, or resource)
 	values = &local_values;
+	prev_untracked_vars = untracked_vars;
+	untracked_vars = &local_untracked_vars;
 	var_global_values.push(); /* Create inner scope */
 
 	/* Add initial value of all declared variables into Values map. */
 	function_pou_ = false;
 	symbol->var_declarations->accept(*this);
+	untrack_referenced_vars(symbol->fblock_body);
 	symbol->fblock_body->accept(*this);
 
 	var_global_values.pop(); /* Delete inner scope */
 	values = prev_pou_values;
+	untracked_vars = prev_untracked_vars;
 	return NULL;
 }
 
@@ -1814,21 +2095,49 @@ void *constant_propagation_c::visit(non_retentive_var_decls_c *symbol) {return h
 //SYM_REF3(program_declaration_c, program_type_name, var_declarations, function_block_body, enumvalue_symtable_t enumvalue_symtable;)
 void *constant_propagation_c::visit(program_declaration_c *symbol) {
 	map_values_t local_values, *prev_pou_values;
+	map_names_t  local_untracked_vars, *prev_untracked_vars;
 	prev_pou_values = values; // store the current values map of whoever instantited this Program (a configuration, or resource)
 	values = &local_values;
+	prev_untracked_vars = untracked_vars;
+	untracked_vars = &local_untracked_vars;
 	var_global_values.push(); /* Create inner scope */
 
 	/* Add initial value of all declared variables into Values map. */
 	function_pou_ = false;
 	symbol->var_declarations->accept(*this);
+	untrack_referenced_vars(symbol->function_block_body);
 	symbol->function_block_body->accept(*this);
 
 	var_global_values.pop(); /* Delete inner scope */
 	values = prev_pou_values;
+	untracked_vars = prev_untracked_vars;
 	return NULL;
 }
 
 
+/*********************************************/
+/* B.1.6  Sequential function chart elements */
+/*********************************************/
+#if DO_CONSTANT_PROPAGATION__
+/* The steps, transitions and actions of a chart are executed in an order that depends on the state of
+ * the chart, so each one is analysed with the values that are known no matter that order (i.e. the
+ * variables assigned anywhere in the chart have an unknown value).
+ */
+void *constant_propagation_c::visit(sequential_function_chart_c *symbol) {
+	if (!propagate_variables_) return iterator_visitor_c::visit(symbol);
+
+	kill_assigned_vars(symbol);
+	map_values_t values_chart = *values;
+	for (int i = 0; i < symbol->n; i++) {
+		*values = values_chart;
+		symbol->get_element(i)->accept(*this);
+	}
+	*values = values_chart;
+	return NULL;
+}
+#endif  // DO_CONSTANT_PROPAGATION__
+
+
 /********************************/
 /* B 1.7 Configuration elements */
 /********************************/
@@ -1846,7 +2155,9 @@ END_CONFIGURATION
 //          enumvalue_symtable_t enumvalue_symtable; localvar_symbmap_t localvar_symbmap; localvar_symbvec_t localvar_symbvec;)
 void *constant_propagation_c::visit(configuration_declaration_c *symbol) {
 	map_values_t local_values;
+	map_names_t  local_untracked_vars;
 	values = &local_values;
+	untracked_vars = &local_untracked_vars;
 	var_global_values.clear(); /* Clear global variables map */
 
 	/* Add initial value of all declared variables into Values map. */
@@ -1856,6 +2167,7 @@ void *constant_propagation_c::visit(configuration_declaration_c *symbol) {
 	current_configuration = NULL;
 
 	values = NULL;
+	untracked_vars = NULL;
 	return NULL;
 }
 
@@ -1979,6 +2291,24 @@ void *constant_propagation_c::visit(fb_task_c *symbol) {
 
 
 
+/****************************************/
+/* B.2 - Language IL (Instruction List) */
+/****************************************/
+/***********************************/
+/* B 2.1 Instructions and Operands */
+/***********************************/
+#if DO_CONSTANT_PROPAGATION__
+/* Jumps may change the order in which IL instructions are executed, so we only propagate the values
+ * of the variables that are not assigned anywhere in the instruction list.
+ */
+void *constant_propagation_c::visit(instruction_list_c *symbol) {
+	if (propagate_variables_) kill_assigned_vars(symbol);
+	return iterator_visitor_c::visit(symbol);
+}
+#endif  // DO_CONSTANT_PROPAGATION__
+
+
+
 /***************************************/
 /* B.3 - Language ST (Structured Text) */
 /***************************************/
@@ -1986,123 +2316,180 @@ void *constant_propagation_c::visit(fb_task_c *symbol) {
 /* B 3.1 - Expressions */
 /***********************/
 #if DO_CONSTANT_PROPAGATION__
-/* TODO: handle function invocations... */
-// void *fill_candidate_datatypes_c::visit(function_invocation_c *symbol) {}
+void *constant_propagation_c::handle_expression(symbol_c *symbol) {
+	if (propagate_variables_) fit_to_datatype(symbol->const_value, symbol->datatype);
+	return NULL;
+}
+
+/* Variables whose address is taken are never propagated (see untrack_referenced_vars()), and REF() itself is never a constant */
+void *constant_propagation_c::visit(   ref_expression_c *symbol) {symbol->exp->accept(*this); if (propagate_variables_) symbol->const_value = nonconst_value(); return NULL;}
+void *constant_propagation_c::visit(   add_expression_c *symbol) {constant_folding_c::visit(symbol); return handle_expression(symbol);}
+void *constant_propagation_c::visit(   sub_expression_c *symbol) {constant_folding_c::visit(symbol); return handle_expression(symbol);}
+void *constant_propagation_c::visit(   mul_expression_c *symbol) {constant_folding_c::visit(symbol); return handle_expression(symbol);}
+void *constant_propagation_c::visit(   div_expression_c *symbol) {constant_folding_c::visit(symbol); return handle_expression(symbol);}
+void *constant_propagation_c::visit(   mod_expression_c *symbol) {constant_folding_c::visit(symbol); return handle_expression(symbol);}
+void *constant_propagation_c::visit( power_expression_c *symbol) {constant_folding_c::visit(symbol); return handle_expression(symbol);}
+void *constant_propagation_c::visit(   neg_expression_c *symbol) {constant_folding_c::visit(symbol); return handle_expression(symbol);}
+void *constant_propagation_c::visit(   not_expression_c *symbol) {constant_folding_c::visit(symbol); return handle_expression(symbol);}
+
+/* We do not (yet) evaluate function calls, but we must take into account the variables they may change (output and in_out parameters). */
+void *constant_propagation_c::visit(function_invocation_c *symbol) {
+	iterator_visitor_c::visit(symbol);
+	if (!propagate_variables_) return NULL;
+	symbol->const_value = nonconst_value();
+	kill_assigned_vars(symbol);
+	return NULL;
+}
 
 
 /*********************************/
 /* B 3.2.1 Assignment Statements */
 /*********************************/
 void *constant_propagation_c::visit(assignment_statement_c *symbol) {
-	std::string varName;
-
 	symbol->r_exp->accept(*this);
 	symbol->l_exp->accept(*this); // if the lvalue has an array, do contant folding of the array indexes!
-	symbol->l_exp->const_value = symbol->r_exp->const_value;
-	(*values)[get_var_name_c::get_name(symbol->l_exp)->value] = symbol->l_exp->const_value;
+	if (propagate_variables_)
+		set_var_value(symbol->l_exp, symbol->r_exp->const_value);
+	return NULL;
+}
+
+
+/*****************************************/
+/* B 3.2.2 Subprogram Control Statements */
+/*****************************************/
+void *constant_propagation_c::visit(fb_invocation_c *symbol) {
+	iterator_visitor_c::visit(symbol);
+	if (propagate_variables_) kill_assigned_vars(symbol);
 	return NULL;
 }
 
+
 /********************************/
 /* B 3.2.3 Selection Statements */
 /********************************/
+/* The conditions are evaluated in sequence (a condition is only evaluated if all previous conditions are FALSE),
+ * and each branch is analysed starting with the values after evaluating its condition.
+ * Branches whose condition is always FALSE, and those following a condition that is always TRUE, are dead code.
+ * The result is the meet of the values at the end of all branches that may be executed.
+ */
 void *constant_propagation_c::visit(if_statement_c *symbol) {
-	map_values_t values_incoming;
-	map_values_t values_statement_result;
-	map_values_t values_elsestatement_result;
-	map_values_t::iterator itr;
+	if (!propagate_variables_) return iterator_visitor_c::visit(symbol);
+
+	map_values_t values_result;
+	bool prev_dead_code = dead_code_;
+	bool live_result    = false; // values_result contains the values at the end of at least one branch that may be executed
+	bool taken          = false; // a previous condition is always TRUE, so the remaining branches are never executed
+	list_c *elseif_list = dynamic_cast<list_c *>(symbol->elseif_statement_list);
+	int     elseif_n    = (NULL == elseif_list)? 0 : elseif_list->n;
+
+	for (int i = -1; i <= elseif_n; i++) {
+		symbol_c *condition, *statement_list;
+		if        (i <  0) {
+			condition = symbol->expression;  statement_list = symbol->statement_list;
+		} else if (i == elseif_n) {
+			condition = NULL;                statement_list = symbol->else_statement_list;  // may be NULL!
+		} else {
+			elseif_statement_c *elseif = dynamic_cast<elseif_statement_c *>(elseif_list->get_element(i));
+			if (NULL == elseif) ERROR;
+			condition = elseif->expression;  statement_list = elseif->statement_list;
+		}
+
+		dead_code_ = prev_dead_code || taken;
+		bool dead_branch = dead_code_;
+		if (NULL != condition) {
+			condition->accept(*this);
+			if (VALID_CVALUE(bool, condition) && !GET_CVALUE(bool, condition)) dead_branch = true;
+		}
+		map_values_t values_condition = *values;
+		dead_code_ = dead_branch;
+		if (NULL != statement_list) statement_list->accept(*this);
+		if (!dead_branch) {
+			values_result = live_result? inner_left_join_values(values_result, *values) : *values;
+			live_result   = true;
+		}
+		*values = values_condition;
+		if ((NULL != condition) && !dead_branch && VALID_CVALUE(bool, condition) && GET_CVALUE(bool, condition))
+			taken = true;
+	}
 
-	/* Optimize dead code */
-	symbol->expression->accept(*this);
-	if (VALID_CVALUE(bool, symbol->expression) && GET_CVALUE(bool, symbol->expression) == false)
-		return NULL;
+	dead_code_ = prev_dead_code;
+	if (live_result) *values = values_result;
+	return NULL;
+}
 
-	values_incoming = values; /* save incoming status */
-	symbol->statement_list->accept(*this);
-	values_statement_result = values;
-	if (NULL != symbol->else_statement_list) {
-		values = values_incoming;
-		symbol->else_statement_list->accept(*this);
-		values_elsestatement_result = values;
-	} else
-		values_elsestatement_result = values_incoming;
-	values = inner_left_join_values(values_statement_result, values_elsestatement_result);
 
+void *constant_propagation_c::visit(case_statement_c *symbol) {
+	if (!propagate_variables_) return iterator_visitor_c::visit(symbol);
+
+	symbol->expression->accept(*this);
+	map_values_t values_incoming = *values;
+	/* When there is no ELSE, none of the case elements may be executed */
+	map_values_t values_result   = values_incoming;
+
+	list_c *case_element_list = dynamic_cast<list_c *>(symbol->case_element_list);
+	for (int i = 0; (NULL != case_element_list) && (i < case_element_list->n); i++) {
+		*values = values_incoming;
+		case_element_list->get_element(i)->accept(*this);
+		values_result = inner_left_join_values(values_result, *values);
+	}
+	*values = values_incoming;
+	if (NULL != symbol->statement_list) {
+		symbol->statement_list->accept(*this);
+		values_result = inner_left_join_values(values_result, *values);
+	}
+	*values = values_result;
 	return NULL;
 }
 
+
 /********************************/
 /* B 3.2.4 Iteration Statements */
 /********************************/
+/* The variables assigned inside a loop do not have a known value at the start of each iteration
+ * (we do not iterate until reaching a fixed point), nor after the loop.
+ */
 void *constant_propagation_c::visit(for_statement_c *symbol) {
-	map_values_t values_incoming;
-	map_values_t values_statement_result;
+	if (!propagate_variables_) return iterator_visitor_c::visit(symbol);
 
-	values_incoming = values; /* save incoming status */
+	kill_assigned_vars(symbol);
+	symbol->control_variable->accept(*this);
 	symbol->beg_expression->accept(*this);
 	symbol->end_expression->accept(*this);
-	(*values)[get_var_name_c::get_name(symbol->control_variable)->value]._int64.status = const_value_c::cs_non_const;
-
-	/* Optimize dead code */
-	if (NULL != symbol->by_expression) {
+	if (NULL != symbol->by_expression)
 		symbol->by_expression->accept(*this);
-		if (VALID_CVALUE(int64, symbol->by_expression ) &&   GET_CVALUE(int64, symbol->by_expression ) > 0 &&
-			VALID_CVALUE(int64, symbol->beg_expression) && VALID_CVALUE(int64, symbol->end_expression)     &&
-			  GET_CVALUE(int64, symbol->beg_expression) >    GET_CVALUE(int64, symbol->end_expression))
-			return NULL;
-
-		if (VALID_CVALUE(int64, symbol->by_expression ) &&   GET_CVALUE(int64, symbol->by_expression ) < 0 &&
-			VALID_CVALUE(int64, symbol->beg_expression) && VALID_CVALUE(int64, symbol->end_expression)    &&
-			  GET_CVALUE(int64, symbol->beg_expression) <    GET_CVALUE(int64, symbol->end_expression))
-			return NULL;
-
-	} else {
-		if (VALID_CVALUE(int64, symbol->beg_expression) && VALID_CVALUE(int64, symbol->end_expression)     &&
-			  GET_CVALUE(int64, symbol->beg_expression) >    GET_CVALUE(int64, symbol->end_expression))
-			return NULL;
-
-	}
-
+	symbol->control_variable->const_value = nonconst_value(); // the control variable is assigned!
 
+	map_values_t values_incoming = *values;
 	symbol->statement_list->accept(*this);
-	values_statement_result = values;
-	values = inner_left_join_values(values_statement_result, values_incoming);
-
+	*values = inner_left_join_values(*values, values_incoming);
 	return NULL;
 }
 
+
 void *constant_propagation_c::visit(while_statement_c *symbol) {
-	map_values_t values_incoming;
-	map_values_t values_statement_result;
+	if (!propagate_variables_) return iterator_visitor_c::visit(symbol);
 
-	/* Optimize dead code */
+	bool prev_dead_code = dead_code_;
+	kill_assigned_vars(symbol);
+	map_values_t values_incoming = *values;
 	symbol->expression->accept(*this);
-	if (VALID_CVALUE(bool, symbol->expression) && GET_CVALUE(bool, symbol->expression) == false)
-		return NULL;
-
-	values_incoming = values; /* save incoming status */
+	/* WHILE FALSE DO ... END_WHILE; */
+	if (VALID_CVALUE(bool, symbol->expression) && !GET_CVALUE(bool, symbol->expression))
+		dead_code_ = true;
 	symbol->statement_list->accept(*this);
-	values_statement_result = values;
-	values = inner_left_join_values(values_statement_result, values_incoming);
-
+	*values = dead_code_? values_incoming : inner_left_join_values(*values, values_incoming);
+	dead_code_ = prev_dead_code;
 	return NULL;
 }
 
+
 void *constant_propagation_c::visit(repeat_statement_c *symbol) {
-	map_values_t values_incoming;
-	map_values_t values_statement_result;
+	if (!propagate_variables_) return iterator_visitor_c::visit(symbol);
 
-	values_incoming = values; /* save incoming status */
+	/* the statements are executed at least once, and the loop ends after executing them. */
+	kill_assigned_vars(symbol);
 	symbol->statement_list->accept(*this);
-
-	/* Optimize dead code */
 	symbol->expression->accept(*this);
-	if (VALID_CVALUE(bool, symbol->expression) && GET_CVALUE(bool, symbol->expression) == true)
-		return NULL;
-
-	values_statement_result = values;
-	values = inner_left_join_values(values_statement_result, values_incoming);
-
 	return NULL;
 }
 
@@ -45,10 +45,11 @@
 
 
 
-/* For the moment we disable constant propagation algorithm as it is not yet complete, 
- * and due to this is currently brocken and producing incorrect results!
+/* Enable the flow sensitive propagation of the values assigned to variables inside the POU bodies.
+ * This is only done when constant_propagation_c is created with propagate_variables = true, which
+ * stage3 does in a second run, after the datatypes of all expressions have been determined.
  */
-#define DO_CONSTANT_PROPAGATION__ 0
+#define DO_CONSTANT_PROPAGATION__ 1
 
 
 
@@ -70,7 +71,7 @@ class constant_folding_c : public iterator_visitor_c {
     virtual ~constant_folding_c(void);
     int get_error_count();
  
-  private:
+  protected: // used by the constant_propagation_c
     /*********************/
     /* B 1.2 - Constants */
     /*********************/
@@ -205,27 +206,42 @@ class constant_folding_c : public iterator_visitor_c {
 
 class constant_propagation_c : public constant_folding_c {
   public:
-    constant_propagation_c(symbol_c *symbol = NULL);
+    constant_propagation_c(symbol_c *symbol = NULL, bool propagate_variables = false);
     virtual ~constant_propagation_c(void);
     typedef symtable_c<const_value_c> map_values_t;
+    typedef symtable_c<bool>          map_names_t;
   private:
     symbol_c *current_resource;
     symbol_c *current_configuration;
     map_values_t *values;
     map_values_t var_global_values;
+    /* Variables of the POU currently being analysed whose value may change behind our back (VAR_IN_OUT, located variables,
+     * non constant VAR_GLOBAL and VAR_EXTERNAL, and variables whose address is taken with REF()). These are never propagated.
+     */
+    map_names_t *untracked_vars;
+    // Flag to indicate whether the values assigned to variables in the POU bodies are to be propagated (i.e. the second run of this algorithm)
+    bool propagate_variables_;
+    // Flag to indicate we are analysing code that is never executed (ex: IF FALSE THEN ... END_IF)
+    bool dead_code_;
     /* A stack of all the FB declarations currently being recursively constant propagated */
     std::deque<function_block_declaration_c *> fbs_currently_being_visited; // We use a deque instead of stack, so we can search in the stack using direct access to its elements!
 
     void *handle_var_list_decl(symbol_c *var_list, symbol_c *type_decl, bool is_global_var = false);
-    void *handle_var_decl     (symbol_c *var_list, bool fixed_init_value);
+    void *handle_var_decl     (symbol_c *var_list, bool fixed_init_value, bool untracked_var = false);
     // Flag to indicate whether the variables in the variable declaration list will always have a fixed value when the POU is executed!
     // VAR CONSTANT ... END_VAR will always be true
     // VAR          ... END_VAR will always be true for functions (who initialise local variables every time they are called), but false for FBs and PROGRAMS
     bool fixed_init_value_; 
+    // Flag to indicate whether the variables in the variable declaration list may change value behind our back (ex: VAR_IN_OUT)
+    bool untracked_var_decl_;
     bool function_pou_;
     bool is_constant(symbol_c *option);
     bool is_retain  (symbol_c *option);
     static map_values_t inner_left_join_values(map_values_t m1, map_values_t m2);
+    void  set_var_value          (symbol_c *variable, const_value_c value);
+    void  kill_assigned_vars     (symbol_c *code);
+    void  untrack_referenced_vars(symbol_c *code);
+    void *handle_expression      (symbol_c *symbol);
 
 
   private:
@@ -241,6 +257,7 @@ class constant_propagation_c : public constant_folding_c {
     void *visit(symbolic_variable_c *symbol);
     #endif // DO_CONSTANT_PROPAGATION__
     void *visit(symbolic_constant_c *symbol);
+    void *visit(located_var_decl_c  *symbol);
                              
     /******************************************/
     /* B 1.4.3 - Declaration & Initialisation */
@@ -278,6 +295,13 @@ class constant_propagation_c : public constant_folding_c {
     /**********************/
     void *visit(       program_declaration_c *symbol);
 
+    /*********************************************/
+    /* B.1.6  Sequential function chart elements */
+    /*********************************************/
+    #if DO_CONSTANT_PROPAGATION__
+    void *visit(sequential_function_chart_c *symbol);
+    #endif // DO_CONSTANT_PROPAGATION__
+
     /********************************/
     /* B 1.7 Configuration elements */
     /********************************/
@@ -293,6 +317,9 @@ class constant_propagation_c : public constant_folding_c {
     /***********************************/
     /* B 2.1 Instructions and Operands */
     /***********************************/
+    #if DO_CONSTANT_PROPAGATION__
+    void *visit(instruction_list_c *symbol);
+    #endif // DO_CONSTANT_PROPAGATION__
     //void *visit(il_function_call_c *symbol);  /* TODO */
     // void *visit(il_fb_call_c *symbol);       /* TODO: move from constant_folding_c */
     //void *visit(il_formal_funct_call_c *symbol);   /* TODO */
@@ -313,18 +340,33 @@ class constant_propagation_c : public constant_folding_c {
     /***********************/
     /* B 3.1 - Expressions */
     /***********************/
-    //void *visit(function_invocation_c *symbol); /* TODO */
-
     #if DO_CONSTANT_PROPAGATION__
+    void *visit(   ref_expression_c *symbol);
+    void *visit(   add_expression_c *symbol);
+    void *visit(   sub_expression_c *symbol);
+    void *visit(   mul_expression_c *symbol);
+    void *visit(   div_expression_c *symbol);
+    void *visit(   mod_expression_c *symbol);
+    void *visit( power_expression_c *symbol);
+    void *visit(   neg_expression_c *symbol);
+    void *visit(   not_expression_c *symbol);
+    void *visit(function_invocation_c *symbol);
+
     /*********************************/
     /* B 3.2.1 Assignment Statements */
     /*********************************/
     void *visit(assignment_statement_c *symbol);
 
+    /*****************************************/
+    /* B 3.2.2 Subprogram Control Statements */
+    /*****************************************/
+    void *visit(fb_invocation_c *symbol);
+
     /********************************/
     /* B 3.2.3 Selection Statements */
     /********************************/
     void *visit(if_statement_c *symbol);
+    void *visit(case_statement_c *symbol);
 
     /********************************/
     /* B 3.2.4 Iteration Statements */
@@ -382,6 +382,33 @@ const struct widen_entry widen_CMP_table[] = {
 };
 
 
+datatype_set_c::datatype_set_c(const std::vector <symbol_c *> &candidate_datatypes_)
+ : candidate_datatypes(candidate_datatypes_) {
+	for(unsigned int i = 0; i < candidate_datatypes.size(); i++) {
+		int id = get_datatype_info_c::get_datatype_id(candidate_datatypes[i]);
+		if (id < 0) {others.push_back(candidate_datatypes[i]); continue;}
+		if ((unsigned int)id / 64 >= bits.size()) bits.resize(id / 64 + 1, 0);
+		bits[id / 64] |= (uint64_t)1 << (id % 64);
+	}
+}
+
+
+bool datatype_set_c::contains(symbol_c *datatype) {
+	int id = get_datatype_info_c::get_datatype_id(datatype);
+	/* a datatype without an id may be equivalent to any datatype in the list */
+	if (id < 0) 
+		return (search_in_candidate_datatype_list(datatype, candidate_datatypes) >= 0);
+
+	if (((unsigned int)id / 64 < bits.size()) && (bits[id / 64] & ((uint64_t)1 << (id % 64))))
+		return true;
+	for(unsigned int i = 0; i < others.size(); i++)
+		if (get_datatype_info_c::is_type_equal(datatype, others[i]))
+			return true;
+	return false;
+}
+
+
+
 /* Search for a datatype inside a candidate_datatypes list.
  * Returns: position of datatype in the list, or -1 if not found.
  */
@@ -389,6 +416,7 @@ int search_in_candidate_datatype_list(symbol_c *datatype, const std::vector <sym
 	if (NULL == datatype) 
 		return -1;
 
+	/* is_type_equal() compares the ids of the datatypes, when both have one */
 	for(unsigned int i = 0; i < candidate_datatypes.size(); i++)
 		if (get_datatype_info_c::is_type_equal(datatype, candidate_datatypes[i]))
 			return i;
@@ -420,11 +448,12 @@ void intersect_candidate_datatype_list(symbol_c *list1 /*origin, dest.*/, symbol
 		/* In principle, we should never call it with NULL values. Best to abort the compiler just in case! */
 		return;
 
+	datatype_set_c list2_set(list2->candidate_datatypes);
 	for(std::vector<symbol_c *>::iterator i = list1->candidate_datatypes.begin(); i < list1->candidate_datatypes.end(); ) {
 		/* Note that we do _not_ increment i in the for() loop!
 		 * When we erase an element from position i, a new element will take it's place, that must also be tested! 
 		 */
-		if (search_in_candidate_datatype_list(*i, list2->candidate_datatypes) < 0)
+		if (!list2_set.contains(*i))
 			/* remove this element! This will change the value of candidate_datatypes.size() */
 			list1->candidate_datatypes.erase(i);
 		else i++;
@@ -74,6 +74,23 @@ extern const struct widen_entry widen_OR_table[];
 extern const struct widen_entry widen_XOR_table[];
 extern const struct widen_entry widen_CMP_table[];
 
+/* A set of datatypes, built from a candidate_datatypes list, that keeps a bitset of the ids of the
+ * datatypes in the list (see get_datatype_info_c::get_datatype_id()), so that membership is tested in
+ * constant time. Datatypes without an id (generic, REF_TO, ...) are compared one by one.
+ * NOTE: the set refers to the list it was built from, which must not change while the set is in use!
+ */
+class datatype_set_c {
+  private:
+    const std::vector <symbol_c *> &candidate_datatypes;
+    std::vector <uint64_t>          bits;
+    std::vector <symbol_c *>        others;  /* the datatypes in the list without an id */
+
+  public:
+    datatype_set_c(const std::vector <symbol_c *> &candidate_datatypes);
+    bool contains(symbol_c *datatype);
+};
+
+
 /* Search for a datatype inside a candidate_datatypes list.
  * Returns: position of datatype in the list, or -1 if not found.
  */
@@ -272,11 +272,16 @@ fill_candidate_datatypes_c::fill_candidate_datatypes_c(symbol_c *ignore) {
 	search_var_instance_decl = NULL;
 	current_enumerated_spec_type = NULL;
 	current_scope = NULL;
+	function_match_count = 0;
 }
 
 fill_candidate_datatypes_c::~fill_candidate_datatypes_c(void) {
 }
 
+unsigned long fill_candidate_datatypes_c::get_function_match_count(void) {
+	return function_match_count;
+}
+
 
 
 
@@ -501,11 +506,27 @@ void fill_candidate_datatypes_c::handle_function_call(symbol_c *fcall, generic_f
 
 	if (debug) std::cout << "function()\n";
 
-	function_symtable_t::iterator lower = function_symtable.lower_bound(fcall_data.function_name);
-	function_symtable_t::iterator upper = function_symtable.upper_bound(fcall_data.function_name);
+	/* Only look at the overloads that may accept the parameters being passed (see function_overloads.hh).
+	 * Formal invocations may leave out any parameter, so in this case we must look at all the overloads.
+	 */
+	const function_overloads_c::function_list_t &all_overloads = function_overloads_c::find(fcall_data.function_name);
+	function_overloads_c::function_list_t        nonformal_overloads;
+	const function_overloads_c::function_list_t *overloads = &all_overloads;
 	/* If the name of the function being called is not found in the function symbol table, then this is an invalid call */
 	/* Since the lexical parser already checks for this, then if this occurs then we have an internal compiler error. */
-	if (lower == function_symtable.end()) ERROR;
+	if (all_overloads.empty()) ERROR;
+	
+	if ((NULL != fcall_data.nonformal_operand_list) && (NULL == fcall_data.formal_operand_list)) {
+		function_call_param_iterator_c fcp_iterator(fcall);
+		symbol_c *first_param_value = fcp_iterator.next_nf();
+		int param_count = 0;
+		static const std::vector <symbol_c *> no_datatypes;
+		for (symbol_c *param_value = first_param_value; NULL != param_value; param_value = fcp_iterator.next_nf())
+			param_count++;
+		function_overloads_c::find(fcall_data.function_name, param_count, 
+		                           (NULL == first_param_value)? no_datatypes : first_param_value->candidate_datatypes, nonformal_overloads);
+		overloads = &nonformal_overloads;
+	}
 	
 	/* Look for all compatible function declarations, and add their return datatypes 
 	 * to the candidate_datatype list of this function invocation. 
@@ -519,18 +540,19 @@ void fill_candidate_datatypes_c::handle_function_call(symbol_c *fcall, generic_f
 	 * expressions inside the function call will themselves have erros and will  guarantee that 
 	 * compilation is aborted in stage3 (in print_datatypes_error_c).
 	 */
-	if (function_symtable.count(fcall_data.function_name) == 1) {
-		f_decl = function_symtable.get_value(lower);
+	if (all_overloads.size() == 1) {
+		f_decl = all_overloads[0];
 		returned_parameter_type = base_type(f_decl->type_name);
 		if (add_datatype_to_candidate_list(fcall, returned_parameter_type))
 			/* we only add it to the function declaration list if this entry was not already present in the candidate datatype list! */
 			fcall_data.candidate_functions.push_back(f_decl);
 		
 	}
-	for(; lower != upper; lower++) {
+	for(unsigned int i = 0; i < overloads->size(); i++) {
 		bool compatible = false;
 		
-		f_decl = function_symtable.get_value(lower);
+		f_decl = (*overloads)[i];
+		function_match_count++;
 		/* Check if function declaration in symbol_table is compatible with parameters */
 		if (NULL != fcall_data.nonformal_operand_list) compatible=match_nonformal_call(fcall, f_decl);
 		if (NULL != fcall_data.   formal_operand_list) compatible=   match_formal_call(fcall, f_decl);
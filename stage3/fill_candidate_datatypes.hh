@@ -84,6 +84,8 @@ class fill_candidate_datatypes_c: public iterator_visitor_c {
     symbol_c *prev_il_instruction;
     /* the current IL operand being analyzed */
     symbol_c *il_operand;
+    /* number of function declarations matched against function invocations (see handle_function_call()) */
+    unsigned long function_match_count;
     symbol_c *widening_conversion(symbol_c *left_type, symbol_c *right_type, const struct widen_entry widen_table[]);
 
     /* Match a function declaration with a function call through their parameters.*/
@@ -114,6 +116,7 @@ class fill_candidate_datatypes_c: public iterator_visitor_c {
   public:
     fill_candidate_datatypes_c(symbol_c *ignore);
     virtual ~fill_candidate_datatypes_c(void);
+    unsigned long get_function_match_count(void);
 
     
     /***************************/
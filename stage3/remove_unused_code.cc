@@ -0,0 +1,296 @@
+/*
+ *  matiec - a compiler for the programming languages defined in IEC 61131-3
+ *
+ *  Copyright (C) 2014  Mario de Sousa (msousa@fe.up.pt)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+/*
+ * An IEC 61131-3 compiler.
+ *
+ * Based on the
+ * FINAL DRAFT - IEC 61131-3, 2nd Ed. (2001-12-10)
+ *
+ */
+
+/*
+ * Remove the POUs and the variables that are never used from the library.
+ *
+ * A POU is used if it can be reached from a configuration, i.e. if its name is referenced
+ * (variable declared of that FB type, Function called, Program instantiated in a resource, ...)
+ * in the configuration, in a data type declaration (data types are never removed), or in some other POU that is itself used.
+ *
+ * An internal variable of a POU is used if its name appears anywhere in that POU other than in
+ * its own declaration. Since we simply look for the variable's name (and do not try to find out what
+ * each identifier references), this is always on the safe side: a variable is kept if some other object
+ * with the same name (e.g. a structure element, or an enumerated value) is referenced in the POU.
+ * Variables whose name is referenced in a configuration (VAR_ACCESS, VAR_CONFIG, ...) or used as
+ * a field selector anywhere (prog_inst.var, fb_inst.var) are also kept.
+ */
+
+#include "remove_unused_code.hh"
+#include "../main.hh" // required for ERROR() and ERROR_MSG() macros.
+#include "../absyntax_utils/absyntax_utils.hh"
+
+
+
+#define STAGE3_REPORT(symbol, ...) {                                                  \
+    fprintf(stderr, "%s:%d-%d: note: ", (symbol)->first_file, (symbol)->first_line, (symbol)->first_column); \
+    fprintf(stderr, __VA_ARGS__);                                                     \
+    fprintf(stderr, "\n");                                                            \
+}
+
+
+
+/* Count the number of times each identifier is used in a section of the AST. */
+class count_identifiers_c: public iterator_visitor_c {
+  private:
+    identifier_count_t &count;
+  public:
+    count_identifiers_c(identifier_count_t &count_): count(count_) {}
+    void *visit(identifier_c *symbol) {count[symbol->value]++; return NULL;}
+};   /* class count_identifiers_c */
+
+
+
+/* Find the identifiers that may reference the internal variables of a POU from outside that POU,
+ * i.e. all the identifiers used in a configuration, and all the field selectors.
+ */
+class find_external_names_c: public iterator_visitor_c {
+  private:
+    identifier_count_t &count;
+  public:
+    find_external_names_c(identifier_count_t &count_): count(count_) {}
+    void *visit(structured_variable_c *symbol) {
+      token_c *field_selector = dynamic_cast<token_c *>(symbol->field_selector);
+      if (NULL != field_selector) count[field_selector->value]++;
+      return iterator_visitor_c::visit(symbol);
+    }
+    void *visit(configuration_declaration_c *symbol) {
+      count_identifiers_c count_identifiers(count);
+      return symbol->accept(count_identifiers);
+    }
+};   /* class find_external_names_c */
+
+
+
+/* Find the names of the POUs referenced in a section of the AST.
+ * The poutype_identifier_c is used anywhere in the AST that references a PROGRAM, FB or FUNCTION name.
+ */
+class find_pou_references_c: public iterator_visitor_c {
+  public:
+    std::vector<poutype_identifier_c *> references;
+    void *visit(poutype_identifier_c *symbol) {references.push_back(symbol); return NULL;}
+};   /* class find_pou_references_c */
+
+
+
+/* The list of variable names declared by each of the entries in a var_init_decl_list, temp_var_decls_list, ... */
+static list_c *get_var_name_list(symbol_c *decl) {
+  { var1_init_decl_c                     *d = dynamic_cast<var1_init_decl_c                     *>(decl); if (NULL != d) return dynamic_cast<list_c *>(d->var1_list);   }
+  { array_var_init_decl_c                *d = dynamic_cast<array_var_init_decl_c                *>(decl); if (NULL != d) return dynamic_cast<list_c *>(d->var1_list);   }
+  { structured_var_init_decl_c           *d = dynamic_cast<structured_var_init_decl_c           *>(decl); if (NULL != d) return dynamic_cast<list_c *>(d->var1_list);   }
+  { array_var_declaration_c              *d = dynamic_cast<array_var_declaration_c              *>(decl); if (NULL != d) return dynamic_cast<list_c *>(d->var1_list);   }
+  { structured_var_declaration_c         *d = dynamic_cast<structured_var_declaration_c         *>(decl); if (NULL != d) return dynamic_cast<list_c *>(d->var1_list);   }
+  { single_byte_string_var_declaration_c *d = dynamic_cast<single_byte_string_var_declaration_c *>(decl); if (NULL != d) return dynamic_cast<list_c *>(d->var1_list);   }
+  { double_byte_string_var_declaration_c *d = dynamic_cast<double_byte_string_var_declaration_c *>(decl); if (NULL != d) return dynamic_cast<list_c *>(d->var1_list);   }
+  { fb_name_decl_c                       *d = dynamic_cast<fb_name_decl_c                       *>(decl); if (NULL != d) return dynamic_cast<list_c *>(d->fb_name_list);}
+  return NULL;
+}
+
+
+/* The list of declarations in a VAR, VAR_TEMP, VAR NON_RETAIN block. Returns NULL for any other block of variables. */
+static list_c *get_internal_var_decl_list(symbol_c *block) {
+  { var_declarations_c        *b = dynamic_cast<var_declarations_c        *>(block); if (NULL != b) return dynamic_cast<list_c *>(b->var_init_decl_list);}
+  { function_var_decls_c      *b = dynamic_cast<function_var_decls_c      *>(block); if (NULL != b) return dynamic_cast<list_c *>(b->decl_list);         }
+  { temp_var_decls_c          *b = dynamic_cast<temp_var_decls_c          *>(block); if (NULL != b) return dynamic_cast<list_c *>(b->var_decl_list);     }
+  { non_retentive_var_decls_c *b = dynamic_cast<non_retentive_var_decls_c *>(block); if (NULL != b) return dynamic_cast<list_c *>(b->var_decl_list);     }
+  return NULL;
+}
+
+
+/* The declarations of the variables of a POU */
+static symbol_c *get_var_declarations_list(symbol_c *pou_decl) {
+  { function_declaration_c       *p = dynamic_cast<function_declaration_c       *>(pou_decl); if (NULL != p) return p->var_declarations_list;}
+  { function_block_declaration_c *p = dynamic_cast<function_block_declaration_c *>(pou_decl); if (NULL != p) return p->var_declarations;     }
+  { program_declaration_c        *p = dynamic_cast<program_declaration_c        *>(pou_decl); if (NULL != p) return p->var_declarations;     }
+  return NULL;
+}
+
+
+/* The name of a POU */
+static symbol_c *get_pou_name(symbol_c *pou_decl) {
+  { function_declaration_c       *p = dynamic_cast<function_declaration_c       *>(pou_decl); if (NULL != p) return p->derived_function_name;}
+  { function_block_declaration_c *p = dynamic_cast<function_block_declaration_c *>(pou_decl); if (NULL != p) return p->fblock_name;          }
+  { program_declaration_c        *p = dynamic_cast<program_declaration_c        *>(pou_decl); if (NULL != p) return p->program_type_name;    }
+  return NULL;
+}
+
+
+
+
+
+
+
+/************************************************************/
+/************************************************************/
+/******   The main class: Remove Unused Code          *******/
+/************************************************************/
+/************************************************************/
+
+// constructor & destructor
+remove_unused_code_c:: remove_unused_code_c(void) {
+  removed_pou_count = 0;
+  removed_var_count = 0;
+  new_tree = NULL;
+}
+
+remove_unused_code_c::~remove_unused_code_c(void) {
+}
+
+
+int remove_unused_code_c::get_removed_pou_count(void) {return removed_pou_count;}
+int remove_unused_code_c::get_removed_var_count(void) {return removed_var_count;}
+
+
+
+library_c *remove_unused_code_c::create_new_tree(symbol_c *tree) {
+  library_c *old_tree = dynamic_cast<library_c *>(tree);
+  if (NULL == old_tree) ERROR;
+  new_tree = new library_c;
+  *((symbol_c *)new_tree) = *((symbol_c *)tree); // copy any annotations from tree to new_tree;
+  new_tree->clear(); // remove all elements from list.
+
+  /* find the identifiers that may reference a variable from outside the POU in which it is declared */
+  find_external_names_c find_external_names(external_names);
+  old_tree->accept(find_external_names);
+
+  /* find the POUs for which code is generated, and whether there is any configuration */
+  // if no code generation pragma exists before the first entry in the library, the default is to enable code generation.
+  std::vector<symbol_c *> generated_pous;
+  bool generate_code     = true;
+  bool has_configuration = false;
+  for (int i = 0; i < old_tree->n; i++) {
+    symbol_c *element = old_tree->get_element(i);
+    if (NULL != dynamic_cast<disable_code_generation_pragma_c *>(element)) generate_code = false;
+    if (NULL != dynamic_cast< enable_code_generation_pragma_c *>(element)) generate_code = true;
+    if (NULL != dynamic_cast<     configuration_declaration_c *>(element)) has_configuration = true;
+    symbol_c *pou_name = get_pou_name(element);
+    if (generate_code && (NULL != pou_name)) {
+      pous.insert(pou_name, element);
+      generated_pous.push_back(element);
+    }
+  }
+
+  /* find the POUs used by the configurations, and by the data types (e.g. REF_TO fb_type), which are always kept.
+   * The unused variables of each POU are removed as soon as it is found to be reachable (see mark_reachable() ).
+   */
+  for (int i = 0; i < old_tree->n; i++)
+    if (   (NULL != dynamic_cast<configuration_declaration_c *>(old_tree->get_element(i)))
+        || (NULL != dynamic_cast<data_type_declaration_c     *>(old_tree->get_element(i))))
+      mark_reachable(old_tree->get_element(i));
+
+  /* without any configuration all the POUs are kept, so remove the unused variables of those not yet handled */
+  if (!has_configuration)
+    for (unsigned int i = 0; i < generated_pous.size(); i++)
+      if (reachable_pous.find(generated_pous[i]) == reachable_pous.end())
+        remove_unused_vars(generated_pous[i], get_var_declarations_list(generated_pous[i]));
+
+  /* copy all the used POUs, as well as all the other elements (datatypes, pragmas, ...) to the new tree */
+  std::set<symbol_c *> removable_pous(generated_pous.begin(), generated_pous.end());
+  for (int i = 0; i < old_tree->n; i++) {
+    symbol_c *element = old_tree->get_element(i);
+    if (   has_configuration
+        && (removable_pous.find(element) != removable_pous.end())
+        && (reachable_pous.find(element) == reachable_pous.end())) {
+      STAGE3_REPORT(element, "removed unused POU '%s' (not used by any configuration).", get_datatype_info_c::get_id_str(element));
+      removed_pou_count++;
+      continue;
+    }
+    new_tree->add_element(element);
+  }
+
+  return new_tree;
+}
+
+
+
+/* mark all the POUs referenced by symbol (and the POUs they reference, recursively) as reachable.
+ * The unused variables of each reachable POU are removed before looking for the POUs it references,
+ * as these variables may be the only instances of some FB.
+ */
+void remove_unused_code_c::mark_reachable(symbol_c *symbol) {
+  find_pou_references_c find_pou_references;
+  symbol->accept(find_pou_references);
+
+  for (unsigned int i = 0; i < find_pou_references.references.size(); i++) {
+    poutype_identifier_c *name = find_pou_references.references[i];
+    // NOTE: overloaded functions share the same name, so we keep all of them!
+    pou_symtable_t::iterator lower = pous.lower_bound(name);
+    pou_symtable_t::iterator upper = pous.upper_bound(name);
+    for (; lower != upper; lower++) {
+      if (reachable_pous.find(lower->second) != reachable_pous.end()) continue; // already handled!
+      reachable_pous.insert(lower->second);
+      remove_unused_vars(lower->second, get_var_declarations_list(lower->second));
+      mark_reachable(lower->second);
+    }
+  }
+}
+
+
+
+/* remove the internal variables of the POU that are never referenced */
+void remove_unused_code_c::remove_unused_vars(symbol_c *pou_decl, symbol_c *var_declarations_list) {
+  list_c *blocks = dynamic_cast<list_c *>(var_declarations_list);
+  if (NULL == blocks) return;
+  /* the variables of the programs are listed in VARIABLES.csv, and may be read or forced with the debugger */
+  if (NULL != dynamic_cast<program_declaration_c *>(pou_decl)) return;
+
+  identifier_count_t  count;
+  count_identifiers_c count_identifiers(count);
+  pou_decl->accept(count_identifiers);
+
+  for (int i = blocks->n - 1; i >= 0; i--) {
+    list_c *var_decl_list = get_internal_var_decl_list(blocks->get_element(i));
+    if (NULL == var_decl_list) continue; // not a block of internal variables.
+    remove_unused_vars(pou_decl, var_decl_list, count);
+    if (0 == var_decl_list->n) blocks->remove_element(i); // all the variables in this block have been removed!
+  }
+  /* the declarations of this POU may have been found (and cached) before they were removed... */
+  search_var_instance_decl_c::invalidate_declaration_index();
+}
+
+
+void remove_unused_code_c::remove_unused_vars(symbol_c *pou_decl, list_c *var_decl_list, identifier_count_t &count) {
+  for (int i = var_decl_list->n - 1; i >= 0; i--) {
+    list_c *var_name_list = get_var_name_list(var_decl_list->get_element(i));
+    if (NULL == var_name_list) continue; // unknown declaration. Play it safe and keep it!
+    for (int j = var_name_list->n - 1; j >= 0; j--) {
+      token_c *var_name = dynamic_cast<token_c *>(var_name_list->get_element(j));
+      if (NULL == var_name) continue;
+      if (count[var_name->value] > 1)                continue; // used somewhere else in the POU (not only in its declaration)
+      if (external_names.count(var_name->value) > 0) continue; // may be referenced from outside the POU
+      STAGE3_REPORT(var_name, "removed unused variable '%s' of POU '%s'.", var_name->value, get_datatype_info_c::get_id_str(pou_decl));
+      var_name_list->remove_element(j);
+      removed_var_count++;
+    }
+    if (0 == var_name_list->n) var_decl_list->remove_element(i); // all the variables in this declaration have been removed!
+  }
+}
+
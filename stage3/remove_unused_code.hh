@@ -0,0 +1,89 @@
+/*
+ *  matiec - a compiler for the programming languages defined in IEC 61131-3
+ *
+ *  Copyright (C) 2014  Mario de Sousa (msousa@fe.up.pt)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+/*
+ * An IEC 61131-3 compiler.
+ *
+ * Based on the
+ * FINAL DRAFT - IEC 61131-3, 2nd Ed. (2001-12-10)
+ *
+ */
+
+
+/*
+ * Remove the POUs and the variables that are never used from the library.
+ *
+ *  - POUs (Functions, FBs and Programs) that can not be reached from any configuration
+ *    (i.e. that are not instantiated or called, directly or indirectly, by a program
+ *    running in a resource), nor from any data type declaration (e.g. REF_TO fb_type),
+ *    are removed from the library.
+ *    If the library does not contain any configuration, all the POUs are kept, as they
+ *    are probably being compiled to be used by some other code.
+ *  - Internal variables (VAR, VAR_TEMP, VAR NON_RETAIN) of the Functions and FBs that are never
+ *    referenced are removed from the declarations of the POU. Input, output, in_out,
+ *    external, global, retentive and located variables are always kept, as well as all the
+ *    variables of the Programs (these are the variables listed in VARIABLES.csv for the debugger).
+ *
+ * Only the POUs for which code is generated (i.e. not placed inside a {disable code generation}
+ * pragma) are changed. Everything that is removed is reported on stderr.
+ *
+ * Like the remove_forward_dependencies_c, this utility class does not destroy the original AST,
+ * and instead creates a new library_c object pointing to the POUs that were kept. Note however that
+ * the unused variables are removed from the (shared) declarations of the POUs themselves.
+ */
+
+#include "../absyntax/absyntax.hh"
+#include "../absyntax/visitor.hh"
+#include "../util/symtable.hh"
+#include "../util/dsymtable.hh"
+#include <set>
+
+
+
+typedef symtable_c<int>        identifier_count_t;  // number of times each identifier is used
+typedef dsymtable_c<symbol_c *> pou_symtable_t;     // the POUs, by name (several Functions may share the same name when overloaded)
+
+
+class remove_unused_code_c {
+
+  private:
+    int                    removed_pou_count;
+    int                    removed_var_count;
+    library_c             *new_tree;
+    pou_symtable_t         pous;              // the POUs for which code is generated
+    std::set <symbol_c *>  reachable_pous;    // the POUs reachable from a configuration (or a data type declaration)
+    identifier_count_t     external_names;    // identifiers used outside the POU declaring the variable (configurations, and field selectors)
+
+  public:
+     remove_unused_code_c(void);
+    ~remove_unused_code_c(void);
+    library_c *create_new_tree(symbol_c *old_tree);  // create a new tree without the unused POUs...
+    int        get_removed_pou_count(void);
+    int        get_removed_var_count(void);
+
+  private:
+    void  mark_reachable(symbol_c *symbol);
+    void  remove_unused_vars(symbol_c *pou_decl, symbol_c *var_declarations_list);
+    void  remove_unused_vars(symbol_c *pou_decl, list_c   *var_decl_list, identifier_count_t &count);
+};   /* class remove_unused_code_c */
+
@@ -46,6 +46,7 @@
 #include "declaration_check.hh"
 #include "enum_declaration_check.hh"
 #include "remove_forward_dependencies.hh"
+#include "remove_unused_code.hh"
 
 
 
@@ -98,6 +99,8 @@ static int constant_propagation(symbol_c *tree_root){
 static int type_safety(symbol_c *tree_root){
 	fill_candidate_datatypes_c fill_candidate_datatypes(tree_root);
 	tree_root->accept(fill_candidate_datatypes);
+	if (runtime_options.print_statistics)
+		fprintf(stderr, "%lu function declaration(s) matched against function invocations.\n", fill_candidate_datatypes.get_function_match_count());
 	narrow_candidate_datatypes_c narrow_candidate_datatypes(tree_root);
 	tree_root->accept(narrow_candidate_datatypes);
 	print_datatypes_error_c print_datatypes_error(tree_root);
@@ -108,6 +111,18 @@ static int type_safety(symbol_c *tree_root){
 }
 
 
+/* Propagating the values assigned to the variables (and not only the constants) assumes that data type analysis
+ * has already been completed (the datatype of each expression determines the value computed by the generated code),
+ * so be sure to call type_safety() before calling this function.
+ * Stage 4, as well as the array range check, use the resulting const values.
+ */
+static int variable_propagation(symbol_c *tree_root){
+    constant_propagation_c constant_propagation(tree_root, true /* propagate variables */);
+    tree_root->accept(constant_propagation);
+    return constant_propagation.get_error_count();
+}
+
+
 /* Left value checking assumes that data type analysis has already been completed,
  * so be sure to call type_safety() before calling this function
  */
@@ -155,6 +170,24 @@ static int remove_forward_dependencies(symbol_c *tree_root, symbol_c **ordered_t
 }
 
 
+/* Removing the unused POUs and variables must only be done once all the semantic checks have been completed
+ * without errors (the unused code must also be checked!), and after the forward dependencies are removed, 
+ * as it works on the (possibly re-ordered) tree that is handed over to stage 4.
+ */
+static int remove_unused_code(symbol_c **tree_root) {
+	if (!runtime_options.remove_unused_code)  return 0;
+	if (NULL == tree_root)                    return 0;
+
+	remove_unused_code_c remove_unused_code;
+	symbol_c *new_tree_root = remove_unused_code.create_new_tree(*tree_root);
+	if (NULL ==     new_tree_root)   ERROR;
+	*tree_root = new_tree_root;
+	fprintf(stderr, "%d unused POU(s) and %d unused variable(s) removed.\n", 
+	        remove_unused_code.get_removed_pou_count(), remove_unused_code.get_removed_var_count());
+	return 0;
+}
+
+
 int stage3(symbol_c *tree_root, symbol_c **ordered_tree_root) {
 	int error_count = 0;
 	error_count += enum_declaration_check(tree_root);
@@ -163,9 +196,13 @@ int stage3(symbol_c *tree_root, symbol_c **ordered_tree_root) {
 	error_count += declaration_safety(tree_root);
 	error_count += type_safety(tree_root);
 	error_count += lvalue_check(tree_root);
+	if (error_count == 0) /* the datatypes of the expressions may not all be known if there are errors! */
+		error_count += variable_propagation(tree_root);
 	error_count += array_range_check(tree_root);
 	error_count += case_elements_check(tree_root);
 	error_count += remove_forward_dependencies(tree_root, ordered_tree_root);
+	if (error_count == 0)
+		error_count += remove_unused_code(ordered_tree_root);
 	
 	if (error_count > 0) {
 		fprintf(stderr, "%d error(s) found. Bailing out!\n", error_count); 
@@ -28,6 +28,9 @@
 #include <typeinfo>
 #include <list>
 #include <map>
+#include <vector>
+#include <limits>
+#include <set>
 #include <sstream>
 #include <strings.h>
 
@@ -105,6 +108,12 @@
 
 #define SFC_STEP_ACTION_PREFIX "__SFC_"
 
+/* The time a step has been active (stepname.T) when generating the compact SFC state (-O c option).
+ * Note that IEC 61131-3 identifiers may not contain two consecutive '_', so this prefix
+ * never clashes with the SFC_STEP_ACTION_PREFIX of an action.
+ */
+#define SFC_STEP_TIMER_PREFIX "__SFC_T__"
+
 
 /* Variable declaration symbol for accessor macros */
 #define DECLARE_VAR "__DECLARE_VAR"
@@ -179,6 +188,18 @@
 static int generate_line_directives__ = 0;
 static int generate_pou_filepairs__   = 0;
 static int generate_plc_state_backup_fuctions__ = 0;
+static int generate_plc_state_delta_backup__    = 0;
+static int generate_retain_image__              = 0;
+static int generate_process_image__             = 0;
+static int generate_io_image_exchange__         = 0;
+static int generate_shared_snapshot__           = 0;
+static int generate_sparse_sfc__                = 0;
+static int generate_compact_sfc__               = 0;
+static int disable_debug_code__                 = 0;
+static int generate_propagated_values__         = 0;
+static int inline_fb_threshold__                = 0; /* maximum size (number of statements) of the FBs whose body is inlined. 0 => do not inline */
+static int elide_unconnected_en__               = 0;
+static int check_array_bounds__                 = 0;
 
 #ifdef __unix__
 /* Parse command line options passed from main.c !! */
@@ -186,12 +207,36 @@ static int generate_plc_state_backup_fuctions__ = 0;
 int  stage4_parse_options(char *options) {
   enum {LINE_OPT = 0,  
         SEPTFILE_OPT,
-        BACKUP_OPT    /* option to generate function to backup and restore internal PLC state */
+        BACKUP_OPT,   /* option to generate function to backup and restore internal PLC state */
+        DELTA_OPT,    /* option to also generate functions to backup and restore only the PLC state changed since the last backup */
+        RETAIN_OPT,   /* option to generate a table and functions to copy all RETAIN variables to/from a contiguous memory image */
+        IMAGE_OPT,    /* option to generate the layout of a packed process image for the located variables */
+        EXCHANGE_OPT, /* option to also exchange the process image with the I/O threads at the scan boundaries */
+        SNAPSHOT_OPT, /* option to publish a snapshot of all variables to shared memory at the end of each scan */
+        SPARSESFC_OPT, /* option to generate SFC code that only looks at the active steps in each scan */
+        COMPACTSFC_OPT, /* option to leave out of the SFC state the step and action timers not used by the chart */
+        NODEBUG_OPT,    /* option to leave out the debugger support (SFC debug tables, variable forcing checks) */
+        PROPAGATE_OPT,  /* option to replace variables with a value known at compile time by literals, and leave out dead IF/WHILE code */
+        INLINEFB_OPT,   /* option to inline the body of small FBs in the code calling them */
+        ELIDEEN_OPT,    /* option to leave out the EN/ENO handling of the POUs whose EN is never connected */
+        ARRAYCHECK_OPT  /* option to check at runtime the array subscripts that can not be proven to be within the array limits */
         /*, SOME_OTHER_OPT, YET_ANOTHER_OPT */};
   char *const token[] = {
         /*       LINE_OPT*/(char *)"l",
         /*   SEPTFILE_OPT*/(char *)"p",
         /*     BACKUP_OPT*/(char *)"b",
+        /*      DELTA_OPT*/(char *)"d",
+        /*     RETAIN_OPT*/(char *)"r",
+        /*      IMAGE_OPT*/(char *)"i",
+        /*   EXCHANGE_OPT*/(char *)"x",
+        /*   SNAPSHOT_OPT*/(char *)"h",
+        /*  SPARSESFC_OPT*/(char *)"s",
+        /* COMPACTSFC_OPT*/(char *)"c",
+        /*    NODEBUG_OPT*/(char *)"n",
+        /*  PROPAGATE_OPT*/(char *)"k",
+        /*   INLINEFB_OPT*/(char *)"f",
+        /*    ELIDEEN_OPT*/(char *)"e",
+        /* ARRAYCHECK_OPT*/(char *)"a",
         /* SOME_OTHER_OPT, ...             */
         NULL };
   /* unfortunately, the above commented out syntax for array initialization is valid in C, but not in C++ */
@@ -205,6 +250,22 @@ int  stage4_parse_options(char *options) {
       case     LINE_OPT: generate_line_directives__            = 1; break;
       case SEPTFILE_OPT: generate_pou_filepairs__              = 1; break;
       case   BACKUP_OPT: generate_plc_state_backup_fuctions__  = 1; break;
+      case    DELTA_OPT: generate_plc_state_backup_fuctions__  = 1;
+                         generate_plc_state_delta_backup__     = 1; break;
+      case   RETAIN_OPT: generate_retain_image__               = 1; break;
+      case    IMAGE_OPT: generate_process_image__              = 1; break;
+      case EXCHANGE_OPT: generate_process_image__              = 1;
+                         generate_io_image_exchange__          = 1; break;
+      case SNAPSHOT_OPT: generate_shared_snapshot__            = 1; break;
+      case SPARSESFC_OPT: generate_sparse_sfc__                = 1; break;
+      case COMPACTSFC_OPT: generate_compact_sfc__              = 1; break;
+      case  NODEBUG_OPT: disable_debug_code__                  = 1; break;
+      case PROPAGATE_OPT: generate_propagated_values__         = 1; break;
+      case INLINEFB_OPT: inline_fb_threshold__ = (NULL == value)? 20 : atoi(value);
+                         if (inline_fb_threshold__ <= 0) {fprintf(stderr, "Invalid FB inlining threshold: -O f=%s\n", value); return -1;}
+                         break;
+      case  ELIDEEN_OPT: elide_unconnected_en__                = 1; break;
+      case ARRAYCHECK_OPT: check_array_bounds__                = 1; break;
       default          : fprintf(stderr, "Unrecognized option: -O %s\n", value); return -1; break;
      }
   }     
@@ -217,6 +278,18 @@ void stage4_print_options(void) {
   printf("      l : insert '#line' directives in generated C code.\n"); 
   printf("      p : place each POU in a separate pair of files (<pou_name>.c, <pou_name>.h).\n"); 
   printf("      b : generate functions to backup and restore internal PLC state.\n"); 
+  printf("      d : as 'b', and also generate functions to backup and restore only the state changed since the previous backup.\n"); 
+  printf("      r : generate functions to copy all RETAIN variables to/from a single contiguous memory image.\n"); 
+  printf("      i : generate the layout of a packed process image (one block per %%I, %%Q and %%M area) for the located variables.\n"); 
+  printf("      x : as 'i', and also place the located variables in the process image, exchanged with the I/O threads at the scan boundaries.\n"); 
+  printf("      h : publish a consistent snapshot of all variables to a shared memory block at the end of each scan (for HMI/SCADA).\n"); 
+  printf("      s : generate SFC code that keeps a list of the active steps, and only evaluates the transitions and action associations of those steps (for large charts).\n"); 
+  printf("      c : generate a compact SFC state, without the step and action timers that are not used by the chart.\n"); 
+  printf("      n : generate code without debugger support (no SFC debug tables, variables cannot be forced), for production builds.\n"); 
+  printf("      k : use the values of variables known at compile time as literals, and leave out IF/WHILE code that is never executed (forcing those variables from the debugger has no effect).\n"); 
+  printf("      f[=<n>] : inline the body of the FBs with at most <n> statements (default 20), without SFC, in the code calling them.\n"); 
+  printf("      e : leave out the EN test and ENO update of the Functions and FBs whose EN is never connected to anything other than TRUE.\n"); 
+  printf("      a : check at runtime the array subscripts that can not be proven to always be within the array limits (out of range subscripts are clamped to the limits).\n"); 
 }
 #else /* not __unix__ */
 /* getsubopt isn't supported with mingw, 
@@ -225,6 +298,45 @@ void stage4_print_options(void) {}
 int  stage4_parse_options(char *options) {return 0;}
 #endif 
 
+
+/* Print out the #define's that configure the C runtime library headers (iec_std_lib.h, accessor.h, ...)
+ * to match the options used when generating the C code.
+ * These must be placed before the generated files #include any of those headers!
+ */
+static void print_runtime_lib_defines(stage4out_c &s4o) {
+  if (runtime_options.disable_implicit_en_eno) {
+    // If we are not generating the EN and ENO parameters for functions and FB,
+    //   then make sure we use the standard library version compiled without these parameters too!
+    s4o.print("#ifndef DISABLE_EN_ENO_PARAMETERS\n");
+    s4o.print("#define DISABLE_EN_ENO_PARAMETERS\n");
+    s4o.print("#endif\n");
+  }
+  if (generate_plc_state_delta_backup__) {
+    // The delta backup functions rely on the accessor macros marking the variables they change as dirty.
+    s4o.print("#ifndef ENABLE_DIRTY_TRACKING\n");
+    s4o.print("#define ENABLE_DIRTY_TRACKING\n");
+    s4o.print("#endif\n");
+  }
+  if (generate_retain_image__) {
+    // The retain image table entries are declared in accessor.h
+    s4o.print("#ifndef ENABLE_RETAIN_IMAGE\n");
+    s4o.print("#define ENABLE_RETAIN_IMAGE\n");
+    s4o.print("#endif\n");
+  }
+  if (disable_debug_code__) {
+    // Remove the checks of the force flags from the accessor macros.
+    s4o.print("#ifndef DISABLE_DEBUG_HOOKS\n");
+    s4o.print("#define DISABLE_DEBUG_HOOKS\n");
+    s4o.print("#endif\n");
+  }
+  if (generate_shared_snapshot__) {
+    // The shared snapshot header and table entries are declared in accessor.h
+    s4o.print("#ifndef ENABLE_SHARED_SNAPSHOT\n");
+    s4o.print("#define ENABLE_SHARED_SNAPSHOT\n");
+    s4o.print("#endif\n");
+  }
+}
+
 /***********************************************************************/
 /***********************************************************************/
 /***********************************************************************/
@@ -741,6 +853,165 @@ class calculate_common_ticktime_c: public iterator_visitor_c {
 /***********************************************************************/
 /***********************************************************************/
 
+/* A helper class that measures the size (number of statements) of the body of a POU,
+ * used to decide whether the body of a FB should be inlined.
+ * The body of every FB that is inlined is copied into the code calling it, so each call to
+ * such a FB counts as a statement plus the (inlined) size of that FB's body. The FBs of the
+ * standard library, whose code is not generated here, are counted in the same way, which
+ * at worst leaves a FB calling them out of line.
+ * SFC bodies are never inlined, so we simply give them the largest possible size.
+ */
+class calculate_body_size_c: public iterator_visitor_c {
+  private:
+    int size;
+    static std::map<symbol_c *, int> fb_sizes; // the inlined size of the body of each FB already measured
+
+  public:
+    int get_size(symbol_c *body) {size = 0; body->accept(*this); return size;}
+
+    /* Returns true if the body of the FB is inlined in the code calling it */
+    static bool is_inlined(function_block_declaration_c *fb_decl) {
+      return    (inline_fb_threshold__ > 0) && (NULL == runtime_options.export_module)
+             && (get_fb_size(fb_decl) <= inline_fb_threshold__);
+    }
+
+  private:
+    static int get_fb_size(function_block_declaration_c *fb_decl) {
+      std::map<symbol_c *, int>::iterator found = fb_sizes.find(fb_decl);
+      if (found != fb_sizes.end()) return found->second;
+      fb_sizes[fb_decl] = std::numeric_limits<int>::max(); // a FB can not call itself, but just in case...
+      calculate_body_size_c calculate_body_size;
+      return fb_sizes[fb_decl] = calculate_body_size.get_size(fb_decl->fblock_body);
+    }
+
+    void add_call(symbol_c *called_fb_declaration) {
+      function_block_declaration_c *fb_decl = dynamic_cast<function_block_declaration_c *>(called_fb_declaration);
+      if ((NULL == fb_decl) || !is_inlined(fb_decl)) return;
+      int fb_size = get_fb_size(fb_decl);
+      size = (size > std::numeric_limits<int>::max() - fb_size)? std::numeric_limits<int>::max() : size + fb_size;
+    }
+
+    /***********************************/
+    /* B 2.1 Instructions and Operands */
+    /***********************************/
+    void *visit(il_instruction_c             *symbol) {size++; return iterator_visitor_c::visit(symbol);}
+    void *visit(il_fb_call_c                 *symbol) {add_call(symbol->called_fb_declaration); return iterator_visitor_c::visit(symbol);}
+    /* FB calls with the implicit IL operators (e.g. CU counter_var) */
+    void *visit(S_operator_c                 *symbol) {add_call(symbol->called_fb_declaration); return NULL;}
+    void *visit(R_operator_c                 *symbol) {add_call(symbol->called_fb_declaration); return NULL;}
+    void *visit(S1_operator_c                *symbol) {add_call(symbol->called_fb_declaration); return NULL;}
+    void *visit(R1_operator_c                *symbol) {add_call(symbol->called_fb_declaration); return NULL;}
+    void *visit(CLK_operator_c               *symbol) {add_call(symbol->called_fb_declaration); return NULL;}
+    void *visit(CU_operator_c                *symbol) {add_call(symbol->called_fb_declaration); return NULL;}
+    void *visit(CD_operator_c                *symbol) {add_call(symbol->called_fb_declaration); return NULL;}
+    void *visit(PV_operator_c                *symbol) {add_call(symbol->called_fb_declaration); return NULL;}
+    void *visit(IN_operator_c                *symbol) {add_call(symbol->called_fb_declaration); return NULL;}
+    void *visit(PT_operator_c                *symbol) {add_call(symbol->called_fb_declaration); return NULL;}
+    /*********************************/
+    /* B 3.2 Statements              */
+    /*********************************/
+    void *visit(assignment_statement_c       *symbol) {size++; return iterator_visitor_c::visit(symbol);}
+    void *visit(fb_invocation_c              *symbol) {size++; add_call(symbol->called_fb_declaration); return iterator_visitor_c::visit(symbol);}
+    void *visit(return_statement_c           *symbol) {size++; return iterator_visitor_c::visit(symbol);}
+    void *visit(exit_statement_c             *symbol) {size++; return iterator_visitor_c::visit(symbol);}
+    void *visit(if_statement_c               *symbol) {size++; return iterator_visitor_c::visit(symbol);}
+    void *visit(elseif_statement_c           *symbol) {size++; return iterator_visitor_c::visit(symbol);}
+    void *visit(case_statement_c             *symbol) {size++; return iterator_visitor_c::visit(symbol);}
+    void *visit(case_element_c               *symbol) {size++; return iterator_visitor_c::visit(symbol);}
+    void *visit(for_statement_c              *symbol) {size++; return iterator_visitor_c::visit(symbol);}
+    void *visit(while_statement_c            *symbol) {size++; return iterator_visitor_c::visit(symbol);}
+    void *visit(repeat_statement_c           *symbol) {size++; return iterator_visitor_c::visit(symbol);}
+    /********************************************/
+    /* B 1.6 Sequential function chart elements */
+    /********************************************/
+    void *visit(sequential_function_chart_c  *symbol) {size = std::numeric_limits<int>::max(); return NULL;}
+};
+
+std::map<symbol_c *, int> calculate_body_size_c::fb_sizes;
+
+
+
+/* A helper class that finds the Functions and FBs whose EN input may be FALSE, i.e. those called somewhere
+ * with EN connected to anything other than TRUE, or whose instances' EN is accessed (fb_inst.EN := ...).
+ * The EN input of all the other POUs is always TRUE, so the code controlling their execution
+ * (testing EN and setting ENO) is never needed.
+ */
+class find_connected_en_c: public iterator_visitor_c {
+  private:
+    static std::set<symbol_c *> connected_pous;
+    static bool                 connected_unknown; // EN connected in a call to a POU we could not identify!
+
+  public:
+    static void find(symbol_c *tree_root) {
+      find_connected_en_c find_connected_en;
+      connected_pous.clear();
+      /* the POUs of a library module may be called by the projects importing the module, which we do not see! */
+      connected_unknown = (NULL != runtime_options.export_module);
+      tree_root->accept(find_connected_en);
+    }
+
+    /* Returns true if the EN of the POU is always TRUE, and the POU does not access its EN or ENO variables */
+    static bool is_en_always_true(symbol_c *pou_decl, symbol_c *pou_body) {
+      if (connected_unknown || (connected_pous.find(pou_decl) != connected_pous.end())) return false;
+      /* an explicitly declared EN may be passed non formally... */
+      function_param_iterator_c fp_iterator(pou_decl);
+      if ((NULL == fp_iterator.search("EN")) || !fp_iterator.is_en_eno_param_implicit()) return false;
+      /* ... and the POU may use the value of ENO set before running its body. */
+      find_en_eno_reference_c find_en_eno_reference;
+      return (NULL == pou_body->accept(find_en_eno_reference));
+    }
+
+  private:
+    class find_en_eno_reference_c: public iterator_visitor_c {
+      void *visit(identifier_c *symbol) {
+        if ((strcasecmp(symbol->value, "EN") == 0) || (strcasecmp(symbol->value, "ENO") == 0)) return symbol;
+        return NULL;
+      }
+    };
+
+    void mark(symbol_c *pou_decl) {if (NULL == pou_decl) connected_unknown = true; else connected_pous.insert(pou_decl);}
+
+    static bool is_EN(symbol_c *name) {
+      token_c *token = dynamic_cast<token_c *>(name);
+      return (NULL != token) && (strcasecmp(token->value, "EN") == 0);
+    }
+
+    static bool is_TRUE(symbol_c *value) {
+      return (NULL != value) && VALID_CVALUE(bool, value) && GET_CVALUE(bool, value);
+    }
+
+    void check_params(symbol_c *param_list, symbol_c *pou_decl) {
+      list_c *list = dynamic_cast<list_c *>(param_list);
+      if (NULL == list) return;
+      for (int i = 0; i < list->n; i++) {
+        input_variable_param_assignment_c *st_param = dynamic_cast<input_variable_param_assignment_c *>(list->get_element(i));
+        il_param_assignment_c             *il_param = dynamic_cast<il_param_assignment_c             *>(list->get_element(i));
+        if ((NULL != st_param) && is_EN(st_param->variable_name) && !is_TRUE(st_param->expression))
+          mark(pou_decl);
+        if (NULL != il_param) {
+          il_assign_operator_c *il_assign_operator = dynamic_cast<il_assign_operator_c *>(il_param->il_assign_operator);
+          if (   (NULL != il_assign_operator) && is_EN(il_assign_operator->variable_name)
+              && ((NULL != il_param->simple_instr_list) || !is_TRUE(il_param->il_operand)))
+            mark(pou_decl);
+        }
+      }
+    }
+
+    void *visit(function_invocation_c  *symbol) {check_params(symbol->formal_param_list, symbol->called_function_declaration); return iterator_visitor_c::visit(symbol);}
+    void *visit(fb_invocation_c        *symbol) {check_params(symbol->formal_param_list, symbol->called_fb_declaration);       return iterator_visitor_c::visit(symbol);}
+    void *visit(il_formal_funct_call_c *symbol) {check_params(symbol->il_param_list,     symbol->called_function_declaration); return iterator_visitor_c::visit(symbol);}
+    void *visit(il_fb_call_c           *symbol) {check_params(symbol->il_param_list,     symbol->called_fb_declaration);       return iterator_visitor_c::visit(symbol);}
+    void *visit(structured_variable_c  *symbol) {
+      if (is_EN(symbol->field_selector)) mark(symbol->record_variable->datatype);
+      return iterator_visitor_c::visit(symbol);
+    }
+};
+
+std::set<symbol_c *> find_connected_en_c::connected_pous;
+bool                 find_connected_en_c::connected_unknown = false;
+
+
+
 /* A helper class that knows how to generate code for the SFC, IL and ST languages... */
 class generate_c_SFC_IL_ST_c: public null_visitor_c {
   private:
@@ -989,8 +1260,10 @@ class generate_c_pous_c {
       search_var_instance_decl_c search_var(symbol);
       identifier_c  en_var("EN");
       identifier_c eno_var("ENO");
+      // Not needed either if the function is never called with EN connected to anything other than TRUE (-O e).
       if (   (search_var.get_vartype(& en_var) == search_var_instance_decl_c::input_vt)
-          && (search_var.get_vartype(&eno_var) == search_var_instance_decl_c::output_vt)) {
+          && (search_var.get_vartype(&eno_var) == search_var_instance_decl_c::output_vt)
+          && !(elide_unconnected_en__ && find_connected_en_c::is_en_always_true(symbol, symbol->function_body))) {
         s4o.print(s4o.indent_spaces + "// Control execution\n");
         s4o.print(s4o.indent_spaces + "if (!EN) {\n");
         s4o.indent_right();
@@ -1158,8 +1431,20 @@ class generate_c_pous_c {
       }
       
       /* (C.3) Function declaration */
+      /* The body of small FBs is defined as a static inline function, in the POUS.c file that is included
+       * by the resource files calling it. Since the FBs are generated in an order without forward dependencies,
+       * it is always defined before any call, and no declaration is needed in the .h file.
+       * The FBs of a library module are never inlined, as they are also called from the (separately compiled)
+       * projects importing the module.
+       */
+      bool inline_body = calculate_body_size_c::is_inlined(symbol);
+      if (print_declaration && inline_body) {
+        s4o.print("// Code part: inlined, defined in the .c file\n\n\n\n");
+        return;
+      }
       s4o.print("// Code part\n");
       /* function interface */
+      if (inline_body) s4o.print("__INLINE_FB_BODY ");
       s4o.print("void ");
       symbol->fblock_name->accept(print_base);
       s4o.print(FB_FUNCTION_SUFFIX);
@@ -1181,8 +1466,10 @@ class generate_c_pous_c {
         search_var_instance_decl_c search_var(symbol);
         identifier_c  en_var("EN");
         identifier_c eno_var("ENO");
+        // Not needed either if the FB is never called with EN connected to anything other than TRUE (-O e).
         if (   (search_var.get_vartype(& en_var) == search_var_instance_decl_c::input_vt)
-            && (search_var.get_vartype(&eno_var) == search_var_instance_decl_c::output_vt)) {
+            && (search_var.get_vartype(&eno_var) == search_var_instance_decl_c::output_vt)
+            && !(elide_unconnected_en__ && find_connected_en_c::is_en_always_true(symbol, symbol->fblock_body))) {
 
           s4o.print(s4o.indent_spaces + "// Control execution\n");
           s4o.print(s4o.indent_spaces + "if (!");
@@ -1453,7 +1740,67 @@ class generate_c_config_c: public generate_c_base_and_typeid_c {
 
     declaretype_t wanted_declaretype;
 
-    
+private:
+/* Place the located variables in the process image (see generate_process_image_c), and 
+ * exchange the %I and %Q areas with the I/O threads through lock-free triple buffers
+ * (generated with the 'x' stage4 option).
+ *
+ * Each exchange is done with a single atomic operation on the index of the middle buffer, 
+ * so the logic thread (in config_run__()) and the I/O threads never wait for each other:
+ *  - an I/O thread writes the complete input image to config_input_buffer__(), and then
+ *    calls config_input_commit__(). The latest committed inputs are copied to the %I area
+ *    at the start of the following scan cycle.
+ *  - the %Q area is published at the end of each scan cycle. An I/O thread reads the 
+ *    latest published outputs from the buffer returned by config_output_buffer__(), 
+ *    which remains valid until the next call to that function.
+ * The functions support a single input thread and a single output thread.
+ */
+void print_io_image_exchange(void) {
+  s4o.print("/* Located variables, placed in the process image */\n");
+  s4o.print("extern IEC_LWORD __process_image_I[], __process_image_Q[], __process_image_M[];\n");
+  s4o.print("#define __PROCESS_IMAGE_VAR(type, name, area, offset) type *name = (type *)((char *)__process_image_##area + offset);\n");
+  s4o.print("#include \"PROCESS_IMAGE.h\"\n");
+  s4o.print("#undef __PROCESS_IMAGE_VAR\n");
+  s4o.print("#define __IMAGE_WORDS(size) (((size) + sizeof(IEC_LWORD)) / sizeof(IEC_LWORD))\n");
+  s4o.print("IEC_LWORD __process_image_I[__IMAGE_WORDS(__PROCESS_IMAGE_I_SIZE)];\n");
+  s4o.print("IEC_LWORD __process_image_Q[__IMAGE_WORDS(__PROCESS_IMAGE_Q_SIZE)];\n");
+  s4o.print("IEC_LWORD __process_image_M[__IMAGE_WORDS(__PROCESS_IMAGE_M_SIZE)];\n\n");
+
+  s4o.print("/* Triple buffers exchanging the %I and %Q areas with the I/O threads */\n");
+  s4o.print("#define __IO_FRESH 4 /* flag of the middle buffer index: contains data not yet read */\n");
+  s4o.print("static IEC_LWORD __io_buffer_I[3][__IMAGE_WORDS(__PROCESS_IMAGE_I_SIZE)];\n");
+  s4o.print("static IEC_LWORD __io_buffer_Q[3][__IMAGE_WORDS(__PROCESS_IMAGE_Q_SIZE)];\n");
+  s4o.print("static int __io_back_I = 0, __io_middle_I = 1, __io_front_I = 2;\n");
+  s4o.print("static int __io_back_Q = 0, __io_middle_Q = 1, __io_front_Q = 2;\n");
+  s4o.print("#define __IO_PUBLISH(area) \\\n");
+  s4o.print("  __io_back_##area = __atomic_exchange_n(&__io_middle_##area, __io_back_##area | __IO_FRESH, __ATOMIC_ACQ_REL) & 3\n");
+  s4o.print("#define __IO_FETCH(area) \\\n");
+  s4o.print("  ((__atomic_load_n(&__io_middle_##area, __ATOMIC_ACQUIRE) & __IO_FRESH) ? \\\n");
+  s4o.print("   (__io_front_##area = __atomic_exchange_n(&__io_middle_##area, __io_front_##area, __ATOMIC_ACQ_REL) & 3, 1) : 0)\n\n");
+
+  s4o.print("/* called by the I/O threads */\n");
+  s4o.print("void *config_input_buffer__(void) {\n");
+  s4o.print("  return __io_buffer_I[__io_back_I];\n");
+  s4o.print("}\n");
+  s4o.print("void config_input_commit__(void) {\n");
+  s4o.print("  __IO_PUBLISH(I);\n");
+  s4o.print("}\n");
+  s4o.print("const void *config_output_buffer__(void) {\n");
+  s4o.print("  __IO_FETCH(Q);\n");
+  s4o.print("  return __io_buffer_Q[__io_front_Q];\n");
+  s4o.print("}\n\n");
+
+  s4o.print("/* called by config_run__() */\n");
+  s4o.print("static void __io_image_scan_begin(void) {\n");
+  s4o.print("  if (__IO_FETCH(I))\n");
+  s4o.print("    memcpy(__process_image_I, __io_buffer_I[__io_front_I], __PROCESS_IMAGE_I_SIZE);\n");
+  s4o.print("}\n");
+  s4o.print("static void __io_image_scan_end(void) {\n");
+  s4o.print("  memcpy(__io_buffer_Q[__io_back_Q], __process_image_Q, __PROCESS_IMAGE_Q_SIZE);\n");
+  s4o.print("  __IO_PUBLISH(Q);\n");
+  s4o.print("}\n\n");
+}
+
 public:
 /********************/
 /* 2.1.6 - Pragmas  */
@@ -1494,13 +1841,7 @@ void *visit(configuration_declaration_c *symbol) {
   s4o.print("/* Editing this file is not recommended... */\n");
   s4o.print("/*******************************************/\n\n");
   
-  if (runtime_options.disable_implicit_en_eno) {
-    // If we are not generating the EN and ENO parameters for functions and FB,
-    //   then make sure we use the standard library version compiled without these parameters too!
-    s4o.print("#ifndef DISABLE_EN_ENO_PARAMETERS\n");
-    s4o.print("#define DISABLE_EN_ENO_PARAMETERS\n");
-    s4o.print("#endif\n");
-  }
+  print_runtime_lib_defines(s4o);
   
   s4o.print("#include \"iec_std_lib.h\"\n\n");
   s4o.print("#include \"accessor.h\"\n\n"); 
@@ -1512,6 +1853,10 @@ void *visit(configuration_declaration_c *symbol) {
   symbol->configuration_name->accept(*this);
   s4o.print("\n");
   
+  /* (A.2) Located variables in the process image */
+  if (generate_io_image_exchange__)
+    print_io_image_exchange();
+
   /* (A.2) Global variables */
   vardecl = new generate_c_vardecl_c(&s4o,
                                      generate_c_vardecl_c::local_vf,
@@ -1570,15 +1915,24 @@ void *visit(configuration_declaration_c *symbol) {
   symbol->resource_declarations->accept(*this);
   s4o.print("\n");
 
+  if (generate_shared_snapshot__)
+    s4o.print(s4o.indent_spaces + "void config_snapshot_publish__(void);\n\n");
+
   /* (C.2) Run function name... */
   s4o.print(s4o.indent_spaces + "void config");
   s4o.print(FB_RUN_SUFFIX);
   s4o.print("(unsigned long tick) {\n");
   s4o.indent_right();
+  if (generate_io_image_exchange__)
+    s4o.print(s4o.indent_spaces + "__io_image_scan_begin();\n");
 
   /* (C.3) Resources initializations... */
   wanted_declaretype = rundeclare_dt;
   symbol->resource_declarations->accept(*this);
+  if (generate_io_image_exchange__)
+    s4o.print(s4o.indent_spaces + "__io_image_scan_end();\n");
+  if (generate_shared_snapshot__)
+    s4o.print(s4o.indent_spaces + "config_snapshot_publish__();\n");
 
   /* (C.3) Close Public Function body */
   s4o.indent_left();
@@ -1807,13 +2161,7 @@ END_RESOURCE
       s4o.print("/* Editing this file is not recommended... */\n");
       s4o.print("/*******************************************/\n\n");
   
-      if (runtime_options.disable_implicit_en_eno) {
-        // If we are not generating the EN and ENO parameters for functions and FB,
-        //   then make sure we use the standard library version compiled without these parameters too!
-        s4o.print("#ifndef DISABLE_EN_ENO_PARAMETERS\n");
-        s4o.print("#define DISABLE_EN_ENO_PARAMETERS\n");
-        s4o.print("#endif\n");
-      }
+      print_runtime_lib_defines(s4o);
       
       s4o.print("#include \"iec_std_lib.h\"\n\n");
       
@@ -2186,6 +2534,21 @@ END_RESOURCE
 
 #define RESTORE_  "_restore__"
 #define BACKUP_   "_backup__"
+#define RESTORE_DELTA_  "_restore_delta__"
+#define BACKUP_DELTA_   "_backup_delta__"
+
+/* The delta versions of the backup/restore functions (generated with the 'd' stage4 option) 
+ * only copy the variables (or parts of variables) that were marked as dirty since the
+ * previous backup. Every variable/FB instance/program instance copied by the 
+ * backup/restore functions is a 'block', identified by its sequence number. The backup delta 
+ * function copies each changed section of a block as a record:
+ *    int block; int offset; int size; <size bytes of data>
+ * in increasing order of block and offset, so the restore delta function may apply the records 
+ * while walking over the blocks in the same order.
+ */
+static bool is_delta_operation(const char *operation) {
+  return (strcmp(operation, BACKUP_DELTA_) == 0) || (strcmp(operation, RESTORE_DELTA_) == 0);
+}
 
 /* class to generate the forward declaration of the XXXX_backup() and XXXX_restore()
  * functions that will later (in the generated C source code) be defined 
@@ -2206,6 +2569,16 @@ class generate_c_backup_resource_decl_c: public generate_c_base_and_typeid_c {
       s4o.print("void ");
       symbol->resource_name->accept(*this);
       s4o.print("_restore__" "(void **buffer, int *maxsize);\n");      
+      if (generate_plc_state_delta_backup__) {
+        s4o.print(s4o.indent_spaces);
+        s4o.print("void ");
+        symbol->resource_name->accept(*this);
+        s4o.print("_backup_delta__" "(int *block, void **buffer, int *maxsize);\n");      
+        s4o.print(s4o.indent_spaces);
+        s4o.print("void ");
+        symbol->resource_name->accept(*this);
+        s4o.print("_restore_delta__" "(int *block, void **buffer, int *maxsize);\n");      
+      }
       return NULL;
     }
     
@@ -2221,14 +2594,26 @@ class generate_c_backup_resource_decl_c: public generate_c_base_and_typeid_c {
 
 
 /* print out the begining of the generic backup/restore function */
-void print_backup_restore_function_beg(stage4out_c &s4o, const char *func_name, const char *operation) {
-  /* operation will be either "_backup__" or "_restore__" */
+/* For the delta operations, the function generated for the configuration (is_config == true) starts 
+ * numbering the blocks, whereas the functions generated for each resource continue the numbering 
+ * of the blocks, and therefore get passed the number of the next block as a parameter.
+ */
+void print_backup_restore_function_beg(stage4out_c &s4o, const char *func_name, const char *operation, bool is_config = false) {
+  /* operation will be either "_backup__", "_restore__", "_backup_delta__" or "_restore_delta__" */
+  bool delta = is_delta_operation(operation);
+  /* the parameters passed to each call to the operation, in addition to the variable's address and size. */
+  const char *block_arg = delta? "(*block)++, ":"";
   s4o.print("\n");
   s4o.print("void ");
   s4o.print(func_name);
   s4o.print(operation);
-  s4o.print("(void **buffer, int *maxsize) {\n");
+  if (delta && !is_config)
+    s4o.print("(int *block, void **buffer, int *maxsize) {\n");
+  else
+    s4o.print("(void **buffer, int *maxsize) {\n");
   s4o.indent_right();
+  if (delta && is_config)
+    s4o.print(s4o.indent_spaces + "int block__ = 0, *block = &block__;\n");
   // Don't save/restore the __CURRENT_TIME variable, as 'plc controller' has easy access to it
   // and can therefore do the save/restore by itself.
 //s4o.print(s4o.indent_spaces); 
@@ -2237,27 +2622,45 @@ void print_backup_restore_function_beg(stage4out_c &s4o, const char *func_name,
   s4o.print(s4o.indent_spaces);
   s4o.print("#define " DECLARE_GLOBAL          "(vartype, domain, varname) \\\n    ");
   s4o.print(operation);
-  s4o.print("(&domain##__##varname, sizeof(domain##__##varname), buffer, maxsize);\n");
+  s4o.print("(");
+  s4o.print(block_arg);
+  s4o.print("&domain##__##varname, sizeof(domain##__##varname), buffer, maxsize);\n");
   s4o.print(s4o.indent_spaces);
   s4o.print("#define " DECLARE_GLOBAL_FB       "(vartype, domain, varname) \\\n    ");
   s4o.print(operation);
-  s4o.print("(&domain##__##varname, sizeof(domain##__##varname), buffer, maxsize);\n");
+  s4o.print("(");
+  s4o.print(block_arg);
+  s4o.print("&domain##__##varname, sizeof(domain##__##varname), buffer, maxsize);\n");
   s4o.print(s4o.indent_spaces);
   s4o.print("#define " DECLARE_GLOBAL_LOCATION "(vartype, location) \\\n    ");
+  /* Located variables are also changed by the I/O drivers, which do not mark them as dirty,
+   * so the delta functions always consider them as changed.
+   */
+  if (delta)
+    s4o.print("__MARK_DIRTY(location, location); ");
   s4o.print(operation);
-  s4o.print("(location, sizeof(*location), buffer, maxsize);\n");
+  s4o.print("(");
+  s4o.print(block_arg);
+  s4o.print("location, sizeof(*location), buffer, maxsize);\n");
   s4o.print(s4o.indent_spaces);
   s4o.print("#define " DECLARE_GLOBAL_LOCATED  "(vartype, domain, varname) \\\n    ");
   s4o.print(operation);
-  s4o.print("(&domain##__##varname, sizeof(domain##__##varname), buffer, maxsize);\n");
+  s4o.print("(");
+  s4o.print(block_arg);
+  s4o.print("&domain##__##varname, sizeof(domain##__##varname), buffer, maxsize);\n");
 }
 
 /* print out the ending of the generic backup/restore function */
-void print_backup_restore_function_end(stage4out_c &s4o) {
+/* When generating the delta backup functions, any backup of the configuration that completes
+ * successfully (clear_dirty == true) starts a new delta, i.e. clears all the dirty marks.
+ */
+void print_backup_restore_function_end(stage4out_c &s4o, bool clear_dirty = false) {
   s4o.print(s4o.indent_spaces); s4o.print("#undef " DECLARE_GLOBAL          "\n");
   s4o.print(s4o.indent_spaces); s4o.print("#undef " DECLARE_GLOBAL_FB       "\n");
   s4o.print(s4o.indent_spaces); s4o.print("#undef " DECLARE_GLOBAL_LOCATION "\n");
   s4o.print(s4o.indent_spaces); s4o.print("#undef " DECLARE_GLOBAL_LOCATED  "\n");
+  if (clear_dirty && generate_plc_state_delta_backup__)
+    s4o.print(s4o.indent_spaces + "if (*maxsize >= 0) memset(__dirty_cards, 0, sizeof(__dirty_cards));\n");
   s4o.indent_left();
   s4o.print("}\n");      
 }
@@ -2293,6 +2696,14 @@ private:
       s4o.print("void ");
       s4o.print("_restore__");
       s4o.print("(void *varptr, int varsize, void **buffer, int *maxsize);\n");
+      if (generate_plc_state_delta_backup__) {
+        s4o.print("void ");
+        s4o.print("_backup_delta__");
+        s4o.print("(int block, void *varptr, int varsize, void **buffer, int *maxsize);\n");
+        s4o.print("void ");
+        s4o.print("_restore_delta__");
+        s4o.print("(int block, void *varptr, int varsize, void **buffer, int *maxsize);\n");
+      }
   
       s4o.print("\n\n\n");
       s4o.print("#undef " DECLARE_GLOBAL          "\n");
@@ -2344,6 +2755,22 @@ private:
       }
       print_backup_restore_function_end(s4o);      
 
+      if (generate_plc_state_delta_backup__) {
+        const char *delta_operations[] = {BACKUP_DELTA_, RESTORE_DELTA_};
+        for (int i = 0; i < 2; i++) {
+          print_backup_restore_function_beg(s4o, resource_name, delta_operations[i]);
+          if (symbol->global_var_declarations != NULL)
+            vardecl.print(symbol->global_var_declarations);
+          if (symbol->resource_declaration != NULL) {
+            operation = delta_operations[i];
+            symbol->resource_declaration->accept(*this);  // will call visit(single_resource_declaration_c *)
+            operation = NULL;
+          }
+          print_backup_restore_function_end(s4o);      
+        }
+      }
+
+      free(resource_name);
       return NULL;
     }
     
@@ -2359,9 +2786,14 @@ private:
     void *visit(program_configuration_c *symbol) {
       // generate the following source code:
       // _xxxxxx__(&program_name, sizeof(program_name), buffer, maxsize);
+      //   or, for the delta operations
+      // _xxxxxx_delta__((*block)++, &program_name, sizeof(program_name), buffer, maxsize);
       s4o.print(s4o.indent_spaces);
-      s4o.print(operation); // call _restore__() or _backup__()
-      s4o.print("(&"); 
+      s4o.print(operation); // call _restore__(), _backup__(), _restore_delta__() or _backup_delta__()
+      s4o.print("(");
+      if (is_delta_operation(operation))
+        s4o.print("(*block)++, ");
+      s4o.print("&"); 
       symbol->program_name->accept(*this);
       s4o.print(", sizeof(");
       symbol->program_name->accept(*this);
@@ -2398,6 +2830,15 @@ private:
  *          void *buffer = malloc(-1 * maxsize);
  *          // and now to really back the internal state...
  *          config_backup__(&buffer, &maxsize);
+ *
+ *   When the 'd' option is used, two more functions are generated
+ *       config_backup_delta__(void **buffer, int *maxsize)
+ *       config_restore_delta__(void **buffer, int *maxsize)
+ *   that use the same buffer conventions, but only backup the state that 
+ *   changed since the previous (full or delta) backup, and restore such a 
+ *   delta on top of the state previously restored (i.e. the restore delta
+ *   function must be called with *maxsize set to the size of the delta,
+ *   and should return with *maxsize == 0).
  */
 class generate_c_backup_config_c: public generate_c_base_and_typeid_c {
   private:
@@ -2413,6 +2854,60 @@ class generate_c_backup_config_c: public generate_c_base_and_typeid_c {
     virtual ~generate_c_backup_config_c(void) {}
 
     
+  private:
+    /* the table of dirty marks, and the functions that copy a single block of a delta backup */
+    void print_delta_functions(void) {
+      s4o.print("\n");
+      s4o.print("unsigned char __dirty_cards[__DIRTY_CARD_COUNT];\n\n");
+
+      /* offset, within the block starting at varptr, of the first byte of the card following the one with byte (varptr+offset) */
+      s4o.print("#define __NEXT_CARD_OFFSET(varptr, offset) \\\n");
+      s4o.print("  ((int)((((((unsigned long)(varptr) + (offset)) >> __DIRTY_CARD_SHIFT) + 1) << __DIRTY_CARD_SHIFT) - (unsigned long)(varptr)))\n");
+      s4o.print("#define __IS_CARD_DIRTY(varptr, offset) (__dirty_cards[__DIRTY_CARD((char *)(varptr) + (offset))])\n\n");
+
+      s4o.print("void ");
+      s4o.print("_backup_delta__");
+      s4o.print("(int block, void *varptr, int varsize, void **buffer, int *maxsize) {\n");
+      s4o.print("  int header[3], offset = 0, end, recsize;\n");
+      s4o.print("  while (offset < varsize) {\n");
+      s4o.print("    end = __NEXT_CARD_OFFSET(varptr, offset);\n");
+      s4o.print("    if (end > varsize) end = varsize;\n");
+      s4o.print("    if (!__IS_CARD_DIRTY(varptr, offset)) {offset = end; continue;}\n");
+      s4o.print("    /* join all the following dirty cards in the same record */\n");
+      s4o.print("    while ((end < varsize) && __IS_CARD_DIRTY(varptr, end)) {\n");
+      s4o.print("      end = __NEXT_CARD_OFFSET(varptr, end);\n");
+      s4o.print("      if (end > varsize) end = varsize;\n");
+      s4o.print("    }\n");
+      s4o.print("    header[0] = block; header[1] = offset; header[2] = end - offset;\n");
+      s4o.print("    recsize = sizeof(header) + header[2];\n");
+      s4o.print("    if (recsize <= *maxsize) {\n");
+      s4o.print("      memmove(*buffer, header, sizeof(header));\n");
+      s4o.print("      memmove(*buffer + sizeof(header), (char *)varptr + offset, header[2]);\n");
+      s4o.print("      *buffer += recsize;\n");
+      s4o.print("    }\n");
+      s4o.print("    *maxsize -= recsize;\n");
+      s4o.print("    offset = end;\n");
+      s4o.print("  }\n");
+      s4o.print("}\n");
+
+      s4o.print("void ");
+      s4o.print("_restore_delta__");
+      s4o.print("(int block, void *varptr, int varsize, void **buffer, int *maxsize) {\n");
+      s4o.print("  int header[3], recsize;\n");
+      s4o.print("  /* records are sorted by block, so stop at the first record of a following block */\n");
+      s4o.print("  while (*maxsize >= (int)sizeof(header)) {\n");
+      s4o.print("    memmove(header, *buffer, sizeof(header));\n");
+      s4o.print("    if (header[0] != block) return;\n");
+      s4o.print("    recsize = sizeof(header) + header[2];\n");
+      s4o.print("    if ((header[1] < 0) || (header[2] < 0) || (header[1] + header[2] > varsize) || (recsize > *maxsize))\n");
+      s4o.print("      {*maxsize = -1; return;} /* corrupted or truncated delta */\n");
+      s4o.print("    memmove((char *)varptr + header[1], *buffer + sizeof(header), header[2]);\n");
+      s4o.print("    *buffer += recsize;\n");
+      s4o.print("    *maxsize -= recsize;\n");
+      s4o.print("  }\n");
+      s4o.print("}\n");
+    }
+
   public:
     /********************/
     /* 2.1.6 - Pragmas  */
@@ -2445,6 +2940,9 @@ class generate_c_backup_config_c: public generate_c_base_and_typeid_c {
       s4o.print("  *maxsize -= varsize;\n");
       s4o.print("}\n");
       
+      if (generate_plc_state_delta_backup__) 
+        print_delta_functions();
+      
       
       generate_c_vardecl_c vardecl = generate_c_vardecl_c(&s4o,
                                          generate_c_vardecl_c::local_vf,
@@ -2466,7 +2964,7 @@ class generate_c_backup_config_c: public generate_c_base_and_typeid_c {
       func_to_call = "_backup__";
       symbol->resource_declarations->accept(*this);  // will call resource_declaration_list_c or single_resource_declaration_c
       func_to_call = NULL;
-      print_backup_restore_function_end(s4o);      
+      print_backup_restore_function_end(s4o, true);      
     
       print_backup_restore_function_beg(s4o, "config", "_restore__");
       vardecl.print(symbol);
@@ -2476,6 +2974,24 @@ class generate_c_backup_config_c: public generate_c_base_and_typeid_c {
       func_to_call = NULL;
       print_backup_restore_function_end(s4o);      
       
+      if (generate_plc_state_delta_backup__) {
+        print_backup_restore_function_beg(s4o, "config", BACKUP_DELTA_, true);
+        vardecl.print(symbol);
+        s4o.print("\n");
+        func_to_call = BACKUP_DELTA_;
+        symbol->resource_declarations->accept(*this);  // will call resource_declaration_list_c or single_resource_declaration_c
+        func_to_call = NULL;
+        print_backup_restore_function_end(s4o, true);      
+      
+        print_backup_restore_function_beg(s4o, "config", RESTORE_DELTA_, true);
+        vardecl.print(symbol);
+        s4o.print("\n");
+        func_to_call = RESTORE_DELTA_;
+        symbol->resource_declarations->accept(*this);  // will call resource_declaration_list_c or single_resource_declaration_c
+        func_to_call = NULL;
+        print_backup_restore_function_end(s4o);      
+      }
+      
       return NULL;
     }
     
@@ -2483,7 +2999,10 @@ class generate_c_backup_config_c: public generate_c_base_and_typeid_c {
       s4o.print(s4o.indent_spaces);
       symbol->resource_name->accept(*this);
       s4o.print(func_to_call);
-      s4o.print("(buffer, maxsize);\n");      
+      if (is_delta_operation(func_to_call))
+        s4o.print("(block, buffer, maxsize);\n");      
+      else
+        s4o.print("(buffer, maxsize);\n");      
       return NULL;
     }
     
@@ -2501,6 +3020,309 @@ class generate_c_backup_config_c: public generate_c_base_and_typeid_c {
 
 
 
+/* Classes to generate the retain image and shared snapshot tables and functions... */
+/* (generated with the 'r' and 'h' stage4 options, respectively)
+ *
+ * The retain image is a contiguous copy of the values of all the RETAIN variables in the
+ * configuration, so that the runtime may persist them with a single write (e.g. to a
+ * memory mapped file) at the end of each scan cycle, instead of walking all the variables
+ * looking for the ones with the __IEC_RETAIN_FLAG set.
+ *
+ * The shared snapshot is a contiguous copy of the values of all the variables in the
+ * configuration, published at the end of each scan cycle to a shared memory block, so that
+ * external readers (HMI, historian, ...) may read consistent values directly from the shared
+ * memory, without going through the debugger. The block starts with a __shared_snapshot_t
+ * header (see accessor.h), and is updated following the seqlock protocol, i.e. the sequence
+ * number in the header is odd while the values are being written. The writer never waits 
+ * for the readers; a reader simply retries if the sequence number changed while it read.
+ *
+ * Each resource (and the configuration itself, for its own global variables) gets a table
+ * with the address, size, type and name of every variable it stores in the image:
+ *       __image_entry_t RES1_retain_table__[] = {
+ *         __IMAGE_ENTRY(RES1__INSTANCE0.COUNTER, "INT", "CONFIG0.RES1.INSTANCE0.COUNTER")
+ *         ...
+ *         __IMAGE_TABLE_END
+ *       };
+ *   and the configuration gets the following:
+ *       __image_entry_t *config_retain_tables__[]
+ *       __image_entry_t *config_snapshot_tables__[]
+ *           NULL terminated list of all the above tables, i.e. the description of the layout.
+ *
+ *       unsigned long config_retain_init__(void)
+ *           lays out the retain image, i.e. sets the offset of each table entry, and
+ *           returns the size of the image.
+ *       void config_retain_save__(void *image)
+ *           copies the current value of all RETAIN variables into the image.
+ *       void config_retain_restore__(void *image)
+ *           copies the values in the image back into the RETAIN variables. To be called
+ *           after config_init__(), which sets the variables to their initial values.
+ *
+ *       unsigned long config_snapshot_init__(void)
+ *           lays out the snapshot, computes the version of the layout (a hash of the names,
+ *           types and sizes of all the variables, in order), and returns the size of the 
+ *           shared memory block (header and layout description included).
+ *       __shared_snapshot_t *config_snapshot__
+ *           the shared memory block, set by the runtime after calling config_snapshot_init__().
+ *       void config_snapshot_publish__(void)
+ *           copies the current value of all variables into the shared memory block.
+ *           Called by config_run__() at the end of each scan cycle. The first time (or
+ *           whenever the block holds another version), the name, type, offset and size of
+ *           every variable is also written into the block, after the values, so that the
+ *           readers do not need the tables compiled into the PLC program to find them.
+ *
+ *   A variable is RETAIN if it is declared inside a RETAIN section, or (when not
+ *   explicitly declared NON_RETAIN) inside a FB instance or PROGRAM instance that is RETAIN.
+ *   External and located variables are not included in either image, as they only 
+ *   reference variables stored elsewhere.
+ */
+typedef enum {
+  retain_it,
+  snapshot_it
+} imagetype_t;
+
+static const char *image_table_suffix(imagetype_t imagetype) {
+  return (imagetype == retain_it)? "_retain_table__" : "_snapshot_table__";
+}
+
+/* generate the retain/snapshot table of a RESOURCE, in the <resource>.c file */
+class generate_c_image_resource_c: public generate_c_base_and_typeid_c {
+  private:
+    symbol_c *library;
+    symbol_c *configuration;
+    imagetype_t imagetype;
+
+    void print_table(symbol_c *resource_name, symbol_c *scope) {
+      generate_var_list_c generate_var_list(&s4o, library);
+      s4o.print("\n\n\n");
+      s4o.print("__image_entry_t ");
+      resource_name->accept(*this);
+      s4o.print(image_table_suffix(imagetype));
+      s4o.print("[] = {\n");
+      generate_var_list.generate_image_table(configuration, scope, imagetype == retain_it);
+      s4o.print("  __IMAGE_TABLE_END\n");
+      s4o.print("};\n");
+    }
+
+  public:
+    generate_c_image_resource_c(stage4out_c *s4o_ptr, symbol_c *library, symbol_c *configuration, imagetype_t imagetype)
+      : generate_c_base_and_typeid_c(s4o_ptr) {
+      this->library       = library;
+      this->configuration = configuration;
+      this->imagetype     = imagetype;
+    };
+
+    virtual ~generate_c_image_resource_c(void) {}
+
+    /********************************/
+    /* B 1.7 Configuration elements */
+    /********************************/
+    void *visit(resource_declaration_c *symbol) {
+      print_table(symbol->resource_name, symbol);
+      return NULL;
+    }
+
+    /* configuration without any RESOURCE, generated in RESOURCE.c */
+    void *visit(single_resource_declaration_c *symbol) {
+      identifier_c resource_name("RESOURCE");
+      print_table(&resource_name, symbol);
+      return NULL;
+    }
+};
+
+
+/* generate the retain/snapshot table of the CONFIGURATION and the functions handling the image */
+class generate_c_image_config_c: public generate_c_base_and_typeid_c {
+  private:
+    symbol_c *library;
+    imagetype_t imagetype;
+    
+    typedef enum {
+      declare_rt,
+      list_rt
+    } wantedtable_t;
+
+    wantedtable_t wanted_table;
+
+    void print_retain_functions(void) {
+      s4o.print("unsigned long config_retain_init__(void) {\n");
+      s4o.print("  __image_entry_t **table, *entry;\n");
+      s4o.print("  unsigned long size = 0;\n");
+      s4o.print("  __FOR_EACH_IMAGE_ENTRY(config_retain_tables__, table, entry) {\n");
+      s4o.print("    entry->offset = size;\n");
+      s4o.print("    size += entry->size;\n");
+      s4o.print("  }\n");
+      s4o.print("  return size;\n");
+      s4o.print("}\n");
+
+      s4o.print("void config_retain_save__(void *image) {\n");
+      s4o.print("  __image_entry_t **table, *entry;\n");
+      s4o.print("  __FOR_EACH_IMAGE_ENTRY(config_retain_tables__, table, entry)\n");
+      s4o.print("    memcpy((char *)image + entry->offset, entry->varptr, entry->size);\n");
+      s4o.print("}\n");
+
+      s4o.print("void config_retain_restore__(void *image) {\n");
+      s4o.print("  __image_entry_t **table, *entry;\n");
+      s4o.print("  __FOR_EACH_IMAGE_ENTRY(config_retain_tables__, table, entry)\n");
+      s4o.print("    memcpy(entry->varptr, (char *)image + entry->offset, entry->size);\n");
+      s4o.print("}\n");
+    }
+
+    void print_snapshot_functions(void) {
+      s4o.print("__shared_snapshot_t *config_snapshot__ = NULL;\n");
+      s4o.print("static unsigned long __snapshot_version = 0, __snapshot_size = 0, __snapshot_entries = 0, __snapshot_layout = 0;\n\n");
+
+      s4o.print("#define __FNV_HASH(hash, value) ((hash) = (((hash) ^ (unsigned char)(value)) * 16777619UL) & 0xFFFFFFFFUL)\n");
+      s4o.print("unsigned long config_snapshot_init__(void) {\n");
+      s4o.print("  __image_entry_t **table, *entry;\n");
+      s4o.print("  unsigned long size = 0, entries = 0, strings = 0, version = 2166136261UL;\n");
+      s4o.print("  const char *c;\n");
+      s4o.print("  __FOR_EACH_IMAGE_ENTRY(config_snapshot_tables__, table, entry) {\n");
+      s4o.print("    entry->offset = size;\n");
+      s4o.print("    size += entry->size;\n");
+      s4o.print("    entries++;\n");
+      s4o.print("    strings += strlen(entry->name) + strlen(entry->type) + 2;\n");
+      s4o.print("    for (c = entry->name; *c != '\\0'; c++) __FNV_HASH(version, *c);\n");
+      s4o.print("    for (c = entry->type; *c != '\\0'; c++) __FNV_HASH(version, *c);\n");
+      s4o.print("    __FNV_HASH(version, entry->size);\n");
+      s4o.print("    __FNV_HASH(version, entry->size >> 8);\n");
+      s4o.print("  }\n");
+      s4o.print("  __snapshot_version = version;\n");
+      s4o.print("  __snapshot_size = size;\n");
+      s4o.print("  __snapshot_entries = entries;\n");
+      s4o.print("  /* the layout description follows the values, aligned */\n");
+      s4o.print("  __snapshot_layout = sizeof(__shared_snapshot_t) + size;\n");
+      s4o.print("  __snapshot_layout = (__snapshot_layout + sizeof(unsigned long) - 1) / sizeof(unsigned long) * sizeof(unsigned long);\n");
+      s4o.print("  return __snapshot_layout + entries * sizeof(__shared_snapshot_entry_t) + strings;\n");
+      s4o.print("}\n");
+      s4o.print("#undef __FNV_HASH\n");
+
+      s4o.print("/* write the description of the layout into the shared memory block */\n");
+      s4o.print("static void __snapshot_describe(__shared_snapshot_t *snapshot) {\n");
+      s4o.print("  __image_entry_t **table, *entry;\n");
+      s4o.print("  __shared_snapshot_entry_t *layout = (__shared_snapshot_entry_t *)((char *)snapshot + __snapshot_layout);\n");
+      s4o.print("  unsigned long string = __snapshot_layout + __snapshot_entries * sizeof(__shared_snapshot_entry_t);\n");
+      s4o.print("  __FOR_EACH_IMAGE_ENTRY(config_snapshot_tables__, table, entry) {\n");
+      s4o.print("    layout->offset = entry->offset;\n");
+      s4o.print("    layout->size   = entry->size;\n");
+      s4o.print("    layout->name   = string;\n");
+      s4o.print("    strcpy((char *)snapshot + string, entry->name);\n");
+      s4o.print("    string += strlen(entry->name) + 1;\n");
+      s4o.print("    layout->type   = string;\n");
+      s4o.print("    strcpy((char *)snapshot + string, entry->type);\n");
+      s4o.print("    string += strlen(entry->type) + 1;\n");
+      s4o.print("    layout++;\n");
+      s4o.print("  }\n");
+      s4o.print("  snapshot->magic   = __SHARED_SNAPSHOT_MAGIC;\n");
+      s4o.print("  snapshot->version = __snapshot_version;\n");
+      s4o.print("  snapshot->size    = __snapshot_size;\n");
+      s4o.print("  snapshot->entries = __snapshot_entries;\n");
+      s4o.print("  snapshot->layout  = __snapshot_layout;\n");
+      s4o.print("}\n");
+
+      s4o.print("void config_snapshot_publish__(void) {\n");
+      s4o.print("  __shared_snapshot_t *snapshot = config_snapshot__;\n");
+      s4o.print("  __image_entry_t **table, *entry;\n");
+      s4o.print("  unsigned long sequence;\n");
+      s4o.print("  if (snapshot == NULL) return;\n");
+      s4o.print("  /* odd sequence number while writing */\n");
+      s4o.print("  sequence = snapshot->sequence | 1;\n");
+      s4o.print("  __atomic_store_n(&snapshot->sequence, sequence, __ATOMIC_RELAXED);\n");
+      s4o.print("  __atomic_thread_fence(__ATOMIC_RELEASE);\n");
+      s4o.print("  if ((snapshot->magic != __SHARED_SNAPSHOT_MAGIC) || (snapshot->version != __snapshot_version))\n");
+      s4o.print("    __snapshot_describe(snapshot);\n");
+      s4o.print("  __FOR_EACH_IMAGE_ENTRY(config_snapshot_tables__, table, entry)\n");
+      s4o.print("    memcpy(__SHARED_SNAPSHOT_DATA(snapshot) + entry->offset, entry->varptr, entry->size);\n");
+      s4o.print("  __atomic_store_n(&snapshot->sequence, sequence + 1, __ATOMIC_RELEASE);\n");
+      s4o.print("}\n");
+    }
+
+  public:
+    generate_c_image_config_c(stage4out_c *s4o_ptr, symbol_c *library, imagetype_t imagetype)
+      : generate_c_base_and_typeid_c(s4o_ptr) {
+      this->library   = library;
+      this->imagetype = imagetype;
+      wanted_table    = declare_rt;
+    };
+
+    virtual ~generate_c_image_config_c(void) {}
+
+    /********************/
+    /* 2.1.6 - Pragmas  */
+    /********************/
+    void *visit(enable_code_generation_pragma_c * symbol)   {s4o.enable_output(); return NULL;}
+    void *visit(disable_code_generation_pragma_c * symbol)  {s4o.disable_output();return NULL;}
+
+    /********************************/
+    /* B 1.7 Configuration elements */
+    /********************************/
+    /*
+    SYM_REF6(configuration_declaration_c, configuration_name, global_var_declarations, resource_declarations, access_declarations, instance_specific_initializations, unused)
+    */
+    void *visit(configuration_declaration_c *symbol) {
+      generate_var_list_c generate_var_list(&s4o, library);
+      const char *suffix = image_table_suffix(imagetype);
+      
+      s4o.print("\n\n\n");
+      s4o.print("static __image_entry_t config");
+      s4o.print(suffix);
+      s4o.print("[] = {\n");
+      generate_var_list.generate_image_table(symbol, symbol, imagetype == retain_it);
+      s4o.print("  __IMAGE_TABLE_END\n");
+      s4o.print("};\n");
+
+      wanted_table = declare_rt;
+      symbol->resource_declarations->accept(*this);
+      
+      s4o.print("\n");
+      s4o.print("__image_entry_t *config");
+      s4o.print((imagetype == retain_it)? "_retain_tables__" : "_snapshot_tables__");
+      s4o.print("[] = {\n");
+      s4o.print("  config");
+      s4o.print(suffix);
+      s4o.print(",\n");
+      wanted_table = list_rt;
+      symbol->resource_declarations->accept(*this);
+      s4o.print("  NULL\n");
+      s4o.print("};\n\n");
+
+      s4o.print("#ifndef __FOR_EACH_IMAGE_ENTRY\n");
+      s4o.print("#define __FOR_EACH_IMAGE_ENTRY(tables, table, entry) \\\n");
+      s4o.print("  for (table = tables; *table != NULL; table++) \\\n");
+      s4o.print("    for (entry = *table; entry->varptr != NULL; entry++)\n");
+      s4o.print("#endif\n\n");
+
+      if (imagetype == retain_it)
+        print_retain_functions();
+      else
+        print_snapshot_functions();
+      return NULL;
+    }
+
+    void *visit(resource_declaration_c *symbol) {
+      if (wanted_table == declare_rt)
+        s4o.print("extern __image_entry_t ");
+      else
+        s4o.print("  ");
+      symbol->resource_name->accept(*this);
+      s4o.print(image_table_suffix(imagetype));
+      s4o.print((wanted_table == declare_rt)? "[];\n":",\n");
+      return NULL;
+    }
+
+    void *visit(single_resource_declaration_c *symbol) {
+      if (wanted_table == declare_rt)
+        s4o.print("extern __image_entry_t ");
+      else
+        s4o.print("  ");
+      s4o.print("RESOURCE");
+      s4o.print(image_table_suffix(imagetype));
+      s4o.print((wanted_table == declare_rt)? "[];\n":",\n");
+      return NULL;
+    }
+};
+
+
+
 /***********************************************************************/
 /***********************************************************************/
 /***********************************************************************/
@@ -2522,6 +3344,7 @@ class generate_c_c: public iterator_visitor_c {
     generate_c_implicit_typedecl_c generate_c_implicit_typedecl;
     generate_c_pous_c              generate_c_pous;
     
+    symbol_c   *current_library;
     symbol_c   *current_configuration;
 
     const char *current_name;
@@ -2534,20 +3357,43 @@ class generate_c_c: public iterator_visitor_c {
   public:
     generate_c_c(stage4out_c *s4o_ptr, const char *builddir): 
             s4o(*s4o_ptr),
-            pous_s4o(builddir, "POUS", "c"),
-            pous_incl_s4o(builddir, "POUS", "h"),
+            pous_s4o(builddir, pous_filename(), "c"),
+            pous_incl_s4o(builddir, pous_filename(), "h"),
             located_variables_s4o(builddir, "LOCATED_VARIABLES","h"),
             variables_s4o(builddir, "VARIABLES","csv"),
             generate_c_typedecl         (&pous_incl_s4o),
             generate_c_implicit_typedecl(&pous_incl_s4o, &generate_c_typedecl)
     {
       current_builddir = builddir;
+      current_library = NULL;
       current_configuration = NULL;
       allow_output = true;
+      common_ticktime = 0; /* printed in VARIABLES.csv even when there is no CONFIGURATION */
     }
             
     ~generate_c_c(void) {}
 
+  private:
+    /* The code of the POUs is generated into POUS.c and POUS.h, or, when compiling a
+     * library module, into <module_name>.c and <module_name>.h (see absyntax_utils/library_module.hh)
+     */
+    static const char *pous_filename(void) {
+      static const char *filename = (NULL == runtime_options.export_module)? "POUS" : library_module_c::name(runtime_options.export_module);
+      return filename;
+    }
+
+    /* The guard against multiple inclusion of <pous_filename>.h (e.g. __POUS_H) */
+    static void print_pous_incl_guard(stage4out_c &s4o) {
+      s4o.print("__");
+      for (const char *c = pous_filename(); *c != '\0'; c++) {
+        char guard_char[2] = {isalnum(*c)? (char)toupper(*c) : '_', '\0'};
+        s4o.print(guard_char);
+      }
+      s4o.print("_H");
+    }
+
+  public:
+
 
 
 /********************/
@@ -2578,23 +3424,38 @@ class generate_c_c: public iterator_visitor_c {
 /* B 0 - Programming Model */
 /***************************/
     void *visit(library_c *symbol) {
-      pous_incl_s4o.print("#ifndef __POUS_H\n#define __POUS_H\n\n");
-      
-      if (runtime_options.disable_implicit_en_eno) {
-        // If we are not generating the EN and ENO parameters for functions and FB,
-        //   then make sure we use the standard library version compiled without these parameters too!
-        pous_incl_s4o.print("#ifndef DISABLE_EN_ENO_PARAMETERS\n");
-        pous_incl_s4o.print("#define DISABLE_EN_ENO_PARAMETERS\n");
-        pous_incl_s4o.print("#endif\n");
-      }
+      current_library = symbol;
+      pous_incl_s4o.print("#ifndef "); print_pous_incl_guard(pous_incl_s4o); pous_incl_s4o.print("\n");
+      pous_incl_s4o.print("#define "); print_pous_incl_guard(pous_incl_s4o); pous_incl_s4o.print("\n\n");
+      
+      print_runtime_lib_defines(pous_incl_s4o);
       
       pous_incl_s4o.print("#include \"accessor.h\"\n#include \"iec_std_lib.h\"\n\n");
 
+      /* the declarations of the imported library modules, whose code has already been generated */
+      for (int i = 0; i < runtime_options.import_module_count; i++) {
+        pous_incl_s4o.print("#include \"");
+        pous_incl_s4o.print(library_module_c::name(runtime_options.import_modules[i]));
+        pous_incl_s4o.print(".h\"\n");
+      }
+      if (runtime_options.import_module_count > 0)
+        pous_incl_s4o.print("\n");
+
+      /* the code of a library module is compiled on its own, and not included by the resource files */
+      if (NULL != runtime_options.export_module) {
+        pous_s4o.print("#include \"");
+        pous_s4o.print(pous_filename());
+        pous_s4o.print(".h\"\n\n");
+      }
+
+      if (elide_unconnected_en__)
+        find_connected_en_c::find(symbol);
+
       for(int i = 0; i < symbol->n; i++) {
         symbol->get_element(i)->accept(*this);
       }
 
-      pous_incl_s4o.print("#endif //__POUS_H\n");
+      pous_incl_s4o.print("#endif //"); print_pous_incl_guard(pous_incl_s4o); pous_incl_s4o.print("\n");
       
       generate_var_list_c generate_var_list(&variables_s4o, symbol);
       generate_var_list.generate_programs(symbol);
@@ -2605,6 +3466,12 @@ class generate_c_c: public iterator_visitor_c {
 
       generate_location_list_c generate_location_list(&located_variables_s4o);
       symbol->accept(generate_location_list);
+
+      if (generate_process_image__ > 0) {
+        stage4out_c process_image_s4o(current_builddir, "PROCESS_IMAGE", "h");
+        generate_process_image_c generate_process_image(&process_image_s4o);
+        generate_process_image.generate(symbol);
+      }
       return NULL;
     }
 
@@ -2642,7 +3509,13 @@ class generate_c_c: public iterator_visitor_c {
  *          specially created stage4out_c (s4o_c and s4o_h) will not comply with the enable/disable_code_generation_pragma_c
  */
 #define handle_pou(fname,pname) \
-      if (!allow_output) return NULL;\
+      if (!allow_output) {\
+        /* The code of this POU is not generated (e.g. it belongs to an imported library module), but the arrays   */\
+        /* and REF_TOs it implicitly declares have already been declared in the included header file. We still     */\
+        /* visit them (with output disabled) so that the same implicit datatypes are not declared a second time.   */\
+        symbol->accept(generate_c_implicit_typedecl);\
+        return NULL;\
+      }\
       if (generate_pou_filepairs__) {\
         const char *pou_name = get_datatype_info_c::get_id_str(pname);\
         stage4out_c s4o_c(current_builddir, pou_name, "c");\
@@ -2738,6 +3611,16 @@ class generate_c_c: public iterator_visitor_c {
           generate_c_backup_config_c generate_backup = generate_c_backup_config_c(&config_s4o);
           symbol->accept(generate_backup);
         }
+
+        if (generate_retain_image__ > 0) {
+          generate_c_image_config_c generate_retain(&config_s4o, current_library, retain_it);
+          symbol->accept(generate_retain);
+        }
+
+        if (generate_shared_snapshot__ > 0) {
+          generate_c_image_config_c generate_snapshot(&config_s4o, current_library, snapshot_it);
+          symbol->accept(generate_snapshot);
+        }
       }
 
       symbol->resource_declarations->accept(*this);
@@ -2757,6 +3640,14 @@ class generate_c_c: public iterator_visitor_c {
         generate_c_backup_resource_c generate_backup = generate_c_backup_resource_c(&resources_s4o);
         symbol->accept(generate_backup);
       }
+      if (generate_retain_image__ > 0) {
+        generate_c_image_resource_c generate_retain(&resources_s4o, current_library, current_configuration, retain_it);
+        symbol->accept(generate_retain);
+      }
+      if (generate_shared_snapshot__ > 0) {
+        generate_c_image_resource_c generate_snapshot(&resources_s4o, current_library, current_configuration, snapshot_it);
+        symbol->accept(generate_snapshot);
+      }
       return NULL;
     }
 
@@ -2764,6 +3655,14 @@ class generate_c_c: public iterator_visitor_c {
       stage4out_c resources_s4o(current_builddir, "RESOURCE", "c");
       generate_c_resources_c generate_c_resources(&resources_s4o, current_configuration, symbol, common_ticktime);
       symbol->accept(generate_c_resources);
+      if (generate_retain_image__ > 0) {
+        generate_c_image_resource_c generate_retain(&resources_s4o, current_library, current_configuration, retain_it);
+        symbol->accept(generate_retain);
+      }
+      if (generate_shared_snapshot__ > 0) {
+        generate_c_image_resource_c generate_snapshot(&resources_s4o, current_library, current_configuration, snapshot_it);
+        symbol->accept(generate_snapshot);
+      }
       return NULL;
     }
     
@@ -142,6 +142,37 @@ class generate_c_base_c: public iterator_visitor_c {
       return NULL;
     }
 
+    /* Print the value of a variable (or any other expression) whose value is known at compile time
+     * (stage3 constant propagation), as a literal of the expression's datatype.
+     * Only BOOL, ANY_INT and ANY_BIT values are handled. Returns false (without printing anything) if the
+     * value is not known, or may not be replaced by a literal, in which case the caller should print the expression.
+     */
+    bool print_propagated_value(symbol_c *symbol) {
+      if (!generate_propagated_values__) return false; /* global variable generate_propagated_values__ is defined in generate_c.cc */
+      symbol_c *datatype = symbol->datatype;
+      if (NULL == datatype) return false;
+      if (get_datatype_info_c::is_BOOL_compatible(datatype)) {
+        if (!VALID_CVALUE(bool, symbol)) return false;
+        s4o.print(GET_CVALUE(bool, symbol)? "__BOOL_LITERAL(TRUE)" : "__BOOL_LITERAL(FALSE)");
+        return true;
+      }
+      if (get_datatype_info_c::is_ANY_signed_INT_compatible(datatype)) {
+        if (!VALID_CVALUE(int64, symbol) || (GET_CVALUE(int64, symbol) == INT64_MIN)) return false; // INT64_MIN has no C literal!
+        s4o.print("__"); datatype->accept(*this); s4o.print("_LITERAL(");
+        s4o.print((long long int)GET_CVALUE(int64, symbol));
+        s4o.print(")");
+        return true;
+      }
+      if (get_datatype_info_c::is_ANY_unsigned_INT_compatible(datatype) || get_datatype_info_c::is_ANY_BIT_compatible(datatype)) {
+        if (!VALID_CVALUE(uint64, symbol) || (GET_CVALUE(uint64, symbol) > INT64_MAX)) return false; // the 64 bit literal suffix is signed!
+        s4o.print("__"); datatype->accept(*this); s4o.print("_LITERAL(");
+        s4o.print((unsigned long long int)GET_CVALUE(uint64, symbol));
+        s4o.print(")");
+        return true;
+      }
+      return false;
+    }
+
     void *print_striped_token(token_c *token, int offset = 0) {
       std::string str = "";
       bool leading_zero = true;
@@ -249,6 +280,30 @@ class generate_c_base_c: public iterator_visitor_c {
       return NULL;
     }
 
+    /* With the compact SFC state (-O c option) the time a step has been active is not kept in the
+     * step's entry in __step_list, but in __step_timer_list. So stepname.T is printed as the
+     * SFC_STEP_TIMER_PREFIX<stepname> macro (see generate_c_sfcdecl_c), without any variable prefix.
+     * Returns false if symbol is not a stepname.T, and nothing was printed.
+     */
+    bool print_step_timer(structured_variable_c *symbol) {
+      if (!generate_compact_sfc__)                                                return false;
+      if (!get_datatype_info_c::is_sfc_step(symbol->record_variable->datatype)) return false;
+      token_c *field = dynamic_cast<token_c *>(symbol->field_selector);
+      if ((NULL == field) || (strcasecmp(field->value, "T") != 0))               return false;
+      s4o.print(SFC_STEP_TIMER_PREFIX);
+      get_var_name_c::get_last_field(symbol->record_variable)->accept(*this);
+      return true;
+    }
+
+    /* the value of stepname.T, in the code of the SFC engine */
+    void print_step_time(symbol_c *step_name) {
+      print_variable_prefix();
+      if (generate_compact_sfc__)
+        s4o.print(SFC_STEP_TIMER_PREFIX);
+      step_name->accept(*this);
+      s4o.print(generate_compact_sfc__ ? ".value" : ".T.value");
+    }
+
     /* Call a standard library function that does a comparison (GT, NE, EQ, LT, ...)
      * NOTE: Typically, the function will have the following parameters: 
      *         1st parameter: EN  (enable)
@@ -298,6 +353,27 @@ class generate_c_base_c: public iterator_visitor_c {
       return NULL;
     }
 
+    /* Print the subscript of one dimension of an array variable, as an offset from the lower limit of the dimension.
+     * With -O a, the subscripts that stage 3 (array_range_check_c) could not prove to always lie within the limits
+     * are passed through __ARRAY_INDEX(), which clamps the offset to the size of the dimension.
+     */
+    void print_array_subscript(subscript_list_c *subscript_list, int i, subrange_c *dimension) {
+      bool check = check_array_bounds__;
+      if ((size_t)i < subscript_list->range_proof.size()) {
+        if  (subscript_list->range_proof[i] == 1)                           check = false;
+        if ((subscript_list->range_proof[i] == 2) && disable_debug_code__)  check = false; /* no variable can be forced */
+      }
+      s4o.print(check? "[__ARRAY_INDEX((" : "[(");
+      subscript_list->get_element(i)->accept(*this);
+      s4o.print(") - (");
+      dimension->accept(*this);
+      if (check) {
+        s4o.print("), ");
+        s4o.print(dimension->dimension);
+      }
+      s4o.print(")]");
+    }
+
     void *print_check_function(symbol_c *type,
           symbol_c *value,
           symbol_c *fb_name = NULL,
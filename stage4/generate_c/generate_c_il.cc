@@ -82,8 +82,9 @@ class il_default_variable_visitor_c {
  * It includes a reference to its name,
  * and the data type of the data currently stored
  * in this C++ variable... This is required because the
- * C++ variable is a union, and we must know which member
- * of the union top reference!!
+ * IL implicit variable is mapped onto one strongly typed C
+ * variable per data type (e.g. __IL_DEFVAR_INT, __IL_DEFVAR_BOOL, ...),
+ * and we must know which of these C variables to reference!!
  *
  * Note that we also need to keep track of the data type of
  * the value currently being stored in the IL implicit variable.
@@ -117,6 +118,89 @@ class il_default_variable_c: public symbol_c {
 };
 
 
+/* A class to list the data types stored in the IL implicit variable
+ * by an instruction list, so we only declare the typed C variables
+ * it really uses.
+ *
+ * The IL implicit variable of a parenthesised instruction list
+ * (simple_instr_list_c) is declared in a new C scope, so its data types
+ * are collected separately, when that scope is generated.
+ * The variable used to pass the result of the parenthesised instruction
+ * lists to the enclosing scope (IL_DEFVAR_BACK) is however declared only
+ * once, so the data types of all the (nested) parenthesised instruction
+ * lists are collected together (back_variable == true).
+ */
+class il_implicit_variable_types_c: public iterator_visitor_c {
+  private:
+    symbol_c *root;
+    bool back_variable;
+    std::vector <symbol_c *> datatypes;
+
+    /* Two data types share the same C variable if they have the same name (see variable_suffix()) */
+    static bool same_variable(symbol_c *first_type, symbol_c *second_type) {
+      const char *first_name  = variable_suffix(first_type);
+      const char *second_name = variable_suffix(second_type);
+      if ((NULL == first_name) || (NULL == second_name)) return (first_type == second_type);
+      return (0 == strcmp(first_name, second_name));
+    }
+
+    void add_datatype(symbol_c *datatype) {
+      /* instructions that do not change the IL implicit variable (e.g. JMP, labels) have an invalid data type */
+      if (!get_datatype_info_c::is_type_valid(datatype)) return;
+      for (unsigned int i = 0; i < datatypes.size(); i++)
+        if (same_variable(datatypes[i], datatype)) return;
+      datatypes.push_back(datatype);
+    }
+
+  public:
+    /* The name of the data type, appended to the name of the C variable that stores it, or NULL if it has no name.
+     * All the elementary data types that are stored in the same C data type (e.g. SAFEBOOL, BOOL, and any
+     * type derived directly from them) share the same C variable, since stage3 may mix them in a single
+     * operation (e.g. 'LD safebool_var  AND bool_var' results in a BOOL), just like they used to share the
+     * same member of the old __IL_DEFVAR_T union.
+     */
+    static const char *variable_suffix(symbol_c *datatype) {
+      if (get_datatype_info_c::is_ANY_ELEMENTARY_compatible(datatype))
+        datatype = search_base_type_c::get_basetype_decl(datatype);
+      symbol_c *datatype_id = get_datatype_info_c::get_id(datatype);
+      if (NULL == datatype_id) return NULL;
+      const char *name = get_datatype_info_c::get_id_str(datatype_id);
+      if (get_datatype_info_c::is_ANY_SAFEELEMENTARY(datatype) && (0 == strncmp(name, "SAFE", 4))) name += 4;
+      return name;
+    }
+
+    il_implicit_variable_types_c(symbol_c *il_list, bool back_variable) {
+      this->root = il_list;
+      this->back_variable = back_variable;
+      if (NULL != il_list) il_list->accept(*this);
+    }
+
+    int size(void) {return datatypes.size();}
+    symbol_c *get_datatype(int i) {return datatypes[i];}
+
+    void *visit(il_instruction_c *symbol) {
+      if (!back_variable) add_datatype(symbol->datatype);
+      return iterator_visitor_c::visit(symbol);
+    }
+
+    void *visit(il_simple_instruction_c *symbol) {
+      if (!back_variable) add_datatype(symbol->datatype);
+      return iterator_visitor_c::visit(symbol);
+    }
+
+    void *visit(simple_instr_list_c *symbol) {
+      if (back_variable) {
+        add_datatype(symbol->datatype);
+        return iterator_visitor_c::visit(symbol);
+      }
+      /* the nested parenthesised instruction lists declare their own IL implicit variable */
+      if (symbol != root) return NULL;
+      add_datatype(symbol->datatype);
+      return iterator_visitor_c::visit(symbol);
+    }
+};
+
+
 /***********************************************************************/
 /***********************************************************************/
 /***********************************************************************/
@@ -147,9 +231,7 @@ class generate_c_il_c: public generate_c_base_and_typeid_c, il_default_variable_
      */
     symbol_c *jump_label;
 
-    /* the data type of the IL implicit variable... */
-    #define IL_DEFVAR_T VAR_LEADER "IL_DEFVAR_T"
-    /* The name of the IL implicit variable... */
+    /* The name of the IL implicit variable (the data type name is appended to it)... */
     #define IL_DEFVAR   VAR_LEADER "IL_DEFVAR"
     /* The name of the variable used to pass the result of a
      * parenthesised instruction list to the immediately preceding
@@ -226,25 +308,32 @@ class generate_c_il_c: public generate_c_base_and_typeid_c, il_default_variable_
     }
 
   private:
-    /* Declare an implicit IL variable... */
-    void declare_implicit_variable(il_default_variable_c *implicit_var) {
-      s4o.print(s4o.indent_spaces);
-      s4o.print(IL_DEFVAR_T);
-      s4o.print(" ");
+    /* Declare an implicit IL variable, i.e. one C variable for each data type it will store... */
+    void declare_implicit_variable(il_default_variable_c *implicit_var, symbol_c *il_list, bool back_variable) {
+      il_implicit_variable_types_c implicit_variable_types(il_list, back_variable);
+      
+      for (int i = 0; i < implicit_variable_types.size(); i++) {
+        symbol_c *datatype_id = get_datatype_info_c::get_id(implicit_variable_types.get_datatype(i));
+        s4o.print(s4o.indent_spaces);
+        if (NULL != datatype_id) datatype_id->accept(*this);
+        else                     implicit_variable_types.get_datatype(i)->accept(*this);
+        s4o.print(" ");
+        implicit_var->datatype = implicit_variable_types.get_datatype(i);
+        implicit_var->accept(*this);
+        s4o.print(";\n");
+      }
       implicit_var->datatype = NULL;
-      implicit_var->accept(*this);
-      s4o.print(";\n");
     }
     
   public:  
     /* Declare the default variable, that will store the result of the IL operations */
-    void declare_implicit_variable(void) {
-      declare_implicit_variable(&this->implicit_variable_result);
+    void declare_implicit_variable(symbol_c *il_list) {
+      declare_implicit_variable(&this->implicit_variable_result, il_list, false);
     }
     
     /* Declare the backup to the default variable, that will store the result of the IL operations executed inside a parenthesis... */
-    void declare_implicit_variable_back(void) {
-      declare_implicit_variable(&this->implicit_variable_result_back);
+    void declare_implicit_variable_back(symbol_c *il_list) {
+      declare_implicit_variable(&this->implicit_variable_result_back, il_list, true);
     }
     
     void print_implicit_variable_back(void) {
@@ -320,15 +409,29 @@ class generate_c_il_c: public generate_c_base_and_typeid_c, il_default_variable_
     }
 
     /* A helper function... */
-    void *CMP_operator(symbol_c *operand, const char *operation) {
+    /* As in generate_c_st_c, only TIME, DATE and STRING values are compared by calling the
+     * (extensible) comparison functions of the standard library. All other values are compared
+     * with the C operator (c_operation), so the C compiler may inline the comparison.
+     */
+    void *CMP_operator(symbol_c *operand, const char *operation, const char *c_operation) {
       if (NULL == operand) ERROR;
       if (NULL == operand->datatype) ERROR;
       if (NULL == this->implicit_variable_current.datatype) ERROR;
 
       this->implicit_variable_result.accept(*this);
       s4o.print(" = ");
-      // print_compare_function is in generate_c_base_c, which is inherited by generate_c_il_c
-      print_compare_function(operation, operand->datatype, &(this->implicit_variable_current), operand);
+      if (get_datatype_info_c::is_TIME_compatible      (operand->datatype) ||
+          get_datatype_info_c::is_ANY_DATE_compatible  (operand->datatype) ||
+          get_datatype_info_c::is_ANY_STRING_compatible(operand->datatype)) {
+        // print_compare_function is in generate_c_base_c, which is inherited by generate_c_il_c
+        print_compare_function(operation, operand->datatype, &(this->implicit_variable_current), operand);
+        return NULL;
+      }
+      s4o.print("(");
+      this->implicit_variable_current.accept(*this);
+      s4o.print(c_operation);
+      operand->accept(*this);
+      s4o.print(")");
       return NULL;
     }
 
@@ -475,9 +578,10 @@ public:
 void *visit(il_default_variable_c *symbol) {
   symbol->var_name->accept(*this);
   if (NULL != symbol->datatype) {
-    s4o.print(".");
-    symbol->datatype->accept(*this);
-    s4o.print("var");
+    const char *suffix = il_implicit_variable_types_c::variable_suffix(symbol->datatype);
+    s4o.print("_");
+    if (NULL != suffix) s4o.print(suffix);
+    else                symbol->datatype->accept(*this);
   } return NULL;
 }
 
@@ -521,6 +625,9 @@ void *visit(symbolic_variable_c *symbol) {
     case complextype_suffix_vg:
       break;
     default:
+      /* the value of the variable may be known at compile time (stage3 constant propagation) */
+      if ((wanted_variablegeneration == expression_vg) && print_propagated_value(symbol))
+        break;
       if (this->is_variable_prefix_null()) {
         vartype = search_var_instance_decl->get_vartype(symbol);
         if (wanted_variablegeneration == fparam_output_vg) {
@@ -584,6 +691,8 @@ void *visit(structured_variable_c *symbol) {
   switch (wanted_variablegeneration) {
     case complextype_base_vg:
     case complextype_base_assignment_vg:
+      if (print_step_timer(symbol))
+        break;
       symbol->record_variable->accept(*this);
       if (!type_is_complex) {
         s4o.print(".");
@@ -657,14 +766,10 @@ void *visit(array_variable_c *symbol) {
 void *visit(subscript_list_c *symbol) {
   array_dimension_iterator_c* array_dimension_iterator = new array_dimension_iterator_c(current_array_type);
   for (int i =  0; i < symbol->n; i++) {
-    symbol_c* dimension = array_dimension_iterator->next();
+    subrange_c* dimension = array_dimension_iterator->next();
     if (dimension == NULL) ERROR;
 
-    s4o.print("[(");
-    symbol->get_element(i)->accept(*this);
-    s4o.print(") - (");
-    dimension->accept(*this);
-    s4o.print(")]");
+    print_array_subscript(symbol, i, dimension);
   }
   delete array_dimension_iterator;
   return NULL;
@@ -705,10 +810,10 @@ void *visit(array_initial_elements_list_c *symbol) {
 void *visit(instruction_list_c *symbol) {
   
   /* Declare the IL implicit variable, that will store the result of the IL operations... */
-  declare_implicit_variable();
+  declare_implicit_variable(symbol);
 
   /* Declare the backup to the IL implicit variable, that will store the result of the IL operations executed inside a parenthesis... */
-  declare_implicit_variable_back();
+  declare_implicit_variable_back(symbol);
   
   for(int i = 0; i < symbol->n; i++) {
     print_line_directive(symbol->get_element(i));
@@ -1420,20 +1525,20 @@ void *visit(simple_instr_list_c *symbol) {
    * value to the outside scope...
    *
    * The above example will result in the following C++ code:
-   * {__IL_DEFVAR_T __IL_DEFVAR_BACK;
-   *  __IL_DEFVAR_T __IL_DEFVAR;
+   * {INT __IL_DEFVAR_INT;
+   *  INT __IL_DEFVAR_BACK_INT;
    *
-   *  __IL_DEFVAR.INTvar = var1;
+   *  __IL_DEFVAR_INT = var1;
    *  {
-   *    __IL_DEFVAR_T __IL_DEFVAR;
+   *    INT __IL_DEFVAR_INT;
    *
-   *    __IL_DEFVAR.INTvar = var2;
-   *    __IL_DEFVAR.INTvar |= var3;
-   *    __IL_DEFVAR.INTvar |= var4;
+   *    __IL_DEFVAR_INT = var2;
+   *    __IL_DEFVAR_INT |= var3;
+   *    __IL_DEFVAR_INT |= var4;
    *
-   *    __IL_DEFVAR_BACK = __IL_DEFVAR;
+   *    __IL_DEFVAR_BACK_INT = __IL_DEFVAR_INT;
    *  }
-   *  __IL_DEFVAR.INTvar &= __IL_DEFVAR_BACK.INTvar;
+   *  __IL_DEFVAR_INT &= __IL_DEFVAR_BACK_INT;
    *
    * }
    *
@@ -1447,7 +1552,7 @@ void *visit(simple_instr_list_c *symbol) {
   /* Declare the IL implicit variable, that will store the result of the IL operations... */
   s4o.print("{\n");
   s4o.indent_right();
-  declare_implicit_variable();
+  declare_implicit_variable(symbol);
     
   print_list(symbol, s4o.indent_spaces, ";\n" + s4o.indent_spaces, ";\n");
 
@@ -1706,12 +1811,12 @@ void *visit(DIV_operator_c *symbol) {
 
 void *visit(MOD_operator_c *symbol)	{XXX_operator(&(this->implicit_variable_result), " %= ", this->current_operand); return NULL;}
 
-void *visit(GT_operator_c *symbol)	{CMP_operator(this->current_operand, "GT"); return NULL;}
-void *visit(GE_operator_c *symbol)	{CMP_operator(this->current_operand, "GE"); return NULL;}
-void *visit(EQ_operator_c *symbol)	{CMP_operator(this->current_operand, "EQ"); return NULL;}
-void *visit(LT_operator_c *symbol)	{CMP_operator(this->current_operand, "LT"); return NULL;}
-void *visit(LE_operator_c *symbol)	{CMP_operator(this->current_operand, "LE"); return NULL;}
-void *visit(NE_operator_c *symbol)	{CMP_operator(this->current_operand, "NE"); return NULL;}
+void *visit(GT_operator_c *symbol)	{CMP_operator(this->current_operand, "GT", " > "); return NULL;}
+void *visit(GE_operator_c *symbol)	{CMP_operator(this->current_operand, "GE", " >= "); return NULL;}
+void *visit(EQ_operator_c *symbol)	{CMP_operator(this->current_operand, "EQ", " == "); return NULL;}
+void *visit(LT_operator_c *symbol)	{CMP_operator(this->current_operand, "LT", " < "); return NULL;}
+void *visit(LE_operator_c *symbol)	{CMP_operator(this->current_operand, "LE", " <= "); return NULL;}
+void *visit(NE_operator_c *symbol)	{CMP_operator(this->current_operand, "NE", " != "); return NULL;}
 
 
 //SYM_REF0(CAL_operator_c)
@@ -347,6 +347,8 @@ class generate_c_inlinefcall_c: public generate_c_base_and_typeid_c {
       if (generating_inlinefunction) {
         switch (wanted_variablegeneration) {
           case complextype_base_vg:
+            if (print_step_timer(symbol))
+              break;
             symbol->record_variable->accept(*this);
             if (!type_is_complex) {
                 s4o.print(".");
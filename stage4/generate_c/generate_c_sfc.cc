@@ -59,6 +59,9 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
     symbol_c *current_step;
     symbol_c *current_action;
 
+    /* the timers used by the chart, when generating the compact SFC state (NULL otherwise) */
+    generate_c_sfc_usage_c *sfc_usage;
+
     sfcgeneration_t wanted_sfcgeneration;
     
   public:
@@ -69,6 +72,7 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
       generate_c_code = new generate_c_SFC_IL_ST_c(s4o_ptr, name, scope, variable_prefix);
       search_var_instance_decl = new search_var_instance_decl_c(scope);
       this->set_variable_prefix(variable_prefix);
+      sfc_usage = NULL;
     }
     
     ~generate_c_sfc_elements_c(void) {
@@ -89,6 +93,8 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
 
     void reset_transition_number(void) {transition_number = 0;}
 
+    void set_sfc_usage(generate_c_sfc_usage_c *sfc_usage) {this->sfc_usage = sfc_usage;}
+
     void generate(symbol_c *symbol, sfcgeneration_t generation_type) {
       wanted_sfcgeneration = generation_type;
       switch (wanted_sfcgeneration) {
@@ -142,19 +148,200 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
       s4o.print(SET_VAR);
       s4o.print("(");
       print_step_argument(step_name, "X", true);
-      s4o.print(",,1);\n" + s4o.indent_spaces);
-      print_step_argument(step_name, "T.value");
-      s4o.print(" = __time_to_timespec(1, 0, 0, 0, 0, 0);\n");
+      s4o.print(",,1);\n");
+      if ((sfc_usage == NULL) || sfc_usage->is_timed_step(step_name)) {
+        s4o.print(s4o.indent_spaces);
+        print_step_time(step_name);
+        s4o.print(" = __time_to_timespec(1, 0, 0, 0, 0, 0);\n");
+      }
+    }
+    
+    /* with the sparse SFC engine, an action must be added to the list of active actions
+     * before its state, or its set/reset requests, are changed */
+    void print_list_action(symbol_c *action_name) {
+      if (!generate_sparse_sfc__) return;
+      s4o.print("__SFC_LIST_ACTION(");
+      print_variable_prefix();
+      s4o.print(", ");
+      s4o.print(SFC_STEP_ACTION_PREFIX);
+      action_name->accept(*this);
+      s4o.print(") ");
+    }
+
+    /* The step that must be active for the transition to be tested by the sparse SFC engine, i.e. 
+     * the first step the transition comes from.
+     */
+    symbol_c *transition_owner_step(transition_c *transition) {
+      steps_c *from_steps = (steps_c *)transition->from_steps;
+      if (from_steps->step_name != NULL)
+        return from_steps->step_name;
+      return ((list_c *)from_steps->step_name_list)->get_element(0);
+    }
+
+    int get_transition_count(void) {return transition_list.size();}
+
+    /* The number of each step of the chart (in declaration order, i.e. their index in __step_list), by name. */
+    void get_step_numbers(sequential_function_chart_c *symbol, std::map<std::string, int> &step_numbers) {
+      for(int i = 0; i < symbol->n; i++) {
+        sfc_network_c *sfc_network = (sfc_network_c *)symbol->get_element(i);
+        for(int j = 0; j < sfc_network->n; j++) {
+          symbol_c *step_name = NULL;
+          if (NULL != dynamic_cast<initial_step_c *>(sfc_network->get_element(j)))
+            step_name = ((initial_step_c *)sfc_network->get_element(j))->step_name;
+          if (NULL != dynamic_cast<step_c *>(sfc_network->get_element(j)))
+            step_name = ((step_c *)sfc_network->get_element(j))->step_name;
+          if (NULL != step_name)
+            step_numbers.insert(std::make_pair(get_step_key(step_name), (int)step_numbers.size()));
+        }
+      }
+    }
+
+    /* The index in __step_timer_list of the timer of each step (in declaration order), or the number of timers if the step is not timed. */
+    void get_step_timers(sequential_function_chart_c *symbol, std::vector<int> &step_timers) {
+      for(int i = 0; i < symbol->n; i++) {
+        sfc_network_c *sfc_network = (sfc_network_c *)symbol->get_element(i);
+        for(int j = 0; j < sfc_network->n; j++) {
+          symbol_c *step_name = NULL;
+          if (NULL != dynamic_cast<initial_step_c *>(sfc_network->get_element(j)))
+            step_name = ((initial_step_c *)sfc_network->get_element(j))->step_name;
+          if (NULL != dynamic_cast<step_c *>(sfc_network->get_element(j)))
+            step_name = ((step_c *)sfc_network->get_element(j))->step_name;
+          if (NULL == step_name)
+            continue;
+          int step_timer = sfc_usage->get_step_timer(step_name);
+          step_timers.push_back((step_timer < 0) ? (int)sfc_usage->get_step_timer_count() : step_timer);
+        }
+      }
+    }
+
+    /* step names are case insensitive */
+    static std::string get_step_key(symbol_c *step_name) {
+      std::string key = ((token_c *)step_name)->value;
+      for (unsigned int i = 0; i < key.size(); i++)
+        key[i] = toupper(key[i]);
+      return key;
+    }
+
+    /* add the numbers of the steps in steps (a steps_c) to step_list */
+    void get_steps(symbol_c *steps, std::map<std::string, int> &step_numbers, std::vector<int> &step_list) {
+      steps_c *steps_ = (steps_c *)steps;
+      if (steps_->step_name != NULL) {
+        step_list.push_back(step_numbers[get_step_key(steps_->step_name)]);
+        return;
+      }
+      list_c *step_name_list = (list_c *)steps_->step_name_list;
+      for(int i = 0; i < step_name_list->n; i++)
+        step_list.push_back(step_numbers[get_step_key(step_name_list->get_element(i))]);
+    }
+
+    void print_sparse_table(const char *name, std::vector<int> &values) {
+      s4o.print(s4o.indent_spaces + "static const UINT " + name + "[] = {");
+      if (values.empty())
+        s4o.print("0");
+      for (unsigned int i = 0; i < values.size(); i++) {
+        if (i > 0) s4o.print(",");
+        if ((i > 0) && (i % 16 == 0)) s4o.print("\n" + s4o.indent_spaces + "  ");
+        s4o.print(values[i]);
+      }
+      s4o.print("};\n");
+    }
+
+    /* Generate the constant tables used by the sparse SFC engine. The transitions are identified by their
+     * position in transition_list (i.e. the order in which they must be tested).
+     *   step_transitions[step_transitions_first[s] .. step_transitions_first[s+1]-1]: the transitions leaving step s
+     *     (i.e. whose first from step is s, see transition_owner_step())
+     *   transition_index[t]: the index of transition t in __transition_list
+     *   transition_from[transition_from_first[t] .. transition_from_first[t+1]-1]: the steps transition t comes from
+     *   transition_to[transition_to_first[t] .. transition_to_first[t+1]-1]: the steps transition t goes to
+     *   step_timer[s]: the index of the timer of step s in __step_timer_list (only with the compact SFC state)
+     */
+    void generate_sparse_tables(sequential_function_chart_c *symbol) {
+      std::map<std::string, int> step_numbers;
+      get_step_numbers(symbol, step_numbers);
+
+      std::vector<std::vector<int> > owned_transitions(step_numbers.size());
+      std::vector<int> transition_index, transition_from_first, transition_from, transition_to_first, transition_to;
+      std::list<TRANSITION>::iterator pt;
+      int position;
+      for(pt = transition_list.begin(), position = 0; pt != transition_list.end(); pt++, position++) {
+        owned_transitions[step_numbers[get_step_key(transition_owner_step(pt->symbol))]].push_back(position);
+        transition_index.push_back(pt->index);
+        transition_from_first.push_back(transition_from.size());
+        get_steps(pt->symbol->from_steps, step_numbers, transition_from);
+        transition_to_first.push_back(transition_to.size());
+        get_steps(pt->symbol->to_steps, step_numbers, transition_to);
+      }
+      transition_from_first.push_back(transition_from.size());
+      transition_to_first.push_back(transition_to.size());
+
+      std::vector<int> step_transitions_first, step_transitions;
+      for (unsigned int i = 0; i < owned_transitions.size(); i++) {
+        step_transitions_first.push_back(step_transitions.size());
+        step_transitions.insert(step_transitions.end(), owned_transitions[i].begin(), owned_transitions[i].end());
+      }
+      step_transitions_first.push_back(step_transitions.size());
+
+      /* compact SFC state: the index in __step_timer_list of the timer of each step (the number of timers if untimed) */
+      std::vector<int> step_timers;
+      get_step_timers(symbol, step_timers);
+
+      print_sparse_table("step_transitions_first", step_transitions_first);
+      print_sparse_table("step_transitions", step_transitions);
+      print_sparse_table("transition_index", transition_index);
+      print_sparse_table("transition_from_first", transition_from_first);
+      print_sparse_table("transition_from", transition_from);
+      print_sparse_table("transition_to_first", transition_to_first);
+      print_sparse_table("transition_to", transition_to);
+      if (generate_compact_sfc__ && sfc_usage->uses_step_time())
+        print_sparse_table("step_timer", step_timers);
+    }
+
+    /* Generate the body of a switch on the candidate transitions, with the transitiontest_sg code of 
+     * each transition (the steps are reset and set using the tables, see generate_sparse_tables()).
+     */
+    void generate_sparse_transition_tests(void) {
+      std::list<TRANSITION>::iterator pt;
+      int position;
+      for(pt = transition_list.begin(), position = 0; pt != transition_list.end(); pt++, position++) {
+        s4o.print(s4o.indent_spaces + "case ");
+        s4o.print(position);
+        s4o.print(": {\n");
+        s4o.indent_right();
+        wanted_sfcgeneration = transitiontest_sg;
+        transition_number = pt->index;
+        pt->symbol->accept(*this);
+        s4o.print(s4o.indent_spaces + "break;\n");
+        s4o.indent_left();
+        s4o.print(s4o.indent_spaces + "}\n");
+      }
     }
     
 /*********************************************/
 /* B.1.6  Sequential function chart elements */
 /*********************************************/
     
+    void print_step_association_begin(symbol_c *step_name) {
+      if (generate_sparse_sfc__) {
+        s4o.print(s4o.indent_spaces + "case ");
+        s4o.print(SFC_STEP_ACTION_PREFIX);
+        step_name->accept(*this);
+        s4o.print(":\n");
+        s4o.indent_right();
+      }
+    }
+
+    void print_step_association_end(void) {
+      if (generate_sparse_sfc__) {
+        s4o.print(s4o.indent_spaces + "break;\n");
+        s4o.indent_left();
+      }
+    }
+
     void *visit(initial_step_c *symbol) {
       switch (wanted_sfcgeneration) {
         case actionassociation_sg:
           if (((list_c*)symbol->action_association_list)->n > 0) {
+            print_step_association_begin(symbol->step_name);
             s4o.print(s4o.indent_spaces + "// ");
             symbol->step_name->accept(*this);
             s4o.print(" action associations\n");
@@ -174,7 +361,9 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
             s4o.print(";\n\n");
             symbol->action_association_list->accept(*this);
             s4o.indent_left();
-            s4o.print(s4o.indent_spaces + "}\n\n");
+            s4o.print(s4o.indent_spaces + "}\n");
+            print_step_association_end();
+            s4o.print("\n");
           }
           break;
         default:
@@ -187,6 +376,7 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
       switch (wanted_sfcgeneration) {
         case actionassociation_sg:
           if (((list_c*)symbol->action_association_list)->n > 0) {
+            print_step_association_begin(symbol->step_name);
             s4o.print(s4o.indent_spaces + "// ");
             symbol->step_name->accept(*this);
             s4o.print(" action associations\n");
@@ -206,7 +396,9 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
             s4o.print(";\n\n");
             symbol->action_association_list->accept(*this);
             s4o.indent_left();
-            s4o.print(s4o.indent_spaces + "}\n\n");
+            s4o.print(s4o.indent_spaces + "}\n");
+            print_step_association_end();
+            s4o.print("\n");
           }
           break;
         default:
@@ -267,13 +459,15 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
           s4o.print(s4o.indent_spaces + "else {\n");
           s4o.indent_right();
           // Calculate transition value for debug
-          s4o.print(s4o.indent_spaces + "if (__DEBUG) {\n");
-          s4o.indent_right();
-          wanted_sfcgeneration = transitiontestdebug_sg;
-          symbol->transition_condition->accept(*this);
-          wanted_sfcgeneration = transitiontest_sg;
-          s4o.indent_left();
-          s4o.print(s4o.indent_spaces + "}\n");
+          if (!disable_debug_code__) {
+            s4o.print(s4o.indent_spaces + "if (__DEBUG) {\n");
+            s4o.indent_right();
+            wanted_sfcgeneration = transitiontestdebug_sg;
+            symbol->transition_condition->accept(*this);
+            wanted_sfcgeneration = transitiontest_sg;
+            s4o.indent_left();
+            s4o.print(s4o.indent_spaces + "}\n");
+          }
           s4o.print(s4o.indent_spaces);
           s4o.print(SET_VAR);
           s4o.print("(");
@@ -326,7 +520,7 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
         case transitiontestdebug_sg:
           // Transition condition is in IL
           if (symbol->transition_condition_il != NULL) {
-            generate_c_il->declare_implicit_variable_back();
+            generate_c_il->declare_implicit_variable_back(symbol->transition_condition_il);
             s4o.print(s4o.indent_spaces);
             symbol->transition_condition_il->accept(*generate_c_il);
             s4o.print(SET_VAR);
@@ -361,7 +555,7 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
             symbol->transition_condition_st->accept(*generate_c_st);
             s4o.print(");\n");
           }
-          if (wanted_sfcgeneration == transitiontest_sg) {
+          if ((wanted_sfcgeneration == transitiontest_sg) && !disable_debug_code__) {
             s4o.print(s4o.indent_spaces + "if (__DEBUG) {\n");
             s4o.indent_right();
             s4o.print(s4o.indent_spaces);
@@ -492,6 +686,7 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
             s4o.print(")) {\n");
             s4o.indent_right();
             s4o.print(s4o.indent_spaces);
+            print_list_action(symbol->action_name);
             s4o.print(SET_VAR);
             s4o.print("(");
             print_action_argument(symbol->action_name, "state", true);
@@ -527,6 +722,7 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
 
     void print_set_action_state(symbol_c *action, const char *value) {  
       s4o.print("{"); // it is safer to embed these macros nside a {..} block
+      print_list_action(action);
       s4o.print(SET_VAR);
       s4o.print("(");
       print_action_argument(action, "state", true);
@@ -560,6 +756,7 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
             /* S qualifier */
             if (strcmp(qualifier, "S") == 0) {
               s4o.print(s4o.indent_spaces + "if (active)       {");
+              print_list_action(current_action);
               print_action_argument(current_action, "set");
               s4o.print(" = 1;}\n");
               return NULL;
@@ -567,6 +764,7 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
             /* R qualifier */
             if (strcmp(qualifier, "R") == 0) {
               s4o.print(s4o.indent_spaces + "if (active)       {");
+              print_list_action(current_action);
               print_action_argument(current_action, "reset");
               s4o.print(" = 1;}\n");
               return NULL;
@@ -575,7 +773,7 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
             if ((strcmp(qualifier, "L") == 0) || 
                 (strcmp(qualifier, "D") == 0)) {
               s4o.print(s4o.indent_spaces + "if (active && __time_cmp(");
-              print_step_argument(current_step, "T.value");
+              print_step_time(current_step);
               s4o.print(", ");
               symbol->action_time->accept(*generate_c_st);
               if (strcmp(qualifier, "L") == 0)
@@ -614,6 +812,7 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
               s4o.print(s4o.indent_spaces + "if (activated) {");
               s4o.indent_right();
               s4o.print("\n" + s4o.indent_spaces);
+              print_list_action(current_action);
               print_action_argument(current_action, "set");
               s4o.print(" = 1;\n" + s4o.indent_spaces);
               print_action_argument(current_action, "reset_remaining_time");
@@ -630,6 +829,7 @@ class generate_c_sfc_elements_c: public generate_c_base_and_typeid_c {
               s4o.print(s4o.indent_spaces + "if (activated) {");
               s4o.indent_right();
               s4o.print("\n" + s4o.indent_spaces);
+              print_list_action(current_action);
               print_action_argument(current_action, "set_remaining_time");
               s4o.print(" = ");
               symbol->action_time->accept(*generate_c_st);
@@ -680,12 +880,20 @@ class generate_c_sfc_c: public generate_c_base_and_typeid_c {
     generate_c_sfc_elements_c *generate_c_sfc_elements;
     search_var_instance_decl_c *search_var_instance_decl;
     
+    /* the timers and action flags used by the chart (see generate_c_sfcdecl.cc) */
+    generate_c_sfc_usage_c *sfc_usage;
+    bool step_time;
+    bool action_time;
+    bool action_store;
+    
   public:
     generate_c_sfc_c(stage4out_c *s4o_ptr, symbol_c *name, symbol_c *scope, const char *variable_prefix = NULL)
     : generate_c_base_and_typeid_c(s4o_ptr) {
       generate_c_sfc_elements = new generate_c_sfc_elements_c(s4o_ptr, name, scope, variable_prefix);
       search_var_instance_decl = new search_var_instance_decl_c(scope);
       this->set_variable_prefix(variable_prefix);
+      sfc_usage = NULL;
+      step_time = action_time = action_store = true;
     }
   
     virtual ~generate_c_sfc_c(void) {
@@ -701,216 +909,522 @@ class generate_c_sfc_c: public generate_c_base_and_typeid_c {
       return var_decl != NULL;
     }
 
-/*********************************************/
-/* B.1.6  Sequential function chart elements */
-/*********************************************/
-    
-    void *visit(sequential_function_chart_c *symbol) {
-      int i;
-      
-      generate_c_sfc_elements->reset_transition_number();
-      for(i = 0; i < symbol->n; i++) {
-        symbol->get_element(i)->accept(*this);
-        generate_c_sfc_elements->generate(symbol->get_element(i), generate_c_sfc_elements_c::transitionlist_sg);
-      }
-      
-      s4o.print(s4o.indent_spaces +"INT i;\n");
-      s4o.print(s4o.indent_spaces +"TIME elapsed_time, current_time;\n\n");
-      
-      /* generate elapsed_time initializations */
-      s4o.print(s4o.indent_spaces + "// Calculate elapsed_time\n");
-      s4o.print(s4o.indent_spaces +"current_time = __CURRENT_TIME;\n");
-      s4o.print(s4o.indent_spaces +"elapsed_time = __time_sub(current_time, ");
-      print_variable_prefix();
-      s4o.print("__lasttick_time);\n");
-      s4o.print(s4o.indent_spaces);
-      print_variable_prefix();
-      s4o.print("__lasttick_time = current_time;\n");
-      
-      /* generate transition initializations */
-      s4o.print(s4o.indent_spaces + "// Transitions initialization\n");
-      s4o.print(s4o.indent_spaces + "if (__DEBUG) {\n");
-      s4o.indent_right();
+    /* Steps initialization when few of the steps use their T: only the steps that use it have it updated.
+     * When most of them do, a single loop updating the T of every active step is smaller and faster.
+     */
+    void generate_selective_steps_initialization(sequential_function_chart_c *symbol) {
       s4o.print(s4o.indent_spaces + "for (i = 0; i < ");
       print_variable_prefix();
-      s4o.print("__nb_transitions; i++) {\n");
+      s4o.print("__nb_steps; i++) {\n");
       s4o.indent_right();
       s4o.print(s4o.indent_spaces);
       print_variable_prefix();
-      s4o.print("__transition_list[i] = ");
+      s4o.print("__step_list[i].prev_state = ");
+      s4o.print(GET_VAR);
+      s4o.print("(");
       print_variable_prefix();
-      s4o.print("__debug_transition_list[i];\n");
-      s4o.indent_left();
-      s4o.print(s4o.indent_spaces + "}\n");
+      s4o.print("__step_list[i].X);\n");
       s4o.indent_left();
       s4o.print(s4o.indent_spaces + "}\n");
+      /* the chart is a list of sfc_network_c, each one a list of steps, transitions and actions */
+      for(int i = 0; i < symbol->n; i++) {
+        list_c *sfc_network = (list_c *)symbol->get_element(i);
+        for(int j = 0; j < sfc_network->n; j++) {
+          symbol_c *step_name = NULL;
+          initial_step_c *initial_step = dynamic_cast<initial_step_c *>(sfc_network->get_element(j));
+          step_c         *step         = dynamic_cast<step_c         *>(sfc_network->get_element(j));
+          if (initial_step != NULL) step_name = initial_step->step_name;
+          if (step         != NULL) step_name = step->step_name;
+          if ((step_name == NULL) || !sfc_usage->is_timed_step(step_name))
+            continue;
+          s4o.print(s4o.indent_spaces + "if (");
+          s4o.print(GET_VAR);
+          s4o.print("(");
+          print_variable_prefix();
+          step_name->accept(*this);
+          s4o.print(".X)) ");
+          print_step_time(step_name);
+          s4o.print(" = __time_add(");
+          print_step_time(step_name);
+          s4o.print(", elapsed_time);\n");
+        }
+      }
+    }
 
-      /* generate step initializations */
-      s4o.print(s4o.indent_spaces + "// Steps initialization\n");
-      s4o.print(s4o.indent_spaces + "for (i = 0; i < ");
+    /* decrement the remaining time before the set (or reset) of an action is requested */
+    void print_action_timer_update(std::string action_index, std::string request) {
+      std::string timer = "__action_list[" + action_index + "]." + request + "_remaining_time";
+      s4o.print(s4o.indent_spaces + "if (");
+      s4o.print("__time_cmp(");
       print_variable_prefix();
-      s4o.print("__nb_steps; i++) {\n");
+      s4o.print(timer + ", __time_to_timespec(1, 0, 0, 0, 0, 0)) > 0) {\n");
       s4o.indent_right();
       s4o.print(s4o.indent_spaces);
       print_variable_prefix();
-      s4o.print("__step_list[i].prev_state = ");
-      s4o.print(GET_VAR);
-      s4o.print("(");
+      s4o.print(timer + " = __time_sub(");
       print_variable_prefix();
-      s4o.print("__step_list[i].X);\n");
+      s4o.print(timer + ", elapsed_time);\n");
       s4o.print(s4o.indent_spaces + "if (");
-      s4o.print(GET_VAR);
-      s4o.print("(");
+      s4o.print("__time_cmp(");
       print_variable_prefix();
-      s4o.print("__step_list[i].X)) {\n");
+      s4o.print(timer + ", __time_to_timespec(1, 0, 0, 0, 0, 0)) <= 0) {\n");
       s4o.indent_right();
       s4o.print(s4o.indent_spaces);
       print_variable_prefix();
-      s4o.print("__step_list[i].T.value = __time_add(");
+      s4o.print(timer + " = __time_to_timespec(1, 0, 0, 0, 0, 0);\n");
+      s4o.print(s4o.indent_spaces);
       print_variable_prefix();
-      s4o.print("__step_list[i].T.value, elapsed_time);\n");
+      s4o.print("__action_list[" + action_index + "]." + request + " = 1;\n");
       s4o.indent_left();
       s4o.print(s4o.indent_spaces + "}\n");
       s4o.indent_left();
       s4o.print(s4o.indent_spaces + "}\n");
+    }
 
-      /* generate action initializations */
-      s4o.print(s4o.indent_spaces + "// Actions initialization\n");
+    /*********************************************************/
+    /* Helpers for the sparse SFC engine (iec2c -O s option) */
+    /*********************************************************/
+    /* Instead of looping over all the steps, actions and transitions, the sparse SFC engine
+     * keeps a list of the steps that are active (or have been deactivated during the current
+     * scan), and a list of the actions that are active (or stored, or have a pending set/reset).
+     * Only the transitions leaving the active steps, and the action associations of those steps,
+     * are evaluated. The steps and actions are added to the lists by the __SFC_LIST_STEP() and
+     * __SFC_LIST_ACTION() macros (see accessor.h) when set, and removed from them at the 
+     * start of the next scan (steps) or at the end of the current scan (actions) once idle.
+     */
+    void print_active_steps_switch_begin(void) {
       s4o.print(s4o.indent_spaces + "for (i = 0; i < ");
       print_variable_prefix();
-      s4o.print("__nb_actions; i++) {\n");
+      s4o.print("__nb_active_steps; i++) {\n");
       s4o.indent_right();
-      s4o.print(s4o.indent_spaces);
-      s4o.print(SET_VAR);
+      s4o.print(s4o.indent_spaces + "switch (");
+      print_variable_prefix();
+      s4o.print("__active_step_list[i]) {\n");
+      s4o.indent_right();
+    }
+
+    void print_active_steps_switch_end(void) {
+      s4o.indent_left();
+      s4o.print(s4o.indent_spaces + "}\n");
+      s4o.indent_left();
+      s4o.print(s4o.indent_spaces + "}\n");
+    }
+
+    void print_actions_loop_begin(void) {
+      s4o.print(s4o.indent_spaces + "for (i = 0; i < ");
+      print_variable_prefix();
+      if (!generate_sparse_sfc__) {
+        s4o.print("__nb_actions; i++) {\n");
+        s4o.indent_right();
+        return;
+      }
+      s4o.print("__nb_active_actions; i++) {\n");
+      s4o.indent_right();
+      s4o.print(s4o.indent_spaces + "j = ");
+      print_variable_prefix();
+      s4o.print("__active_action_list[i];\n");
+    }
+
+    /* keep action j in the active actions list (compacted into its first k entries) while it is not idle */
+    void print_sparse_action_removal(void) {
+      s4o.print(s4o.indent_spaces + "if (");
+      s4o.print(GET_VAR);
       s4o.print("(");
       print_variable_prefix();
-      s4o.print(",__action_list[i].state,,0);\n");
+      s4o.print("__action_list[j].state) || ");
+      print_variable_prefix();
+      s4o.print("__action_list[j].stored || ");
+      print_variable_prefix();
+      s4o.print("__action_list[j].set || ");
+      print_variable_prefix();
+      s4o.print("__action_list[j].reset");
+      if (action_time) {
+        s4o.print(" ||\n" + s4o.indent_spaces + "    __time_cmp(");
+        print_variable_prefix();
+        s4o.print("__action_list[j].set_remaining_time, __time_to_timespec(1, 0, 0, 0, 0, 0)) > 0 ||\n" + s4o.indent_spaces + "    __time_cmp(");
+        print_variable_prefix();
+        s4o.print("__action_list[j].reset_remaining_time, __time_to_timespec(1, 0, 0, 0, 0, 0)) > 0");
+      }
+      s4o.print(")\n");
+      s4o.indent_right();
       s4o.print(s4o.indent_spaces);
       print_variable_prefix();
-      s4o.print("__action_list[i].set = 0;\n");
+      s4o.print("__active_action_list[k++] = j;\n");
+      s4o.indent_left();
+      s4o.print(s4o.indent_spaces + "else\n");
+      s4o.indent_right();
       s4o.print(s4o.indent_spaces);
       print_variable_prefix();
-      s4o.print("__action_list[i].reset = 0;\n");
-      s4o.print(s4o.indent_spaces + "if (");
-      s4o.print("__time_cmp(");
+      s4o.print("__action_listed[j] = 0;\n");
+      s4o.indent_left();
+    }
+
+    /* the value of the T of step k, in the loops of the sparse SFC engine */
+    void print_sparse_step_time(void) {
+      print_variable_prefix();
+      if (generate_compact_sfc__)
+        s4o.print("__step_timer_list[step_timer[k]].value");
+      else
+        s4o.print("__step_list[k].T.value");
+    }
+
+    /* with the compact SFC state, only the timed steps have a T */
+    void print_sparse_step_timer_test(void) {
+      if (!generate_compact_sfc__)
+        return;
+      s4o.print("if (step_timer[k] < ");
+      s4o.print(sfc_usage->get_step_timer_count());
+      s4o.print(") ");
+    }
+
+    /* update prev_state and T of the listed steps, and drop the steps deactivated in the previous scan */
+    void generate_sparse_steps_initialization(void) {
+      s4o.print(s4o.indent_spaces + "j = 0;\n");
+      s4o.print(s4o.indent_spaces + "for (i = 0; i < ");
       print_variable_prefix();
-      s4o.print("__action_list[i].set_remaining_time, __time_to_timespec(1, 0, 0, 0, 0, 0)) > 0) {\n");
+      s4o.print("__nb_active_steps; i++) {\n");
       s4o.indent_right();
+      s4o.print(s4o.indent_spaces + "k = ");
+      print_variable_prefix();
+      s4o.print("__active_step_list[i];\n");
       s4o.print(s4o.indent_spaces);
       print_variable_prefix();
-      s4o.print("__action_list[i].set_remaining_time = __time_sub(");
+      s4o.print("__step_list[k].prev_state = ");
+      s4o.print(GET_VAR);
+      s4o.print("(");
       print_variable_prefix();
-      s4o.print("__action_list[i].set_remaining_time, elapsed_time);\n");
+      s4o.print("__step_list[k].X);\n");
       s4o.print(s4o.indent_spaces + "if (");
-      s4o.print("__time_cmp(");
+      s4o.print(GET_VAR);
+      s4o.print("(");
       print_variable_prefix();
-      s4o.print("__action_list[i].set_remaining_time, __time_to_timespec(1, 0, 0, 0, 0, 0)) <= 0) {\n");
+      s4o.print("__step_list[k].X)) {\n");
       s4o.indent_right();
+      if (step_time) {
+        s4o.print(s4o.indent_spaces);
+        print_sparse_step_timer_test();
+        print_sparse_step_time();
+        s4o.print(" = __time_add(");
+        print_sparse_step_time();
+        s4o.print(", elapsed_time);\n");
+      }
       s4o.print(s4o.indent_spaces);
       print_variable_prefix();
-      s4o.print("__action_list[i].set_remaining_time = __time_to_timespec(1, 0, 0, 0, 0, 0);\n");
-      s4o.print(s4o.indent_spaces);
-      print_variable_prefix();
-      s4o.print("__action_list[i].set = 1;\n");
+      s4o.print("__active_step_list[j++] = k;\n");
       s4o.indent_left();
       s4o.print(s4o.indent_spaces + "}\n");
       s4o.indent_left();
       s4o.print(s4o.indent_spaces + "}\n");
-      s4o.print(s4o.indent_spaces + "if (");
-      s4o.print("__time_cmp(");
-      print_variable_prefix();
-      s4o.print("__action_list[i].reset_remaining_time, __time_to_timespec(1, 0, 0, 0, 0, 0)) > 0) {\n");
-      s4o.indent_right();
       s4o.print(s4o.indent_spaces);
       print_variable_prefix();
-      s4o.print("__action_list[i].reset_remaining_time = __time_sub(");
+      s4o.print("__nb_active_steps = j;\n");
+    }
+
+    /* collect the transitions leaving the active steps in candidate_list, sorted in test order */
+    void generate_sparse_candidates(void) {
+      s4o.print(s4o.indent_spaces + "nb_candidates = 0;\n");
+      s4o.print(s4o.indent_spaces + "for (i = 0; i < ");
       print_variable_prefix();
-      s4o.print("__action_list[i].reset_remaining_time, elapsed_time);\n");
-      s4o.print(s4o.indent_spaces + "if (");
-      s4o.print("__time_cmp(");
+      s4o.print("__nb_active_steps; i++) {\n");
+      s4o.indent_right();
+      s4o.print(s4o.indent_spaces + "k = ");
       print_variable_prefix();
-      s4o.print("__action_list[i].reset_remaining_time, __time_to_timespec(1, 0, 0, 0, 0, 0)) <= 0) {\n");
+      s4o.print("__active_step_list[i];\n");
+      s4o.print(s4o.indent_spaces + "for (j = step_transitions_first[k]; j < step_transitions_first[k + 1]; j++)\n");
+      s4o.print(s4o.indent_spaces + "  __SFC_SORTED_INSERT(candidate_list, nb_candidates, step_transitions[j])\n");
+      s4o.indent_left();
+      s4o.print(s4o.indent_spaces + "}\n");
+    }
+
+    /* In debug mode the __debug_transition_list entries of all the transitions must be refreshed, including
+     * those leaving inactive steps, so the transitions fire test then goes through every transition, in the
+     * same order as the full SFC engine. The test of a transition whose steps are not active only updates its
+     * debug value, and resets the transition, so the steps are still only reset/set by the candidate transitions.
+     */
+    void generate_sparse_transition_tests(void) {
+      if (!disable_debug_code__) {
+        s4o.print(s4o.indent_spaces + "for (i = 0; i < (__DEBUG ? ");
+        print_variable_prefix();
+        s4o.print("__nb_transitions : nb_candidates); i++) {\n");
+        s4o.indent_right();
+        s4o.print(s4o.indent_spaces + "switch (__DEBUG ? i : candidate_list[i]) {\n");
+      }
+      else {
+        s4o.print(s4o.indent_spaces + "for (i = 0; i < nb_candidates; i++) {\n");
+        s4o.indent_right();
+        s4o.print(s4o.indent_spaces + "switch (candidate_list[i]) {\n");
+      }
       s4o.indent_right();
-      s4o.print(s4o.indent_spaces);
+      generate_c_sfc_elements->generate_sparse_transition_tests();
+      s4o.indent_left();
+      s4o.print(s4o.indent_spaces + "}\n");
+      s4o.indent_left();
+      s4o.print(s4o.indent_spaces + "}\n");
+    }
+
+    /* reset (step_list == "transition_from") or set (step_list == "transition_to") the steps of the candidate transitions that fire.
+     * The from steps of the transitions with a priority have already been reset by their test, resetting them again does no harm.
+     */
+    void generate_sparse_transition_steps(const std::string &step_list) {
+      s4o.print(s4o.indent_spaces + "for (i = 0; i < nb_candidates; i++) {\n");
+      s4o.indent_right();
+      s4o.print(s4o.indent_spaces + "if (");
+      s4o.print(GET_VAR);
+      s4o.print("(");
       print_variable_prefix();
-      s4o.print("__action_list[i].reset_remaining_time = __time_to_timespec(1, 0, 0, 0, 0, 0);\n");
+      s4o.print("__transition_list[transition_index[candidate_list[i]]])) {\n");
+      s4o.indent_right();
+      s4o.print(s4o.indent_spaces + "for (j = " + step_list + "_first[candidate_list[i]]; j < " + step_list + "_first[candidate_list[i] + 1]; j++) {\n");
+      s4o.indent_right();
+      s4o.print(s4o.indent_spaces + "k = " + step_list + "[j];\n");
+      if (step_list == "transition_to") {
+        s4o.print(s4o.indent_spaces + "__SFC_LIST_STEP(");
+        print_variable_prefix();
+        s4o.print(", k)\n");
+      }
       s4o.print(s4o.indent_spaces);
+      s4o.print(SET_VAR);
+      s4o.print("(");
       print_variable_prefix();
-      s4o.print("__action_list[i].reset = 1;\n");
+      s4o.print(",__step_list[k].X,,");
+      s4o.print((step_list == "transition_to")? "1" : "0");
+      s4o.print(");\n");
+      if ((step_list == "transition_to") && step_time) {
+        s4o.print(s4o.indent_spaces);
+        print_sparse_step_timer_test();
+        print_sparse_step_time();
+        s4o.print(" = __time_to_timespec(1, 0, 0, 0, 0, 0);\n");
+      }
       s4o.indent_left();
       s4o.print(s4o.indent_spaces + "}\n");
       s4o.indent_left();
       s4o.print(s4o.indent_spaces + "}\n");
       s4o.indent_left();
+      s4o.print(s4o.indent_spaces + "}\n");
+    }
+
+/*********************************************/
+/* B.1.6  Sequential function chart elements */
+/*********************************************/
+    
+    void *visit(sequential_function_chart_c *symbol) {
+      int i;
+      /* only generate the timers and action flags bookkeeping the chart needs */
+      sfc_usage    = new generate_c_sfc_usage_c(symbol);
+      step_time    = sfc_usage->uses_step_time();
+      action_time  = sfc_usage->uses_action_time();
+      action_store = sfc_usage->uses_action_store();
+      generate_c_sfc_elements->set_sfc_usage(sfc_usage);
+      /* the sparse SFC engine only loops over the actions in __active_action_list (see print_actions_loop_begin()) */
+      std::string action_index = generate_sparse_sfc__ ? "j" : "i";
+      
+      generate_c_sfc_elements->reset_transition_number();
+      for(i = 0; i < symbol->n; i++) {
+        symbol->get_element(i)->accept(*this);
+        generate_c_sfc_elements->generate(symbol->get_element(i), generate_c_sfc_elements_c::transitionlist_sg);
+      }
+      
+      s4o.print(s4o.indent_spaces +"INT i;\n");
+      if (generate_sparse_sfc__) {
+        s4o.print(s4o.indent_spaces +"UINT j, k, nb_candidates;\n");
+        s4o.print(s4o.indent_spaces +"UINT candidate_list[");
+        s4o.print(generate_c_sfc_elements->get_transition_count() > 0 ? generate_c_sfc_elements->get_transition_count() : 1);
+        s4o.print("];\n");
+        generate_c_sfc_elements->generate_sparse_tables(symbol);
+      }
+      if (step_time || action_time) {
+        s4o.print(s4o.indent_spaces +"TIME elapsed_time, current_time;\n\n");
+      
+        /* generate elapsed_time initializations */
+        s4o.print(s4o.indent_spaces + "// Calculate elapsed_time\n");
+        s4o.print(s4o.indent_spaces +"current_time = __CURRENT_TIME;\n");
+        s4o.print(s4o.indent_spaces +"elapsed_time = __time_sub(current_time, ");
+        print_variable_prefix();
+        s4o.print("__lasttick_time);\n");
+        s4o.print(s4o.indent_spaces);
+        print_variable_prefix();
+        s4o.print("__lasttick_time = current_time;\n");
+      }
+      else
+        s4o.print("\n");
+      
+      /* generate transition initializations (the debugger may force the transitions, see __debug_transition_list) */
+      if (!disable_debug_code__) {
+        s4o.print(s4o.indent_spaces + "// Transitions initialization\n");
+        s4o.print(s4o.indent_spaces + "if (__DEBUG) {\n");
+        s4o.indent_right();
+        s4o.print(s4o.indent_spaces + "for (i = 0; i < ");
+        print_variable_prefix();
+        s4o.print("__nb_transitions; i++) {\n");
+        s4o.indent_right();
+        s4o.print(s4o.indent_spaces);
+        print_variable_prefix();
+        s4o.print("__transition_list[i] = ");
+        print_variable_prefix();
+        s4o.print("__debug_transition_list[i];\n");
+        s4o.indent_left();
+        s4o.print(s4o.indent_spaces + "}\n");
+        s4o.indent_left();
+        s4o.print(s4o.indent_spaces + "}\n");
+      }
+
+      /* generate step initializations */
+      s4o.print(s4o.indent_spaces + "// Steps initialization\n");
+      if (generate_sparse_sfc__)
+        generate_sparse_steps_initialization();
+      else if (generate_compact_sfc__ || !sfc_usage->is_most_steps_timed())
+        generate_selective_steps_initialization(symbol);
+      else {
+        s4o.print(s4o.indent_spaces + "for (i = 0; i < ");
+        print_variable_prefix();
+        s4o.print("__nb_steps; i++) {\n");
+        s4o.indent_right();
+        s4o.print(s4o.indent_spaces);
+        print_variable_prefix();
+        s4o.print("__step_list[i].prev_state = ");
+        s4o.print(GET_VAR);
+        s4o.print("(");
+        print_variable_prefix();
+        s4o.print("__step_list[i].X);\n");
+        s4o.print(s4o.indent_spaces + "if (");
+        s4o.print(GET_VAR);
+        s4o.print("(");
+        print_variable_prefix();
+        s4o.print("__step_list[i].X)) {\n");
+        s4o.indent_right();
+        s4o.print(s4o.indent_spaces);
+        print_variable_prefix();
+        s4o.print("__step_list[i].T.value = __time_add(");
+        print_variable_prefix();
+        s4o.print("__step_list[i].T.value, elapsed_time);\n");
+        s4o.indent_left();
+        s4o.print(s4o.indent_spaces + "}\n");
+        s4o.indent_left();
+        s4o.print(s4o.indent_spaces + "}\n");
+      }
+
+      /* generate action initializations */
+      s4o.print(s4o.indent_spaces + "// Actions initialization\n");
+      print_actions_loop_begin();
+      s4o.print(s4o.indent_spaces);
+      s4o.print(SET_VAR);
+      s4o.print("(");
+      print_variable_prefix();
+      s4o.print(",__action_list[" + action_index + "].state,,0);\n");
+      if (action_store) {
+        s4o.print(s4o.indent_spaces);
+        print_variable_prefix();
+        s4o.print("__action_list[" + action_index + "].set = 0;\n");
+        s4o.print(s4o.indent_spaces);
+        print_variable_prefix();
+        s4o.print("__action_list[" + action_index + "].reset = 0;\n");
+      }
+      if (action_time) {
+        print_action_timer_update(action_index, "set");
+        print_action_timer_update(action_index, "reset");
+      }
+      s4o.indent_left();
       s4o.print(s4o.indent_spaces + "}\n\n");
       
       /* generate transition tests */
       s4o.print(s4o.indent_spaces + "// Transitions fire test\n");
-      generate_c_sfc_elements->generate((symbol_c *)symbol, generate_c_sfc_elements_c::transitiontest_sg);
+      if (generate_sparse_sfc__) {
+        generate_sparse_candidates();
+        generate_sparse_transition_tests();
+      }
+      else
+        generate_c_sfc_elements->generate((symbol_c *)symbol, generate_c_sfc_elements_c::transitiontest_sg);
       s4o.print("\n");
       
       /* generate transition reset steps */
       s4o.print(s4o.indent_spaces + "// Transitions reset steps\n");
-      generate_c_sfc_elements->reset_transition_number();
-      for(i = 0; i < symbol->n; i++) {
-        generate_c_sfc_elements->generate(symbol->get_element(i), generate_c_sfc_elements_c::stepreset_sg);
+      if (generate_sparse_sfc__)
+        generate_sparse_transition_steps("transition_from");
+      else {
+        generate_c_sfc_elements->reset_transition_number();
+        for(i = 0; i < symbol->n; i++) {
+          generate_c_sfc_elements->generate(symbol->get_element(i), generate_c_sfc_elements_c::stepreset_sg);
+        }
       }
       s4o.print("\n");
       
       /* generate transition set steps */
       s4o.print(s4o.indent_spaces + "// Transitions set steps\n");
-      generate_c_sfc_elements->reset_transition_number();
-      for(i = 0; i < symbol->n; i++) {
-        generate_c_sfc_elements->generate(symbol->get_element(i), generate_c_sfc_elements_c::stepset_sg);
+      if (generate_sparse_sfc__)
+        generate_sparse_transition_steps("transition_to");
+      else {
+        generate_c_sfc_elements->reset_transition_number();
+        for(i = 0; i < symbol->n; i++) {
+          generate_c_sfc_elements->generate(symbol->get_element(i), generate_c_sfc_elements_c::stepset_sg);
+        }
       }
       s4o.print("\n");
       
       /* generate step association */
       s4o.print(s4o.indent_spaces + "// Steps association\n");
+      if (generate_sparse_sfc__)
+        print_active_steps_switch_begin();
       for(i = 0; i < symbol->n; i++) {
         generate_c_sfc_elements->generate(symbol->get_element(i), generate_c_sfc_elements_c::actionassociation_sg);
       }
+      if (generate_sparse_sfc__)
+        print_active_steps_switch_end();
       s4o.print("\n");
       
-      /* generate action state evaluation */
-      s4o.print(s4o.indent_spaces + "// Actions state evaluation\n");
-      s4o.print(s4o.indent_spaces + "for (i = 0; i < ");
-      print_variable_prefix();
-      s4o.print("__nb_actions; i++) {\n");
-      s4o.indent_right();
-      s4o.print(s4o.indent_spaces + "if (");
-      print_variable_prefix();
-      s4o.print("__action_list[i].set) {\n");
-      s4o.indent_right();
-      s4o.print(s4o.indent_spaces);
-      print_variable_prefix();
-      s4o.print("__action_list[i].set_remaining_time = __time_to_timespec(1, 0, 0, 0, 0, 0);\n" + s4o.indent_spaces);
-      print_variable_prefix();
-      s4o.print("__action_list[i].stored = 1;\n");
-      s4o.indent_left();
-      s4o.print(s4o.indent_spaces + "}\n" + s4o.indent_spaces + "if (");
-      print_variable_prefix();
-      s4o.print("__action_list[i].reset) {\n");
-      s4o.indent_right();
-      s4o.print(s4o.indent_spaces);
-      print_variable_prefix();
-      s4o.print("__action_list[i].reset_remaining_time = __time_to_timespec(1, 0, 0, 0, 0, 0);\n" + s4o.indent_spaces);
-      print_variable_prefix();
-      s4o.print("__action_list[i].stored = 0;\n");
-      s4o.indent_left();
-      s4o.print(s4o.indent_spaces + "}\n" + s4o.indent_spaces);
-      s4o.print(SET_VAR);
-      s4o.print("(");
-      print_variable_prefix();
-      s4o.print(",__action_list[i].state,,");
-      s4o.print(GET_VAR);
-      s4o.print("(");
-      print_variable_prefix();
-      s4o.print("__action_list[i].state) | ");
-      print_variable_prefix();
-      s4o.print("__action_list[i].stored);\n");
-      s4o.indent_left();
-      s4o.print(s4o.indent_spaces + "}\n\n");
+      /* generate action state evaluation (only needed for the stored actions, S, R, SL, SD and DS qualifiers) */
+      if (action_store || generate_sparse_sfc__) {
+        s4o.print(s4o.indent_spaces + "// Actions state evaluation\n");
+        if (generate_sparse_sfc__)
+          s4o.print(s4o.indent_spaces + "k = 0;\n");
+        print_actions_loop_begin();
+        if (action_store) {
+          s4o.print(s4o.indent_spaces + "if (");
+          print_variable_prefix();
+          s4o.print("__action_list[" + action_index + "].set) {\n");
+          s4o.indent_right();
+          s4o.print(s4o.indent_spaces);
+          if (action_time) {
+            print_variable_prefix();
+            s4o.print("__action_list[" + action_index + "].set_remaining_time = __time_to_timespec(1, 0, 0, 0, 0, 0);\n" + s4o.indent_spaces);
+          }
+          print_variable_prefix();
+          s4o.print("__action_list[" + action_index + "].stored = 1;\n");
+          s4o.indent_left();
+          s4o.print(s4o.indent_spaces + "}\n" + s4o.indent_spaces + "if (");
+          print_variable_prefix();
+          s4o.print("__action_list[" + action_index + "].reset) {\n");
+          s4o.indent_right();
+          s4o.print(s4o.indent_spaces);
+          if (action_time) {
+            print_variable_prefix();
+            s4o.print("__action_list[" + action_index + "].reset_remaining_time = __time_to_timespec(1, 0, 0, 0, 0, 0);\n" + s4o.indent_spaces);
+          }
+          print_variable_prefix();
+          s4o.print("__action_list[" + action_index + "].stored = 0;\n");
+          s4o.indent_left();
+          s4o.print(s4o.indent_spaces + "}\n" + s4o.indent_spaces);
+          s4o.print(SET_VAR);
+          s4o.print("(");
+          print_variable_prefix();
+          s4o.print(",__action_list[" + action_index + "].state,,");
+          s4o.print(GET_VAR);
+          s4o.print("(");
+          print_variable_prefix();
+          s4o.print("__action_list[" + action_index + "].state) | ");
+          print_variable_prefix();
+          s4o.print("__action_list[" + action_index + "].stored);\n");
+        }
+        if (generate_sparse_sfc__)
+          print_sparse_action_removal();
+        s4o.indent_left();
+        s4o.print(s4o.indent_spaces + "}\n");
+        if (generate_sparse_sfc__) {
+          s4o.print(s4o.indent_spaces);
+          print_variable_prefix();
+          s4o.print("__nb_active_actions = k;\n");
+        }
+        s4o.print("\n");
+      }
       
       /* generate action execution */
       s4o.print(s4o.indent_spaces + "// Actions execution\n");
@@ -918,7 +1432,7 @@ class generate_c_sfc_c: public generate_c_base_and_typeid_c {
         std::list<VARIABLE>::iterator pt;
         for(pt = variable_list.begin(); pt != variable_list.end(); pt++) {
 
-          if (is_variable(pt->symbol)) {
+          if (action_store && is_variable(pt->symbol)) {
             unsigned int vartype = search_var_instance_decl->get_vartype(pt->symbol);
 
             s4o.print(s4o.indent_spaces + "if (");
@@ -971,6 +1485,23 @@ class generate_c_sfc_c: public generate_c_base_and_typeid_c {
       }
       s4o.print("\n");
       
+      /* The SFC internal state is changed directly (i.e. not through the accessor macros), so 
+       * mark it all as dirty for the delta backup functions.
+       * NOTE: this relies on the SFC tables being declared in sequence, from __step_list to __lasttick_time (see generate_c_sfcdecl.cc)
+       */
+      if (generate_plc_state_delta_backup__) {
+        s4o.print(s4o.indent_spaces + "__MARK_DIRTY(&");
+        print_variable_prefix();
+        s4o.print("__step_list, &");
+        print_variable_prefix();
+        s4o.print("__lasttick_time);\n\n");
+      }
+      
+      if (sfc_usage != NULL) {
+        generate_c_sfc_elements->set_sfc_usage(NULL);
+        delete sfc_usage;
+        sfc_usage = NULL;
+      }
       return NULL;
     }
     
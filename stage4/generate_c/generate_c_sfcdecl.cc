@@ -32,6 +32,101 @@ typedef struct
 /***********************************************************************/
 /***********************************************************************/
 
+/* Find out which of the SFC step and action timers and action flags a chart actually uses, 
+ * so that the generated code only does the bookkeeping that is needed (and the compact
+ * SFC state, iec2c -O c, leaves out the timers that are not needed):
+ *   - the time a step has been active (STEP.T) is only needed by the steps whose .T 
+ *     is referenced (in transition conditions or action bodies), and by the steps 
+ *     with L or D qualified action associations;
+ *   - the remaining times of the actions are only needed for the SL, SD and DS qualifiers;
+ *   - the set/reset requests and the stored state of the actions are only needed
+ *     for the S, R, SL, SD and DS qualifiers.
+ */
+class generate_c_sfc_usage_c: public iterator_visitor_c {
+  private:
+    std::list<symbol_c *> timed_steps;
+    symbol_c *current_step;
+    unsigned int step_count;
+    bool action_time_used;
+    bool action_store_used;
+
+  public:
+    generate_c_sfc_usage_c(symbol_c *sfc) {
+      current_step = NULL;
+      step_count = 0;
+      action_time_used = false;
+      action_store_used = false;
+      sfc->accept(*this);
+    }
+
+    bool uses_step_time   (void) {return !timed_steps.empty();}
+    bool uses_action_time (void) {return action_time_used;}
+    bool uses_action_store(void) {return action_store_used;}
+    bool is_most_steps_timed(void) {return 2 * timed_steps.size() > step_count;}
+
+    bool is_timed_step(symbol_c *step_name) {return get_step_timer(step_name) >= 0;}
+    unsigned int get_step_timer_count(void) {return timed_steps.size();}
+
+    /* the index of the step's entry in __step_timer_list (compact SFC state), or -1 if the step is not timed */
+    int get_step_timer(symbol_c *step_name) {
+      std::list<symbol_c *>::iterator pt;
+      int index = 0;
+      for(pt = timed_steps.begin(); pt != timed_steps.end(); pt++, index++)
+        if (!compare_identifiers(*pt, step_name))
+          return index;
+      return -1;
+    }
+
+  private:
+    void add_timed_step(symbol_c *step_name) {
+      if (!is_timed_step(step_name))
+        timed_steps.push_back(step_name);
+    }
+
+  public:
+    /* stepname.T */
+    void *visit(structured_variable_c *symbol) {
+      token_c *field = dynamic_cast<token_c *>(symbol->field_selector);
+      if (   get_datatype_info_c::is_sfc_step(symbol->record_variable->datatype)
+          && (field != NULL) && (strcasecmp(field->value, "T") == 0))
+        add_timed_step(get_var_name_c::get_last_field(symbol->record_variable));
+      return iterator_visitor_c::visit(symbol);
+    }
+
+    void *visit(initial_step_c *symbol) {
+      step_count++;
+      current_step = symbol->step_name;
+      symbol->action_association_list->accept(*this);
+      current_step = NULL;
+      return NULL;
+    }
+
+    void *visit(step_c *symbol) {
+      step_count++;
+      current_step = symbol->step_name;
+      symbol->action_association_list->accept(*this);
+      current_step = NULL;
+      return NULL;
+    }
+
+    void *visit(action_qualifier_c *symbol) {
+      const char *qualifier = ((token_c *)symbol->action_qualifier)->value;
+      if ((strcmp(qualifier, "L") == 0) || (strcmp(qualifier, "D") == 0)) {
+        if (current_step != NULL) add_timed_step(current_step);
+      }
+      if ((strcmp(qualifier, "SL") == 0) || (strcmp(qualifier, "SD") == 0) || (strcmp(qualifier, "DS") == 0))
+        action_time_used = action_store_used = true;
+      if ((strcmp(qualifier, "S") == 0) || (strcmp(qualifier, "R") == 0))
+        action_store_used = true;
+      return NULL;
+    }
+};
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
 class generate_c_sfcdecl_c: protected generate_c_base_and_typeid_c {
   
   public:
@@ -56,15 +151,20 @@ class generate_c_sfcdecl_c: protected generate_c_base_and_typeid_c {
     sfcdeclaration_t wanted_sfcdeclaration;
 
     search_var_instance_decl_c *search_var_instance_decl;
+
+    /* the timers used by the chart, when generating the compact SFC state (NULL otherwise) */
+    generate_c_sfc_usage_c *sfc_usage;
     
   public:
     generate_c_sfcdecl_c(stage4out_c *s4o_ptr, symbol_c *scope, const char *variable_prefix = NULL)
     : generate_c_base_and_typeid_c(s4o_ptr) {
       this->set_variable_prefix(variable_prefix);
       search_var_instance_decl = new search_var_instance_decl_c(scope);
+      sfc_usage = NULL;
     }
     ~generate_c_sfcdecl_c(void) {
       variable_list.clear();
+      delete sfc_usage;
       delete search_var_instance_decl;
     }
     
@@ -82,19 +182,37 @@ class generate_c_sfcdecl_c: protected generate_c_base_and_typeid_c {
       step_number = 0;
       action_number = 0;
       transition_number = 0;
+      /* The compact SFC state leaves out the timers the chart does not use: the steps are kept in
+       * an UNTIMED_STEP table, and the time the timed steps have been active (stepname.T) in
+       * __step_timer_list, accessed through the SFC_STEP_TIMER_PREFIX<stepname> macros.
+       */
+      bool step_time   = true;
+      bool action_time = true;
+      unsigned int step_timer_count = 0;
+      if (generate_compact_sfc__) {
+        sfc_usage   = new generate_c_sfc_usage_c(symbol);
+        step_time   = false;
+        action_time = sfc_usage->uses_action_time();
+        step_timer_count = sfc_usage->get_step_timer_count();
+      }
       switch (wanted_sfcdeclaration) {
         case sfcdecl_sd:
           for(int i = 0; i < symbol->n; i++)
             symbol->get_element(i)->accept(*this);
           
           /* steps table declaration */
-          s4o.print(s4o.indent_spaces + "STEP __step_list[");
+          s4o.print(s4o.indent_spaces + (step_time ? "STEP" : "UNTIMED_STEP") + " __step_list[");
           s4o.print(step_number);
           s4o.print("];\n");
           s4o.print(s4o.indent_spaces + "UINT __nb_steps;\n");
+          if (step_timer_count > 0) {
+            s4o.print(s4o.indent_spaces + "__IEC_TIME_t __step_timer_list[");
+            s4o.print(step_timer_count);
+            s4o.print("];\n");
+          }
           
           /* actions table declaration */
-          s4o.print(s4o.indent_spaces + "ACTION __action_list[");
+          s4o.print(s4o.indent_spaces + (action_time ? "ACTION" : "UNTIMED_ACTION") + " __action_list[");
           s4o.print(action_number);
           s4o.print("];\n");
           s4o.print(s4o.indent_spaces + "UINT __nb_actions;\n");
@@ -105,11 +223,28 @@ class generate_c_sfcdecl_c: protected generate_c_base_and_typeid_c {
           s4o.print("];\n");
           
           /* transitions debug table declaration */
-          s4o.print(s4o.indent_spaces + "__IEC_BOOL_t __debug_transition_list[");
-          s4o.print(transition_number);
-          s4o.print("];\n");
+          if (!disable_debug_code__) {
+            s4o.print(s4o.indent_spaces + "__IEC_BOOL_t __debug_transition_list[");
+            s4o.print(transition_number);
+            s4o.print("];\n");
+          }
           s4o.print(s4o.indent_spaces + "UINT __nb_transitions;\n");
           
+          /* active steps and actions lists declaration, used by the sparse SFC engine */
+          if (generate_sparse_sfc__) {
+            s4o.print(s4o.indent_spaces + "UINT __active_step_list[");
+            s4o.print(step_number);
+            s4o.print("];\n");
+            s4o.print(s4o.indent_spaces + "UINT __nb_active_steps;\n");
+            s4o.print(s4o.indent_spaces + "UINT __active_action_list[");
+            s4o.print(action_number);
+            s4o.print("];\n");
+            s4o.print(s4o.indent_spaces + "BOOL __action_listed[");
+            s4o.print(action_number);
+            s4o.print("];\n");
+            s4o.print(s4o.indent_spaces + "UINT __nb_active_actions;\n");
+          }
+          
           /* last_ticktime declaration */
           s4o.print(s4o.indent_spaces + "TIME __lasttick_time;\n");
           break;
@@ -130,7 +265,10 @@ class generate_c_sfcdecl_c: protected generate_c_base_and_typeid_c {
           wanted_sfcdeclaration = sfcinit_sd;
           
           /* steps table initialisation */
-          s4o.print(s4o.indent_spaces + "static const STEP temp_step = {{0, 0}, 0, {{0, 0}, 0}};\n");
+          if (step_time)
+            s4o.print(s4o.indent_spaces + "static const STEP temp_step = {{0, 0}, 0, {{0, 0}, 0}};\n");
+          else
+            s4o.print(s4o.indent_spaces + "static const UNTIMED_STEP temp_step = {{0, 0}, 0};\n");
           s4o.print(s4o.indent_spaces + "for(i = 0; i < ");
           print_variable_prefix();
           s4o.print("__nb_steps; i++) {\n");
@@ -140,6 +278,23 @@ class generate_c_sfcdecl_c: protected generate_c_base_and_typeid_c {
           s4o.print("__step_list[i] = temp_step;\n");
           s4o.indent_left();
           s4o.print(s4o.indent_spaces + "}\n");
+          if (step_timer_count > 0) {
+            s4o.print(s4o.indent_spaces + "static const __IEC_TIME_t temp_step_timer = {{0, 0}, 0};\n");
+            s4o.print(s4o.indent_spaces + "for(i = 0; i < ");
+            s4o.print(step_timer_count);
+            s4o.print("; i++) {\n");
+            s4o.indent_right();
+            s4o.print(s4o.indent_spaces);
+            print_variable_prefix();
+            s4o.print("__step_timer_list[i] = temp_step_timer;\n");
+            s4o.indent_left();
+            s4o.print(s4o.indent_spaces + "}\n");
+          }
+          if (generate_sparse_sfc__) {
+            s4o.print(s4o.indent_spaces);
+            print_variable_prefix();
+            s4o.print("__nb_active_steps = 0;\n");
+          }
           for(int i = 0; i < symbol->n; i++)
             symbol->get_element(i)->accept(*this);
           
@@ -156,7 +311,10 @@ class generate_c_sfcdecl_c: protected generate_c_base_and_typeid_c {
           wanted_sfcdeclaration = sfcinit_sd;
           
           /* actions table initialisation */
-          s4o.print(s4o.indent_spaces + "static const ACTION temp_action = {0, {0, 0}, 0, 0, {0, 0}, {0, 0}};\n");
+          if (action_time)
+            s4o.print(s4o.indent_spaces + "static const ACTION temp_action = {0, {0, 0}, 0, 0, {0, 0}, {0, 0}};\n");
+          else
+            s4o.print(s4o.indent_spaces + "static const UNTIMED_ACTION temp_action = {0, {0, 0}, 0, 0};\n");
           s4o.print(s4o.indent_spaces + "for(i = 0; i < ");
           print_variable_prefix();
           s4o.print("__nb_actions; i++) {\n");
@@ -164,8 +322,18 @@ class generate_c_sfcdecl_c: protected generate_c_base_and_typeid_c {
           s4o.print(s4o.indent_spaces);
           print_variable_prefix();
           s4o.print("__action_list[i] = temp_action;\n");
+          if (generate_sparse_sfc__) {
+            s4o.print(s4o.indent_spaces);
+            print_variable_prefix();
+            s4o.print("__action_listed[i] = 0;\n");
+          }
           s4o.indent_left();
           s4o.print(s4o.indent_spaces + "}\n");
+          if (generate_sparse_sfc__) {
+            s4o.print(s4o.indent_spaces);
+            print_variable_prefix();
+            s4o.print("__nb_active_actions = 0;\n");
+          }
           
           /* transitions table count */
           wanted_sfcdeclaration = transitioncount_sd;
@@ -245,8 +413,31 @@ class generate_c_sfcdecl_c: protected generate_c_base_and_typeid_c {
         default:
           break;
       }
+      delete sfc_usage;
+      sfc_usage = NULL;
       return NULL;
     }
+
+    /* the SFC_STEP_TIMER_PREFIX<stepname> macro of the timed steps (compact SFC state) */
+    void print_step_timer_define(symbol_c *step_name) {
+      if ((sfc_usage == NULL) || !sfc_usage->is_timed_step(step_name))
+        return;
+      s4o.print("#define ");
+      s4o.print(SFC_STEP_TIMER_PREFIX);
+      step_name->accept(*this);
+      s4o.print(" __step_timer_list[");
+      s4o.print(sfc_usage->get_step_timer(step_name));
+      s4o.print("]\n");
+    }
+
+    void print_step_timer_undef(symbol_c *step_name) {
+      if ((sfc_usage == NULL) || !sfc_usage->is_timed_step(step_name))
+        return;
+      s4o.print("#undef ");
+      s4o.print(SFC_STEP_TIMER_PREFIX);
+      step_name->accept(*this);
+      s4o.print("\n");
+    }
     
     void *visit(initial_step_c *symbol) {
       switch (wanted_sfcdeclaration) {
@@ -266,6 +457,15 @@ class generate_c_sfcdecl_c: protected generate_c_base_and_typeid_c {
           s4o.print(",__step_list[");
           s4o.print(step_number);
           s4o.print("].X,,1);\n");
+          if (generate_sparse_sfc__) {
+            s4o.print(s4o.indent_spaces);
+            print_variable_prefix();
+            s4o.print("__active_step_list[");
+            print_variable_prefix();
+            s4o.print("__nb_active_steps++] = ");
+            s4o.print(step_number);
+            s4o.print(";\n");
+          }
           step_number++;
           break;
         case stepdef_sd:
@@ -281,6 +481,7 @@ class generate_c_sfcdecl_c: protected generate_c_base_and_typeid_c {
           s4o.print(" ");
           s4o.print(step_number);
           s4o.print("\n");
+          print_step_timer_define(symbol->step_name);
           step_number++;
           break;
         case stepundef_sd:
@@ -292,6 +493,7 @@ class generate_c_sfcdecl_c: protected generate_c_base_and_typeid_c {
           s4o.print(SFC_STEP_ACTION_PREFIX);
           symbol->step_name->accept(*this);
           s4o.print("\n");
+          print_step_timer_undef(symbol->step_name);
           break;
         default:
           break;
@@ -323,6 +525,7 @@ class generate_c_sfcdecl_c: protected generate_c_base_and_typeid_c {
           s4o.print(" ");
           s4o.print(step_number);
           s4o.print("\n");
+          print_step_timer_define(symbol->step_name);
           step_number++;
           break;
         case stepundef_sd:
@@ -334,6 +537,7 @@ class generate_c_sfcdecl_c: protected generate_c_base_and_typeid_c {
           s4o.print(SFC_STEP_ACTION_PREFIX);
           symbol->step_name->accept(*this);
           s4o.print("\n");
+          print_step_timer_undef(symbol->step_name);
           break;
         default:
           break;
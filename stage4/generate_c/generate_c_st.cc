@@ -262,6 +262,9 @@ void *visit(symbolic_variable_c *symbol) {
     case complextype_suffix_vg:
       break;
     default:
+      /* the value of the variable may be known at compile time (stage3 constant propagation) */
+      if ((wanted_variablegeneration == expression_vg) && print_propagated_value(symbol))
+        break;
       if (this->is_variable_prefix_null()) {
         if (wanted_variablegeneration == fparam_output_vg) {
           s4o.print("&(");
@@ -323,6 +326,8 @@ void *visit(structured_variable_c *symbol) {
   TRACE("structured_variable_c");
   switch (wanted_variablegeneration) {
     case complextype_base_vg:
+      if (print_step_timer(symbol))
+        break;
       symbol->record_variable->accept(*this);
       /* NOTE: The following test includes a special case for SFC Steps. They are currently mapped onto a C data structure
        *        that does not follow the standard IEC_<typename> pattern used for user defined structure datatypes 
@@ -427,14 +432,10 @@ void *visit(array_variable_c *symbol) {
 void *visit(subscript_list_c *symbol) {
   array_dimension_iterator_c* array_dimension_iterator = new array_dimension_iterator_c(current_array_type);
   for (int i =  0; i < symbol->n; i++) {
-    symbol_c* dimension = array_dimension_iterator->next();
+    subrange_c* dimension = array_dimension_iterator->next();
     if (dimension == NULL) ERROR;
 
-    s4o.print("[(");
-    symbol->get_element(i)->accept(*this);
-    s4o.print(") - (");
-    dimension->accept(*this);
-    s4o.print(")]");
+    print_array_subscript(symbol, i, dimension);
   }
   delete array_dimension_iterator;
   return NULL;
@@ -1133,39 +1134,65 @@ void *visit(not_paramassign_c *symbol) {
 /********************************/
 /* B 3.2.3 Selection Statements */
 /********************************/
+/* Returns 1 if the condition is always TRUE, 0 if always FALSE, and -1 if not known at compile time.
+ * Only used (i.e. only returns 0 or 1) when generating code with the propagated variable values!
+ */
+int get_condition_value(symbol_c *condition) {
+  if (!generate_propagated_values__ || !VALID_CVALUE(bool, condition)) return -1;
+  return GET_CVALUE(bool, condition)? 1 : 0;
+}
+
 void *visit(if_statement_c *symbol) {
-  s4o.print("if (");
-  symbol->expression->accept(*this);
-  s4o.print(") {\n");
-  s4o.indent_right();
-  symbol->statement_list->accept(*this);
-  s4o.indent_left();
-  symbol->elseif_statement_list->accept(*this);
+  /* Leave out the branches whose condition is always FALSE, and the branches following
+   * a condition that is always TRUE (that branch then becomes the 'else' branch).
+   */
+  std::vector<symbol_c *> conditions, statements;
+  symbol_c *else_statements = symbol->else_statement_list;
+  list_c   *elseif_list     = dynamic_cast<list_c *>(symbol->elseif_statement_list);
+  for (int i = -1; i < ((NULL == elseif_list)? 0 : elseif_list->n); i++) {
+    elseif_statement_c *elseif = (i < 0)? NULL : dynamic_cast<elseif_statement_c *>(elseif_list->get_element(i));
+    if ((i >= 0) && (NULL == elseif)) ERROR;
+    symbol_c *condition = (i < 0)? symbol->expression     : elseif->expression;
+    symbol_c *statement = (i < 0)? symbol->statement_list : elseif->statement_list;
+    int value = get_condition_value(condition);
+    if (value == 0) continue;
+    if (value == 1) {else_statements = statement; break;}
+    conditions.push_back(condition);
+    statements.push_back(statement);
+  }
+
+  if (conditions.size() == 0) {
+    /* no branch needs to be tested at runtime */
+    s4o.print("{\n");
+    if (else_statements != NULL) {
+      s4o.indent_right();
+      else_statements->accept(*this);
+      s4o.indent_left();
+    }
+    s4o.print(s4o.indent_spaces); s4o.print("}");
+    return NULL;
+  }
+
+  for (unsigned int i = 0; i < conditions.size(); i++) {
+    if (i > 0) {s4o.print(s4o.indent_spaces); s4o.print("} else ");}
+    s4o.print("if (");
+    conditions[i]->accept(*this);
+    s4o.print(") {\n");
+    s4o.indent_right();
+    statements[i]->accept(*this);
+    s4o.indent_left();
+  }
 
-  if (symbol->else_statement_list != NULL) {
+  if (else_statements != NULL) {
     s4o.print(s4o.indent_spaces); s4o.print("} else {\n");
     s4o.indent_right();
-    symbol->else_statement_list->accept(*this);
+    else_statements->accept(*this);
     s4o.indent_left();
   }
   s4o.print(s4o.indent_spaces); s4o.print("}");
   return NULL;
 }
 
-/* helper symbol for if_statement */
-void *visit(elseif_statement_list_c *symbol) {return print_list(symbol);}
-
-/* helper symbol for elseif_statement_list */
-void *visit(elseif_statement_c *symbol) {
-  s4o.print(s4o.indent_spaces); s4o.print("} else if (");
-  symbol->expression->accept(*this);
-  s4o.print(") {\n");
-  s4o.indent_right();
-  symbol->statement_list->accept(*this);
-  s4o.indent_left();
-  return NULL;
-}
-
 void *visit(case_statement_c *symbol) {
   symbol_c *expression_type = symbol->expression->datatype;
   s4o.print("{\n");
@@ -1344,6 +1371,8 @@ void *visit(for_statement_c *symbol) {
 }
 
 void *visit(while_statement_c *symbol) {
+  /* the loop body is never executed */
+  if (get_condition_value(symbol->expression) == 0) {s4o.print("{}"); return NULL;}
   s4o.print("while (");
   symbol->expression->accept(*this);
   s4o.print(") {\n");
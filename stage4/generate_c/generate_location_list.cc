@@ -65,3 +65,218 @@ class generate_location_list_c: public iterator_visitor_c {
     }
 
 }; /* generate_location_list_c */
+
+
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/* Generate the layout of the packed process image (generated with the 'i' stage4 option).
+ *
+ * All the located variables of each address area (%I, %Q and %M) are placed in a
+ * single contiguous block of memory, so the runtime may exchange the whole area with
+ * the I/O drivers (or a shared memory block) with a single memcpy() per scan cycle,
+ * instead of binding and copying each location on its own.
+ *
+ * The generated PROCESS_IMAGE.h file contains the size of each area, and one line per
+ * location with its offset within the area:
+ *     #define __PROCESS_IMAGE_I_SIZE 12
+ *     ...
+ *     __PROCESS_IMAGE_VAR(INT,__IW0_1,I,8)
+ * The runtime defines the __PROCESS_IMAGE_VAR(type, name, area, offset) macro before
+ * including the file, e.g.:
+ *     char __process_image_I[__PROCESS_IMAGE_I_SIZE];
+ *     #define __PROCESS_IMAGE_VAR(type, name, area, offset)  type *name = (type *)(__process_image_##area + offset);
+ *
+ * Each area is sorted by decreasing size of its locations (L, D, W, B, X), so every
+ * location is naturally aligned without any padding. A BOOL (%X) location takes a whole byte.
+ * Locations with the same area, size and address share the same offset (e.g. %IX0.1 and %I0.1).
+ * Locations without a size prefix whose size cannot be determined from their elementary
+ * datatype are not placed in the process image, and must be bound individually as before.
+ */
+class generate_process_image_c: public iterator_visitor_c {
+
+  private:
+    typedef struct {
+      std::string name;          /* __IW0_1 */
+      char area;                 /* I, Q or M */
+      int size;                  /* in bytes; 0 if unknown */
+      std::vector<unsigned long> address;
+      symbol_c *type;
+      unsigned long offset;
+    } location_t;
+
+    stage4out_c &s4o;
+    generate_c_base_and_typeid_c generate_c_base;
+    std::list<location_t> locations;
+    std::set<std::string> location_names;  /* the names of the locations in the list, to find duplicates quickly */
+    symbol_c *current_var_type_symbol;
+
+    static int location_size(char size_char, symbol_c *type) {
+      switch (size_char) {
+        case 'X': return 1;
+        case 'B': return 1;
+        case 'W': return 2;
+        case 'D': return 4;
+        case 'L': return 8;
+      }
+      /* no size prefix => use the size of the elementary datatype */
+      static const struct {const char *name; int size;} elementary_sizes[] = {
+        {"BOOL", 1}, {"SINT", 1}, {"USINT", 1}, {"BYTE", 1},
+        {"INT",  2}, {"UINT", 2}, {"WORD",  2},
+        {"DINT", 4}, {"UDINT",4}, {"DWORD", 4}, {"REAL", 4},
+        {"LINT", 8}, {"ULINT",8}, {"LWORD", 8}, {"LREAL",8},
+        {NULL,   0}};
+      symbol_c *base_type = search_base_type_c::get_basetype_decl(type);
+      if ((NULL == base_type) || !get_datatype_info_c::is_ANY_ELEMENTARY_compatible(base_type))
+        return 0;
+      const char *name = get_datatype_info_c::get_id_str(base_type);
+      if (strncmp(name, "SAFE", 4) == 0)
+        name += 4;
+      for (int i = 0; elementary_sizes[i].name != NULL; i++)
+        if (strcmp(name, elementary_sizes[i].name) == 0)
+          return elementary_sizes[i].size;
+      return 0;
+    }
+
+    /* sort by area, decreasing size, and address */
+    static bool location_order(const location_t &a, const location_t &b) {
+      if (a.area != b.area) return a.area < b.area;
+      if (a.size != b.size) return a.size > b.size;
+      if (a.address != b.address) return a.address < b.address;
+      return a.name < b.name;
+    }
+
+    static bool same_slot(const location_t &a, const location_t &b) {
+      return (a.area == b.area) && (a.size == b.size) && (a.address == b.address);
+    }
+
+    void add_location(symbol_c *location) {
+      direct_variable_c *direct_variable = dynamic_cast<direct_variable_c *>(location);
+      if (NULL == direct_variable) {
+        location_c *location_ = dynamic_cast<location_c *>(location);
+        if (NULL == location_) ERROR;
+        direct_variable = dynamic_cast<direct_variable_c *>(location_->direct_variable);
+      }
+      if (NULL == direct_variable) ERROR;
+
+      const char *str = direct_variable->value + 1;  /* skip the '%' */
+      location_t loc;
+      loc.name = "__";
+      for (int i = 0; str[i] != '\0'; i++)
+        loc.name += (str[i] == '.')? '_' : toupper(str[i]);
+      if (!location_names.insert(loc.name).second)
+        return;  /* location already declared elsewhere */
+
+      loc.area = toupper(str[0]);
+      char size_char = toupper(str[1]);
+      const char *addr = (isdigit(str[1]))? str+1 : str+2;
+      loc.size = location_size(size_char, current_var_type_symbol);
+      for (char *end; *addr != '\0'; addr = (*end == '.')? end+1 : end) {
+        loc.address.push_back(strtoul(addr, &end, 10));
+        if (end == addr) break;
+      }
+      loc.type = current_var_type_symbol;
+      loc.offset = 0;
+      locations.push_back(loc);
+    }
+
+    void print_area_size(char area) {
+      unsigned long size = 0;
+      for (std::list<location_t>::iterator it = locations.begin(); it != locations.end(); it++)
+        if ((it->area == area) && (it->size != 0) && (it->offset + it->size > size))
+          size = it->offset + it->size;
+      s4o.print("#define __PROCESS_IMAGE_");
+      s4o.print(std::string(1, area));
+      s4o.print("_SIZE ");
+      s4o.print(size);
+      s4o.print("\n");
+    }
+
+  public:
+    generate_process_image_c(stage4out_c *s4o_ptr): s4o(*s4o_ptr), generate_c_base(s4o_ptr) {
+      current_var_type_symbol = NULL;
+    }
+
+    ~generate_process_image_c(void) {}
+
+    void generate(symbol_c *symbol) {
+      locations.clear();
+      location_names.clear();
+      symbol->accept(*this);
+      locations.sort(location_order);
+
+      /* compute the offsets */
+      unsigned long offset = 0;
+      std::list<location_t>::iterator prev = locations.end();
+      for (std::list<location_t>::iterator it = locations.begin(); it != locations.end(); prev = it++) {
+        if ((prev == locations.end()) || (prev->area != it->area))
+          offset = 0;
+        if (it->size == 0) continue;
+        if ((prev != locations.end()) && same_slot(*prev, *it)) {
+          it->offset = prev->offset;
+          continue;
+        }
+        it->offset = offset;
+        offset += it->size;
+      }
+
+      s4o.print("/* Layout of the packed process image of the located variables */\n\n");
+      print_area_size('I');
+      print_area_size('Q');
+      print_area_size('M');
+      s4o.print("\n");
+      for (std::list<location_t>::iterator it = locations.begin(); it != locations.end(); it++) {
+        if (it->size == 0) {
+          s4o.print("/* not in the process image: ");
+          s4o.print(it->name);
+          s4o.print(" */\n");
+          continue;
+        }
+        s4o.print("__PROCESS_IMAGE_VAR(");
+        it->type->accept(generate_c_base);
+        s4o.print(",");
+        s4o.print(it->name);
+        s4o.print(",");
+        s4o.print(std::string(1, it->area));
+        s4o.print(",");
+        s4o.print(it->offset);
+        s4o.print(")\n");
+      }
+    }
+
+/********************************************/
+/* B.1.4.3   Declaration and initilization  */
+/********************************************/
+
+/*  [variable_name] location ':' located_var_spec_init */
+/* variable_name -> may be NULL ! */
+//SYM_REF4(located_var_decl_c, variable_name, location, located_var_spec_init, unused)
+    void *visit(located_var_decl_c *symbol) {
+      current_var_type_symbol = spec_init_sperator_c::get_spec(symbol->located_var_spec_init);
+      add_location(symbol->location);
+      current_var_type_symbol = NULL;
+      return NULL;
+    }
+
+/*| global_var_spec ':' [located_var_spec_init|function_block_type_name] */
+/* type_specification ->may be NULL ! */
+//SYM_REF2(global_var_decl_c, global_var_spec, type_specification)
+    void *visit(global_var_decl_c *symbol) {
+      current_var_type_symbol = spec_init_sperator_c::get_spec(symbol->type_specification);
+      symbol->global_var_spec->accept(*this);
+      current_var_type_symbol = NULL;
+      return NULL;
+    }
+
+/*| global_var_name location */
+// SYM_REF2(global_var_spec_c, global_var_name, location)
+    void *visit(global_var_spec_c *symbol) {
+      add_location(symbol->location);
+      return NULL;
+    }
+
+}; /* generate_process_image_c */
@@ -213,7 +213,8 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
     typedef enum {
       none_dt,
       programs_dt,
-      variables_dt
+      variables_dt,
+      image_dt
     } declarationtype_t;
 
     declarationtype_t current_declarationtype;
@@ -239,6 +240,12 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
     std::list<SYMBOL> current_symbol_list;
     search_type_symbol_c *search_type_symbol;
     unsigned int is_retain;
+    /* used when generating the retain image and shared snapshot tables (image_dt) */
+    symbol_c *image_scope;
+    bool in_image_scope;
+    bool image_retain_only;
+    std::list<SYMBOL> c_symbol_list;
+    identifier_c *single_resource_name;
 
   public:
     generate_var_list_c(stage4out_c *s4o_ptr, symbol_c *scope)
@@ -250,10 +257,15 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
       current_declarationtype = none_dt;
       current_var_class_category = none_vcc;
       is_retain = 0;
+      image_scope = NULL;
+      in_image_scope = false;
+      image_retain_only = false;
+      single_resource_name = new identifier_c("RESOURCE");
     }
     
     ~generate_var_list_c(void) {
       delete search_type_symbol;
+      delete single_resource_name;
     }
     
     void update_var_type_symbol(symbol_c *symbol) {
@@ -285,6 +297,24 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
       s4o.print("\n");
     }
     
+    /* Print the entries of the retain image table (retain_only == true) or shared
+     * snapshot table (retain_only == false) for the variables stored in <scope>, 
+     * i.e. either the global variables of the <configuration> itself, or the global
+     * variables and program instances of one of its resources (resource_declaration_c
+     * or single_resource_declaration_c).
+     * External and located variables are not included, as they only
+     * reference variables stored elsewhere.
+     */
+    void generate_image_table(symbol_c *configuration, symbol_c *scope, bool retain_only) {
+      configuration_defined = false;
+      current_declarationtype = image_dt;
+      image_scope = scope;
+      image_retain_only = retain_only;
+      configuration->accept(*this);
+      image_scope = NULL;
+      current_declarationtype = none_dt;
+    }
+    
     void declare_variables(symbol_c *symbol) {
       list_c *list = dynamic_cast<list_c *>(symbol);
       /* should NEVER EVER occur!! */
@@ -296,6 +326,10 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
     }
     
     void declare_variable(symbol_c *symbol) {
+      if (current_declarationtype == image_dt) {
+        declare_image_variable(symbol);
+        return;
+      }
       // Arrays and structures are not supported in debugging
       switch (search_type_symbol->current_var_type_category) {
           case search_type_symbol_c::array_vtc:
@@ -380,6 +414,37 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
           break;
       }
     }
+    /* print a __IMAGE_ENTRY(c_name, type, iec_name) line of the retain image/shared snapshot table,
+     * or recurse into the FB instance.
+     */
+    void declare_image_variable(symbol_c *symbol) {
+      if (!in_image_scope || this->current_var_class_category != none_vcc)
+        return;
+      if (search_type_symbol->current_var_type_category == search_type_symbol_c::function_block_vtc) {
+        SYMBOL current_name;
+        symbol_c *tmp_var_type = this->current_var_type_symbol;
+        current_name.symbol = symbol;
+        current_symbol_list.push_back(current_name);
+        c_symbol_list.push_back(current_name);
+        this->current_var_type_symbol->accept(*this);
+        c_symbol_list.pop_back();
+        current_symbol_list.pop_back();
+        this->current_var_type_symbol = tmp_var_type;
+        return;
+      }
+      if (image_retain_only && !is_retain)
+        return;
+      s4o.print("  __IMAGE_ENTRY(");
+      print_c_symbol_list();
+      symbol->accept(*this);
+      s4o.print(", \"");
+      this->current_var_type_name->accept(*this);
+      s4o.print("\", \"");
+      print_symbol_list();
+      symbol->accept(*this);
+      s4o.print("\")\n");
+    }
+
     void print_retain() {
       if(is_retain)
           s4o.print("1");
@@ -420,6 +485,17 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
       }
     }
 
+    /* the C name of the enclosing configuration or resource, program and FB instances:
+     * <CONFIG>__  or  <RESOURCE>__<PROGRAM>.<FB>.
+     */
+    void print_c_symbol_list() {
+      std::list<SYMBOL>::iterator pt;
+      for(pt = c_symbol_list.begin(); pt != c_symbol_list.end(); pt++) {
+        pt->symbol->accept(*this);
+        s4o.print((pt == c_symbol_list.begin())? "__":".");
+      }
+    }
+
 
 /********************************/
 /* B 1.3.3 - Derived data types */
@@ -468,6 +544,23 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
       return NULL;
     }
 
+    /* VAR_INPUT [RETAIN | NON_RETAIN] input_declaration_list END_VAR */
+    /* NOTE: In the RETAIN column of VARIABLES.csv the qualifiers of VAR_INPUT and
+     *       VAR NON_RETAIN have always leaked into the following declarations. So as not
+     *       to change that file for existing projects, they are only scoped when
+     *       generating the retain image table.
+     */
+    void *visit(input_declarations_c *symbol) {
+      if (current_declarationtype != image_dt)
+        return iterator_visitor_c::visit(symbol);
+      unsigned int was_retain = is_retain;
+      if (symbol->option != NULL)
+        symbol->option->accept(*this);
+      symbol->input_declaration_list->accept(*this);
+      is_retain = was_retain;
+      return NULL;
+    }
+
     /* VAR_OUTPUT [RETAIN | NON_RETAIN] var_init_decl_list END_VAR */
     void *visit(output_declarations_c *symbol) {
       unsigned int was_retain = is_retain;
@@ -487,6 +580,32 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
       return NULL;
     }
 
+    /*  VAR NON_RETAIN var_init_decl_list END_VAR */
+    void *visit(non_retentive_var_decls_c *symbol) {
+      if (current_declarationtype != image_dt)
+        return iterator_visitor_c::visit(symbol);
+      unsigned int was_retain = is_retain;
+      is_retain = 0;
+      symbol->var_decl_list->accept(*this);
+      is_retain = was_retain;
+      return NULL;
+    }
+
+    /* VAR_IN_OUT and VAR_TEMP variables do not keep their value between calls,
+     * so they are never part of the retain image.
+     */
+    void *visit(input_output_declarations_c *symbol) {
+      if (current_declarationtype != image_dt)
+        symbol->var_declaration_list->accept(*this);
+      return NULL;
+    }
+
+    void *visit(temp_var_decls_c *symbol) {
+      if (current_declarationtype != image_dt)
+        symbol->var_decl_list->accept(*this);
+      return NULL;
+    }
+
     /*  VAR [CONSTANT|RETAIN|NON_RETAIN] located_var_decl_list END_VAR */
     void *visit(located_var_declarations_c *symbol) {
       unsigned int was_retain = is_retain;
@@ -902,6 +1021,8 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
         symbol->var_declarations->accept(*this);
         symbol->fblock_body->accept(*this);
       }
+      if (current_declarationtype == image_dt && configuration_defined)
+        symbol->var_declarations->accept(*this);
       return NULL;
     }
 
@@ -913,6 +1034,8 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
         symbol->var_declarations->accept(*this);
         symbol->function_block_body->accept(*this);
       }
+      if (current_declarationtype == image_dt && configuration_defined)
+        symbol->var_declarations->accept(*this);
       return NULL;
     }
 
@@ -973,6 +1096,11 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
     /* integer -> may be NULL ! */
     //SYM_REF5(transition_c, transition_name, integer, from_steps, to_steps, transition_condition)
     void *visit(transition_c *symbol) {
+      /* no __debug_transition_list when generating code without the debug support */
+      if (disable_debug_code__) {
+        transition_number++;
+        return NULL;
+      }
       print_var_number();
       s4o.print(";VAR;");
       print_symbol_list();
@@ -1060,6 +1188,18 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
            */
           reset_var_type_symbol();
           
+          break;
+        case image_dt:
+          {
+            /* PROGRAM RETAIN program_name ... retains all the variables not explicitly declared NON_RETAIN */
+            unsigned int was_retain = is_retain;
+            if (symbol->retain_option != NULL)
+              symbol->retain_option->accept(*this);
+            update_var_type_symbol(symbol->program_type_name);
+            declare_variable(symbol->program_name);
+            reset_var_type_symbol();
+            is_retain = was_retain;
+          }
           break;
         default:
           break;
@@ -1088,11 +1228,21 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
           if (symbol->global_var_declarations != NULL)
             symbol->global_var_declarations->accept(*this);
           break;
+        case image_dt:
+          if ((image_scope == symbol) && (symbol->global_var_declarations != NULL)) {
+            in_image_scope = true;
+            c_symbol_list.push_back(*current_name);
+            symbol->global_var_declarations->accept(*this);
+            c_symbol_list.pop_back();
+            in_image_scope = false;
+          }
+          break;
         default:
           break;
       }
 
-      symbol->resource_declarations->accept(*this);
+      if (!((current_declarationtype == image_dt) && (image_scope == symbol)))
+        symbol->resource_declarations->accept(*this);
       current_symbol_list.pop_back();
       configuration_defined = false;
       return NULL;
@@ -1115,6 +1265,16 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
           if (symbol->global_var_declarations != NULL)
             symbol->global_var_declarations->accept(*this);
           break;
+        case image_dt:
+          if (image_scope != symbol) {
+            current_symbol_list.pop_back();
+            return NULL;
+          }
+          in_image_scope = true;
+          c_symbol_list.push_back(*current_name);
+          if (symbol->global_var_declarations != NULL)
+            symbol->global_var_declarations->accept(*this);
+          break;
         default:
           break;
       }
@@ -1122,6 +1282,10 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
       
       symbol->resource_declaration->accept(*this);
       
+      if (current_declarationtype == image_dt) {
+        c_symbol_list.pop_back();
+        in_image_scope = false;
+      }
       current_symbol_list.pop_back();
       return NULL;
     }
@@ -1129,7 +1293,19 @@ class generate_var_list_c: protected generate_c_base_and_typeid_c {
     /* task_configuration_list program_configuration_list */
     //SYM_REF2(single_resource_declaration_c, task_configuration_list, program_configuration_list)
     void *visit(single_resource_declaration_c *symbol) {
+      /* A configuration without any RESOURCE stores its program instances in the implicit 'RESOURCE' */
+      bool implicit_resource = (current_declarationtype == image_dt) && (image_scope == symbol);
+      if (implicit_resource) {
+        SYMBOL resource_name;
+        resource_name.symbol = single_resource_name;
+        c_symbol_list.push_back(resource_name);
+        in_image_scope = true;
+      }
       symbol->program_configuration_list->accept(*this);
+      if (implicit_resource) {
+        in_image_scope = false;
+        c_symbol_list.pop_back();
+      }
       return NULL;
     }
     
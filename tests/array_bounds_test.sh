@@ -0,0 +1,167 @@
+#!/bin/bash
+# matiec - a compiler for the programming languages defined in IEC 61131-3
+#
+# Copyright (C) 2003-2011  Mario de Sousa (msousa@fe.up.pt)
+# Copyright (C) 2007-2011  Laurent Bessard and Edouard Tisserant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Test of the runtime check of the array subscripts (option -O a of iec2c).
+#
+# The same program is compiled with -O a and with -O a,n. The subscripts proven to
+# always be within the array limits by a constant value or by the data type of the
+# subscript must never be checked. Those proven by the limits of a FOR loop or by a
+# subrange variable must only be checked when the variables may be forced from the
+# debugger (i.e. without -O n), and all the others must always be checked. The C code
+# generated in both cases is then compiled and linked with a minimal runtime that
+# prints the results of the program after each scan, to make sure the out of range
+# subscripts are clamped to the array limits.
+#
+# usage: ./array_bounds_test.sh
+
+CC=gcc
+CFLAGS=-O2
+SCANS=6
+
+TESTDIR=array_bounds_test.tmp
+rm -rf $TESTDIR
+mkdir -p $TESTDIR/debug $TESTDIR/nodebug
+
+cat > $TESTDIR/test.st <<EOF
+TYPE
+  idx_t : INT (1..10);
+END_TYPE
+
+PROGRAM main
+  VAR
+    arr  : ARRAY [1..10] OF INT;
+    big  : ARRAY [0..255] OF INT;
+    res  : ARRAY [0..7] OF INT;
+    scan : INT := 0;
+    i    : INT;
+    k    : idx_t := 3;
+    bad  : INT;
+    b    : USINT;
+  END_VAR
+  scan := scan + 1;
+
+  (* proven by the limits of the FOR loop *)
+  FOR i := 1 TO 10 DO arr[i] := i * 10; END_FOR;
+  res[2] := 0;
+  FOR i := 2 TO 9 DO res[2] := res[2] + arr[i - 1] + arr[i + 1]; END_FOR;
+  (* proven by a constant subscript *)
+  res[0] := arr[5];
+  (* proven by the data type of the subscript *)
+  k := scan + 2;
+  res[1] := arr[k];
+  b := INT_TO_USINT(scan * 100);
+  big[b] := scan;
+  res[5] := big[b];
+  (* not proven: 5, 10, 15, ... and -15, -10, -5, ... *)
+  bad := scan * 5;
+  res[3] := arr[bad];
+  res[4] := arr[bad - 20];
+END_PROGRAM
+
+CONFIGURATION config
+  RESOURCE resource1 ON PLC
+    TASK task0(INTERVAL := T#1ms, PRIORITY := 0);
+    PROGRAM instance0 WITH task0 : main;
+  END_RESOURCE
+END_CONFIGURATION
+EOF
+
+cat > $TESTDIR/main.c <<EOF
+#include <stdio.h>
+#include "iec_std_lib.h"
+#include "POUS.h"
+
+extern MAIN RESOURCE1__INSTANCE0;
+void config_run__(unsigned long tick);
+void config_init__(void);
+
+IEC_TIME __CURRENT_TIME;
+IEC_BOOL __DEBUG;
+
+int main(void)
+{
+    unsigned long tick;
+    int i;
+
+    config_init__();
+    for (tick = 0; tick < $SCANS; tick++) {
+        config_run__(tick);
+        for (i = 0; i < 6; i++)
+            printf("%ld ", (long)RESOURCE1__INSTANCE0.RES.value.table[i]);
+        printf("\n");
+    }
+    return 0;
+}
+EOF
+
+# res[3] and res[4] read arr[5 * scan] and arr[5 * scan - 20], clamped to arr[1..10]
+cat > $TESTDIR/expected <<EOF
+50 30 880 50 10 1 
+50 40 880 100 10 2 
+50 50 880 100 10 3 
+50 60 880 100 10 4 
+50 70 880 100 50 5 
+50 80 880 100 100 6 
+EOF
+
+check_subscript() {
+  if ! grep -q -F "$2" $OUTDIR/POUS.c; then
+    echo "array bounds test: subscript $2 $1 [$OPTIONS]"
+    exit 1
+  fi
+}
+
+for MODE in debug nodebug; do
+  OUTDIR=$TESTDIR/$MODE
+  case $MODE in
+    nodebug) OPTIONS="-O a,n"; CHECKS=2;;
+    *)       OPTIONS="-O a";   CHECKS=6;;
+  esac
+  ../iec2c $OPTIONS -I ../lib -T $OUTDIR $TESTDIR/test.st > /dev/null || exit 1
+
+  # the subscripts that are not proven in range
+  check_subscript "not checked" "ARR,.table[__ARRAY_INDEX((__GET_VAR(data__->BAD,)) - (1), 10)]"
+  check_subscript "not checked" "ARR,.table[__ARRAY_INDEX(((__GET_VAR(data__->BAD,) - 20)) - (1), 10)]"
+  # the subscripts that are proven in range whatever the debugger does
+  check_subscript "checked" "ARR,.table[(5) - (1)]"
+  check_subscript "checked" "BIG,.table[(__GET_VAR(data__->B,)) - (0)]"
+  # the subscripts that are proven in range unless a variable is forced
+  if [ $MODE = nodebug ]; then
+    check_subscript "checked" "ARR,.table[(__GET_VAR(data__->I,)) - (1)]"
+    check_subscript "checked" "ARR,.table[(__GET_VAR(data__->K,)) - (1)]"
+  else
+    check_subscript "not checked" "ARR,.table[__ARRAY_INDEX((__GET_VAR(data__->I,)) - (1), 10)]"
+    check_subscript "not checked" "ARR,.table[__ARRAY_INDEX((__GET_VAR(data__->K,)) - (1), 10)]"
+  fi
+  if [ $(grep -o "__ARRAY_INDEX" $OUTDIR/POUS.c | wc -l) -ne $CHECKS ]; then
+    echo "array bounds test: expected $CHECKS checked subscripts [$OPTIONS]"
+    grep "__ARRAY_INDEX" $OUTDIR/POUS.c
+    exit 1
+  fi
+
+  $CC -I ../lib/C -I $OUTDIR $CFLAGS -o $OUTDIR/test \
+      $TESTDIR/main.c $OUTDIR/config.c $OUTDIR/resource1.c || exit 1
+  $OUTDIR/test > $OUTDIR/results || exit 1
+  if ! cmp -s $TESTDIR/expected $OUTDIR/results; then
+    echo "array bounds test: wrong results [$OPTIONS]"
+    diff $TESTDIR/expected $OUTDIR/results
+    exit 1
+  fi
+done
+echo "array bounds test: OK"
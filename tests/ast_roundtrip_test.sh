@@ -0,0 +1,131 @@
+#!/bin/bash
+# matiec - a compiler for the programming languages defined in IEC 61131-3
+#
+# Copyright (C) 2003-2011  Mario de Sousa (msousa@fe.up.pt)
+# Copyright (C) 2007-2011  Laurent Bessard and Edouard Tisserant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Round trip test of the checked AST files (options -A and -L of iec2c, see absyntax_utils/serialize_ast.hh).
+#
+# A program using derived datatypes, functions, FBs (in ST and IL), a standard FB and an SFC is
+# compiled and its checked AST saved (-A). The code is then generated again from the saved AST (-L),
+# and the AST saved once more. The code generated both ways must be the same, and the AST saved
+# after loading it must be identical to the one saved after compiling the source.
+#
+# usage: ./ast_roundtrip_test.sh
+
+CC=gcc
+CFLAGS=-O2
+
+TESTDIR=ast_roundtrip_test.tmp
+rm -rf $TESTDIR
+mkdir -p $TESTDIR/compiled $TESTDIR/loaded
+
+cat > $TESTDIR/test.st <<EOF
+TYPE
+  colour : (red, green, blue);
+  point : STRUCT x : INT; y : INT; END_STRUCT;
+  small : INT (0..10);
+END_TYPE
+
+FUNCTION scale : INT
+  VAR_INPUT v : INT; k : small; END_VAR
+  scale := v * k;
+END_FUNCTION
+
+FUNCTION_BLOCK counter
+  VAR_INPUT inc : INT; END_VAR
+  VAR_OUTPUT q : INT; END_VAR
+  VAR n : INT; END_VAR
+  n := n + inc;
+  q := n;
+END_FUNCTION_BLOCK
+
+FUNCTION_BLOCK il_max
+  VAR_INPUT a, b : INT; END_VAR
+  VAR_OUTPUT m : INT; END_VAR
+  LD a
+  GT b
+  JMPC take_a
+  LD b
+  ST m
+  RET
+take_a:
+  LD a
+  ST m
+END_FUNCTION_BLOCK
+
+PROGRAM main
+  VAR
+    c : colour := green;
+    p : point;
+    arr : ARRAY [1..4] OF INT := [1, 2, 3, 4];
+    cnt : counter;
+    mx : il_max;
+    i, total : INT;
+    t : TON;
+  END_VAR
+  cnt(inc := 2);
+  mx(a := cnt.q, b := 5);
+  FOR i := 1 TO 4 DO total := total + scale(v := arr[i], k := 3); END_FOR;
+  IF c = green THEN p.x := total; END_IF;
+  t(IN := TRUE, PT := T#10ms);
+END_PROGRAM
+
+PROGRAM seq
+  VAR
+    p : point;
+  END_VAR
+  INITIAL_STEP start:
+  END_STEP
+  STEP running:
+    work(N);
+  END_STEP
+  TRANSITION FROM start TO running
+    := running.T < T#1s;
+  END_TRANSITION
+  TRANSITION FROM running TO start
+    := running.T >= T#3ms;
+  END_TRANSITION
+  ACTION work:
+    p.y := p.y + 1;
+  END_ACTION
+END_PROGRAM
+
+CONFIGURATION config
+  VAR_GLOBAL g : DINT := 7; END_VAR
+  RESOURCE resource1 ON PLC
+    TASK task0(INTERVAL := T#1ms, PRIORITY := 0);
+    PROGRAM instance0 WITH task0 : main;
+    PROGRAM instance1 WITH task0 : seq;
+  END_RESOURCE
+END_CONFIGURATION
+EOF
+
+for OPTIONS in "" "-O s,n"; do
+  ../iec2c $OPTIONS -I ../lib -T $TESTDIR/compiled -A $TESTDIR/compiled.ast $TESTDIR/test.st > /dev/null || exit 1
+  ../iec2c $OPTIONS -T $TESTDIR/loaded -L $TESTDIR/compiled.ast -A $TESTDIR/loaded.ast > /dev/null || exit 1
+  if ! diff -r $TESTDIR/compiled $TESTDIR/loaded; then
+    echo "AST round trip test: the code generated from the loaded AST differs [$OPTIONS]"
+    exit 1
+  fi
+  if ! cmp -s $TESTDIR/compiled.ast $TESTDIR/loaded.ast; then
+    echo "AST round trip test: the AST saved after loading it differs [$OPTIONS]"
+    exit 1
+  fi
+  $CC -I ../lib/C -I $TESTDIR/loaded $CFLAGS -c -o $TESTDIR/config.o $TESTDIR/loaded/config.c || exit 1
+  $CC -I ../lib/C -I $TESTDIR/loaded $CFLAGS -c -o $TESTDIR/resource1.o $TESTDIR/loaded/resource1.c || exit 1
+done
+echo "AST round trip test: OK"
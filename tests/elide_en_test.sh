@@ -0,0 +1,144 @@
+#!/bin/bash
+# matiec - a compiler for the programming languages defined in IEC 61131-3
+#
+# Copyright (C) 2003-2011  Mario de Sousa (msousa@fe.up.pt)
+# Copyright (C) 2007-2011  Laurent Bessard and Edouard Tisserant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Test of the removal of the EN/ENO handling of the POUs whose EN is never connected
+# (option -O e of iec2c).
+#
+# The same program is compiled with and without -O e, and the C code generated in
+# both cases is compiled and linked with a minimal runtime that prints the results of
+# the program after each scan. Both executables must print the expected results.
+# Only the FB called without EN may lose its 'Control execution' code, and its ENO
+# must still read TRUE, while the FB whose EN is connected must still skip its body
+# (and clear its ENO) whenever EN is FALSE.
+#
+# usage: ./elide_en_test.sh
+
+CC=gcc
+CFLAGS=-O2
+SCANS=4
+
+TESTDIR=elide_en_test.tmp
+rm -rf $TESTDIR
+mkdir -p $TESTDIR/plain $TESTDIR/elided
+
+cat > $TESTDIR/test.st <<EOF
+FUNCTION_BLOCK gated
+  VAR_INPUT inc : INT; END_VAR
+  VAR_OUTPUT q : INT; END_VAR
+  q := q + inc;
+END_FUNCTION_BLOCK
+
+FUNCTION_BLOCK free
+  VAR_INPUT inc : INT; END_VAR
+  VAR_OUTPUT q : INT; END_VAR
+  q := q + inc;
+END_FUNCTION_BLOCK
+
+PROGRAM main
+  VAR
+    res  : ARRAY [0..4] OF INT;
+    scan : INT := 0;
+    g : gated;
+    f : free;
+  END_VAR
+  scan := scan + 1;
+  g(EN := scan MOD 2 = 0, inc := scan);
+  f(inc := scan);
+  res[0] := scan;
+  res[1] := g.q;
+  res[2] := BOOL_TO_INT(g.ENO);
+  res[3] := f.q;
+  res[4] := BOOL_TO_INT(f.ENO);
+END_PROGRAM
+
+CONFIGURATION config
+  RESOURCE resource1 ON PLC
+    TASK task0(INTERVAL := T#1ms, PRIORITY := 0);
+    PROGRAM instance0 WITH task0 : main;
+  END_RESOURCE
+END_CONFIGURATION
+EOF
+
+cat > $TESTDIR/main.c <<EOF
+#include <stdio.h>
+#include "iec_std_lib.h"
+#include "POUS.h"
+
+extern MAIN RESOURCE1__INSTANCE0;
+void config_run__(unsigned long tick);
+void config_init__(void);
+
+IEC_TIME __CURRENT_TIME;
+IEC_BOOL __DEBUG;
+
+int main(void)
+{
+    unsigned long tick;
+    int i;
+
+    config_init__();
+    for (tick = 0; tick < $SCANS; tick++) {
+        config_run__(tick);
+        for (i = 0; i < 5; i++)
+            printf("%ld ", (long)RESOURCE1__INSTANCE0.RES.value.table[i]);
+        printf("\n");
+    }
+    return 0;
+}
+EOF
+
+# scan, g.q, g.ENO, f.q, f.ENO
+cat > $TESTDIR/expected <<EOF
+1 0 0 1 1 
+2 2 1 3 1 
+3 2 0 6 1 
+4 6 1 10 1 
+EOF
+
+for MODE in plain elided; do
+  OUTDIR=$TESTDIR/$MODE
+  case $MODE in
+    elided) OPTIONS="-O e";;
+    *)      OPTIONS="";;
+  esac
+  ../iec2c $OPTIONS -I ../lib -T $OUTDIR $TESTDIR/test.st || exit 1
+  $CC -I ../lib/C -I $OUTDIR $CFLAGS -o $OUTDIR/test \
+      $TESTDIR/main.c $OUTDIR/config.c $OUTDIR/resource1.c || exit 1
+  $OUTDIR/test > $OUTDIR/results || exit 1
+  if ! cmp -s $TESTDIR/expected $OUTDIR/results; then
+    echo "elide EN test: wrong results [$OPTIONS]"
+    diff $TESTDIR/expected $OUTDIR/results
+    exit 1
+  fi
+done
+
+# Lists the FBs whose body starts with the 'Control execution' code
+controlled_fbs() {
+  awk '/^void [A-Z_]*_body__\(/ {fb = $2; sub(/_body__.*/, "", fb)}
+       /\/\/ Control execution/ {print fb}' $1/POUS.c | tr '\n' ' '
+}
+if [ "$(controlled_fbs $TESTDIR/plain)" != "GATED FREE " ]; then
+  echo "elide EN test: the EN/ENO handling is missing without -O e"
+  exit 1
+fi
+if [ "$(controlled_fbs $TESTDIR/elided)" != "GATED " ]; then
+  echo "elide EN test: wrong FBs with EN/ENO handling with -O e: $(controlled_fbs $TESTDIR/elided)"
+  exit 1
+fi
+echo "elide EN test: OK"
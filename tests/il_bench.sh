@@ -0,0 +1,113 @@
+#!/bin/bash
+# matiec - a compiler for the programming languages defined in IEC 61131-3
+#
+# Copyright (C) 2003-2011  Mario de Sousa (msousa@fe.up.pt)
+# Copyright (C) 2007-2011  Laurent Bessard and Edouard Tisserant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Benchmark of the C code generated by iec2c for the same algorithm
+# (a pseudo random number generator feeding an accumulator) written
+# in IL and in ST.
+#
+# Each scan runs LOOPS iterations of the algorithm.
+#
+# usage: ./il_bench.sh [LOOPS [SCANS]]
+
+LOOPS=${1:-1000}
+SCANS=${2:-20000}
+
+CC=gcc
+CFLAGS=-O2
+
+BENCHDIR=il_bench.tmp
+rm -rf $BENCHDIR
+mkdir -p $BENCHDIR
+
+# The variables and the configuration shared by both versions of the algorithm
+print_header() {
+  echo "PROGRAM il_bench"
+  echo "  VAR"
+  echo "    i   : INT;"
+  echo "    x   : DINT := 12345;"
+  echo "    acc : DINT := 0;"
+  echo "  END_VAR"
+  echo
+}
+
+print_footer() {
+  echo "END_PROGRAM"
+  echo
+  echo "CONFIGURATION config"
+  echo "  RESOURCE resource1 ON PLC"
+  echo "    TASK task0(INTERVAL := T#1ms, PRIORITY := 0);"
+  echo "    PROGRAM instance0 WITH task0 : il_bench;"
+  echo "  END_RESOURCE"
+  echo "END_CONFIGURATION"
+}
+
+mkdir -p $BENCHDIR/il $BENCHDIR/st
+
+{
+  print_header
+  echo "  LD 1"
+  echo "  ST i"
+  echo "loop:"
+  echo "  LD x"
+  echo "  MUL 1103"
+  echo "  ADD 12345"
+  echo "  MOD 65536"
+  echo "  ST x"
+  echo "  GT 32768"
+  echo "  JMPC big"
+  echo "  LD acc"
+  echo "  SUB ( x"
+  echo "    MOD 256"
+  echo "  )"
+  echo "  ST acc"
+  echo "  JMP next"
+  echo "big:"
+  echo "  LD acc"
+  echo "  ADD x"
+  echo "  ST acc"
+  echo "next:"
+  echo "  LD i"
+  echo "  ADD 1"
+  echo "  ST i"
+  echo "  LE $LOOPS"
+  echo "  JMPC loop"
+  print_footer
+} > $BENCHDIR/il/il_bench.st
+
+{
+  print_header
+  echo "  FOR i := 1 TO $LOOPS DO"
+  echo "    x := (x * 1103 + 12345) MOD 65536;"
+  echo "    IF x > 32768 THEN"
+  echo "      acc := acc + x;"
+  echo "    ELSE"
+  echo "      acc := acc - (x MOD 256);"
+  echo "    END_IF;"
+  echo "  END_FOR;"
+  print_footer
+} > $BENCHDIR/st/il_bench.st
+
+for MODE in il st; do
+  OUTDIR=$BENCHDIR/$MODE
+  ../iec2c -I ../lib -T $OUTDIR $OUTDIR/il_bench.st || exit 1
+  $CC -I ../lib/C -I $OUTDIR $CFLAGS -o $OUTDIR/bench \
+      sfc_bench.c $OUTDIR/config.c $OUTDIR/resource1.c || exit 1
+  echo -n "$MODE: "
+  $OUTDIR/bench $SCANS
+done
@@ -0,0 +1,162 @@
+#!/bin/bash
+# matiec - a compiler for the programming languages defined in IEC 61131-3
+#
+# Copyright (C) 2003-2011  Mario de Sousa (msousa@fe.up.pt)
+# Copyright (C) 2007-2011  Laurent Bessard and Edouard Tisserant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Test of the inlining of the bodies of the FBs (option -O f of iec2c).
+#
+# The same program is compiled with and without -O f=8, and the C code generated in
+# both cases is compiled and linked with a minimal runtime that prints the results of
+# the program after each scan. Both executables must print the same results. The size
+# of a FB includes the inlined bodies of the FBs it calls, so the small FBs calling
+# the leaf FB once (from ST and from IL) are inlined, while the one calling it twice
+# (3 statements of its own, plus twice the 4 statements of the leaf FB) is not.
+#
+# usage: ./inline_fb_test.sh
+
+CC=gcc
+CFLAGS=-O2
+SCANS=6
+
+TESTDIR=inline_fb_test.tmp
+rm -rf $TESTDIR
+mkdir -p $TESTDIR/plain $TESTDIR/inlined
+
+cat > $TESTDIR/test.st <<EOF
+FUNCTION_BLOCK leaf
+  VAR_INPUT inc : INT; END_VAR
+  VAR_OUTPUT q : INT; END_VAR
+  VAR n : INT; END_VAR
+  n := n + inc;
+  IF n > 100 THEN n := 0; END_IF;
+  q := n;
+END_FUNCTION_BLOCK
+
+FUNCTION_BLOCK pair
+  VAR_INPUT inc : INT; END_VAR
+  VAR_OUTPUT q : INT; END_VAR
+  VAR a, b : leaf; END_VAR
+  a(inc := inc);
+  b(inc := a.q);
+  q := b.q;
+END_FUNCTION_BLOCK
+
+FUNCTION_BLOCK il_caller
+  VAR_INPUT inc : INT; END_VAR
+  VAR_OUTPUT q : INT; END_VAR
+  VAR c : leaf; END_VAR
+  CAL c(
+    inc := inc
+  )
+  LD c.q
+  ST q
+END_FUNCTION_BLOCK
+
+FUNCTION_BLOCK single
+  VAR_INPUT inc : INT; END_VAR
+  VAR_OUTPUT q : INT; END_VAR
+  VAR c : leaf; END_VAR
+  c(inc := inc * 2);
+  q := c.q;
+END_FUNCTION_BLOCK
+
+PROGRAM main
+  VAR
+    res  : ARRAY [0..3] OF INT;
+    scan : INT := 0;
+    p : pair;
+    i : il_caller;
+    s : single;
+  END_VAR
+  scan := scan + 1;
+  p(inc := scan);
+  i(inc := scan);
+  s(inc := scan);
+  res[0] := scan;
+  res[1] := p.q;
+  res[2] := i.q;
+  res[3] := s.q;
+END_PROGRAM
+
+CONFIGURATION config
+  RESOURCE resource1 ON PLC
+    TASK task0(INTERVAL := T#1ms, PRIORITY := 0);
+    PROGRAM instance0 WITH task0 : main;
+  END_RESOURCE
+END_CONFIGURATION
+EOF
+
+cat > $TESTDIR/main.c <<EOF
+#include <stdio.h>
+#include "iec_std_lib.h"
+#include "POUS.h"
+
+extern MAIN RESOURCE1__INSTANCE0;
+void config_run__(unsigned long tick);
+void config_init__(void);
+
+IEC_TIME __CURRENT_TIME;
+IEC_BOOL __DEBUG;
+
+int main(void)
+{
+    unsigned long tick;
+    int i;
+
+    config_init__();
+    for (tick = 0; tick < $SCANS; tick++) {
+        config_run__(tick);
+        for (i = 0; i < 4; i++)
+            printf("%ld ", (long)RESOURCE1__INSTANCE0.RES.value.table[i]);
+        printf("\n");
+    }
+    return 0;
+}
+EOF
+
+for MODE in plain inlined; do
+  OUTDIR=$TESTDIR/$MODE
+  case $MODE in
+    inlined) OPTIONS="-O f=8";;
+    *)       OPTIONS="";;
+  esac
+  ../iec2c $OPTIONS -I ../lib -T $OUTDIR $TESTDIR/test.st || exit 1
+  $CC -I ../lib/C -I $OUTDIR $CFLAGS -o $OUTDIR/test \
+      $TESTDIR/main.c $OUTDIR/config.c $OUTDIR/resource1.c || exit 1
+  $OUTDIR/test > $OUTDIR/results || exit 1
+done
+
+for FB in LEAF SINGLE IL_CALLER; do
+  if ! grep -q "__INLINE_FB_BODY void ${FB}_body__" $TESTDIR/inlined/POUS.c; then
+    echo "inline FB test: the body of $FB is not inlined"
+    exit 1
+  fi
+done
+if grep -q "__INLINE_FB_BODY void PAIR_body__" $TESTDIR/inlined/POUS.c; then
+  echo "inline FB test: the body of PAIR is inlined, but is larger than the threshold"
+  exit 1
+fi
+if grep -q "__INLINE_FB_BODY" $TESTDIR/plain/POUS.c; then
+  echo "inline FB test: a FB body is inlined without -O f"
+  exit 1
+fi
+if ! cmp -s $TESTDIR/plain/results $TESTDIR/inlined/results; then
+  echo "inline FB test: results differ with -O f"
+  diff $TESTDIR/plain/results $TESTDIR/inlined/results
+  exit 1
+fi
+echo "inline FB test: OK"
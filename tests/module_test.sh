@@ -0,0 +1,72 @@
+#!/bin/bash
+# matiec - a compiler for the programming languages defined in IEC 61131-3
+#
+# Copyright (C) 2003-2011  Mario de Sousa (msousa@fe.up.pt)
+# Copyright (C) 2007-2011  Laurent Bessard and Edouard Tisserant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# End to end test of the library modules (options -m and -M of iec2c).
+#
+# A library module is compiled with -m, and a project using it is then
+# compiled with -M. Both the module and the project implicitly declare the
+# same array and REF_TO datatypes, which must be declared only once in C.
+# The C code generated for the module and for the project is compiled
+# and linked with the minimal runtime in sfc_bench.c, and a few scans
+# are executed.
+#
+# usage: ./module_test.sh
+
+CC=gcc
+CFLAGS=-O2
+
+TESTDIR=module_test.tmp
+rm -rf $TESTDIR
+mkdir -p $TESTDIR/mylib $TESTDIR/prj
+
+cat > $TESTDIR/mylib.st <<EOF
+FUNCTION_BLOCK lib_fb
+  VAR_INPUT i : INT; END_VAR
+  VAR_OUTPUT q : INT; END_VAR
+  VAR buf : ARRAY [1..10] OF INT; p : REF_TO INT; END_VAR
+  buf[1] := i;
+  p := REF(buf[1]);
+  q := p^ * 2;
+END_FUNCTION_BLOCK
+EOF
+
+cat > $TESTDIR/prj.st <<EOF
+PROGRAM main
+  VAR f : lib_fb; arr : ARRAY [1..10] OF INT; r : REF_TO INT; x : INT; END_VAR
+  arr[1] := 5;
+  r := REF(arr[1]);
+  f(i := r^);
+  x := f.q;
+END_PROGRAM
+
+CONFIGURATION config
+  RESOURCE resource1 ON PLC
+    TASK task0(INTERVAL := T#1ms, PRIORITY := 0);
+    PROGRAM instance0 WITH task0 : main;
+  END_RESOURCE
+END_CONFIGURATION
+EOF
+
+../iec2c -r -I ../lib -T $TESTDIR/mylib -m $TESTDIR/mylib/mylib.mod $TESTDIR/mylib.st || exit 1
+../iec2c -r -I ../lib -T $TESTDIR/prj   -M $TESTDIR/mylib/mylib.mod $TESTDIR/prj.st   || exit 1
+
+$CC -I ../lib/C -I $TESTDIR/mylib -I $TESTDIR/prj $CFLAGS -o $TESTDIR/test \
+    sfc_bench.c $TESTDIR/mylib/mylib.c $TESTDIR/prj/config.c $TESTDIR/prj/resource1.c || exit 1
+$TESTDIR/test 10 > /dev/null || exit 1
+echo "module test: OK"
@@ -0,0 +1,204 @@
+#!/bin/bash
+# matiec - a compiler for the programming languages defined in IEC 61131-3
+#
+# Copyright (C) 2003-2011  Mario de Sousa (msousa@fe.up.pt)
+# Copyright (C) 2007-2011  Laurent Bessard and Edouard Tisserant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Regression test of the propagation of the values of the variables (option -O k of iec2c).
+#
+# The same program is compiled with and without -O k, and the C code generated
+# in both cases is compiled and linked with a minimal runtime that prints the
+# results of the program after each scan. Both executables must print the same
+# results. The program covers the places where the values known at compile time
+# must be merged or forgotten: IF/ELSIF and CASE branches, loops, variables whose
+# address is taken with REF(), VAR_IN_OUT parameters and FB output parameters (in ST and IL).
+#
+# usage: ./propagation_test.sh
+
+CC=gcc
+CFLAGS=-O2
+SCANS=6
+
+TESTDIR=propagation_test.tmp
+rm -rf $TESTDIR
+mkdir -p $TESTDIR/plain $TESTDIR/propagated
+
+cat > $TESTDIR/test.st <<EOF
+FUNCTION_BLOCK counter
+  VAR_INPUT inc : INT; END_VAR
+  VAR_OUTPUT q : INT; END_VAR
+  VAR n : INT; END_VAR
+  n := n + inc;
+  q := n;
+END_FUNCTION_BLOCK
+
+FUNCTION_BLOCK il_counter
+  VAR_INPUT inc : INT; END_VAR
+  VAR_OUTPUT q : INT; END_VAR
+  VAR c : counter; END_VAR
+  CAL c(
+    inc := inc
+  )
+  LD c.q
+  ST q
+END_FUNCTION_BLOCK
+
+FUNCTION add_to : INT
+  VAR_IN_OUT x : INT; END_VAR
+  VAR_INPUT d : INT; END_VAR
+  x := x + d;
+  add_to := x;
+END_FUNCTION
+
+FUNCTION set_ref : INT
+  VAR_INPUT r : REF_TO INT; v : INT; END_VAR
+  r^ := v;
+  set_ref := v;
+END_FUNCTION
+
+PROGRAM main
+  VAR
+    res  : ARRAY [0..15] OF INT;
+    scan : INT := 0;
+    a, b, c, i : INT;
+    flag : BOOL;
+    p    : REF_TO INT;
+    cnt  : counter;
+    ilc  : il_counter;
+    arr  : ARRAY [0..9] OF INT;
+  END_VAR
+  scan := scan + 1;
+
+  (* IF/ELSIF branches *)
+  a := 1;
+  IF scan > 2 THEN a := 2; ELSIF scan > 1 THEN a := 3; END_IF;
+  res[0] := a;
+  b := 5;
+  IF TRUE THEN b := 6; ELSE b := 7; END_IF;
+  res[1] := b;
+  flag := FALSE;
+  IF scan MOD 2 = 0 THEN flag := TRUE; END_IF;
+  IF flag THEN res[2] := 1; ELSIF a = 1 THEN res[2] := 2; ELSE res[2] := 3; END_IF;
+
+  (* CASE branches *)
+  c := 10;
+  CASE scan OF
+    1:    c := 11;
+    2, 3: c := 12;
+  ELSE
+    c := c + 1;
+  END_CASE;
+  res[3] := c;
+
+  (* loops *)
+  b := 0;
+  FOR i := 1 TO 5 DO b := b + i; END_FOR;
+  res[4] := b;
+  res[5] := i;
+  a := 3;
+  WHILE a < 10 DO a := a + 4; END_WHILE;
+  res[6] := a;
+  a := 0;
+  REPEAT a := a + 1; UNTIL a >= 3 END_REPEAT;
+  res[7] := a;
+
+  (* variable written through a reference *)
+  a := 1;
+  p := REF(a);
+  b := set_ref(r := p, v := 40 + scan);
+  res[8] := a;
+
+  (* VAR_IN_OUT parameter *)
+  c := 1;
+  b := add_to(x := c, d := 5);
+  res[9] := c;
+  res[10] := b;
+
+  (* FB output parameters *)
+  b := 0;
+  cnt(inc := 2, q => b);
+  res[11] := b;
+  cnt(inc := 1);
+  b := cnt.q;
+  res[12] := b;
+  ilc(inc := 3);
+  res[15] := ilc.q;
+
+  (* array subscripts *)
+  i := 3;
+  arr[i] := scan;
+  res[13] := arr[3];
+  res[14] := arr[i + 1];
+END_PROGRAM
+
+CONFIGURATION config
+  RESOURCE resource1 ON PLC
+    TASK task0(INTERVAL := T#1ms, PRIORITY := 0);
+    PROGRAM instance0 WITH task0 : main;
+  END_RESOURCE
+END_CONFIGURATION
+EOF
+
+cat > $TESTDIR/main.c <<EOF
+#include <stdio.h>
+#include "iec_std_lib.h"
+#include "POUS.h"
+
+extern MAIN RESOURCE1__INSTANCE0;
+void config_run__(unsigned long tick);
+void config_init__(void);
+
+IEC_TIME __CURRENT_TIME;
+IEC_BOOL __DEBUG;
+
+int main(void)
+{
+    unsigned long tick;
+    int i;
+
+    config_init__();
+    for (tick = 0; tick < $SCANS; tick++) {
+        config_run__(tick);
+        for (i = 0; i < 16; i++)
+            printf("%ld ", (long)RESOURCE1__INSTANCE0.RES.value.table[i]);
+        printf("\n");
+    }
+    return 0;
+}
+EOF
+
+for MODE in plain propagated; do
+  OUTDIR=$TESTDIR/$MODE
+  case $MODE in
+    propagated) OPTIONS="-O k";;
+    *)          OPTIONS="";;
+  esac
+  ../iec2c -r $OPTIONS -I ../lib -T $OUTDIR $TESTDIR/test.st || exit 1
+  $CC -I ../lib/C -I $OUTDIR $CFLAGS -o $OUTDIR/test \
+      $TESTDIR/main.c $OUTDIR/config.c $OUTDIR/resource1.c || exit 1
+  $OUTDIR/test > $OUTDIR/results || exit 1
+done
+
+if cmp -s $TESTDIR/plain/POUS.c $TESTDIR/propagated/POUS.c; then
+  echo "propagation test: -O k did not change the generated code"
+  exit 1
+fi
+if ! cmp -s $TESTDIR/plain/results $TESTDIR/propagated/results; then
+  echo "propagation test: results differ with -O k"
+  diff $TESTDIR/plain/results $TESTDIR/propagated/results
+  exit 1
+fi
+echo "propagation test: OK"
@@ -0,0 +1,73 @@
+/*
+ *  matiec - a compiler for the programming languages defined in IEC 61131-3
+ *
+ *  Copyright (C) 2003-2011  Mario de Sousa (msousa@fe.up.pt)
+ *  Copyright (C) 2007-2011  Laurent Bessard and Edouard Tisserant
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ *
+ *
+ * Minimal C runtime used by sfc_bench.sh and il_bench.sh to time the scans
+ * of the generated code. The PLC time is advanced by 1ms on each scan, independently
+ * of the real time taken by the scan.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "iec_types.h"
+
+/*
+ * Functions and variables provied by generated C softPLC
+ **/
+void config_run__(unsigned long tick);
+void config_init__(void);
+
+/*
+ *  Functions and variables to export to generated C softPLC
+ **/
+IEC_TIME __CURRENT_TIME;
+IEC_BOOL __DEBUG;
+
+int main(int argc, char **argv)
+{
+    unsigned long tick, scans = (argc > 1) ? strtoul(argv[1], NULL, 10) : 100000;
+    struct timespec start, end;
+    double elapsed;
+
+    __CURRENT_TIME.tv_sec = 0;
+    __CURRENT_TIME.tv_nsec = 0;
+    config_init__();
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (tick = 0; tick < scans; tick++) {
+        __CURRENT_TIME.tv_nsec += 1000000;
+        if (__CURRENT_TIME.tv_nsec >= 1000000000) {
+            __CURRENT_TIME.tv_nsec -= 1000000000;
+            __CURRENT_TIME.tv_sec++;
+        }
+        config_run__(tick);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    elapsed = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("%lu scans, %.1f ns/scan\n", scans, elapsed / scans);
+    return 0;
+}
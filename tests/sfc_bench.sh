@@ -0,0 +1,104 @@
+#!/bin/bash
+# matiec - a compiler for the programming languages defined in IEC 61131-3
+#
+# Copyright (C) 2003-2011  Mario de Sousa (msousa@fe.up.pt)
+# Copyright (C) 2007-2011  Laurent Bessard and Edouard Tisserant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Benchmark of the SFC code generated by iec2c, with and without the
+# sparse SFC engine (iec2c -O s), and without the debugger support (iec2c -O n).
+# The time taken by the C compiler is also reported, as it grows with the size of the chart.
+#
+# The generated chart has BRANCHES parallel branches (i.e. that many active
+# steps), each one a loop of STEPS steps. Every step has an action association,
+# and the token of each branch stays DWELL scans (of 1ms) in each step.
+#
+# usage: ./sfc_bench.sh [BRANCHES [STEPS [DWELL [SCANS]]]]
+
+BRANCHES=${1:-4}
+STEPS=${2:-300}
+DWELL=${3:-5}
+SCANS=${4:-100000}
+
+CC=gcc
+CFLAGS=-O2
+
+BENCHDIR=sfc_bench.tmp
+rm -rf $BENCHDIR
+mkdir -p $BENCHDIR
+
+# Generate the chart
+STFILE=$BENCHDIR/sfc_bench.st
+{
+  echo "PROGRAM sfc_bench"
+  echo "  VAR"
+  echo "    count : UDINT := 0;"
+  echo "  END_VAR"
+  echo
+  echo "  INITIAL_STEP start:"
+  echo "  END_STEP"
+  echo
+  for ((b = 0; b < BRANCHES; b++)); do
+    for ((s = 0; s < STEPS; s++)); do
+      echo "  STEP b${b}_s${s}:"
+      echo "    work(N);"
+      echo "  END_STEP"
+    done
+  done
+  echo
+  TO="b0_s0"
+  for ((b = 1; b < BRANCHES; b++)); do TO="$TO, b${b}_s0"; done
+  echo "  TRANSITION FROM start TO ($TO)"
+  echo "    := TRUE;"
+  echo "  END_TRANSITION"
+  echo
+  for ((b = 0; b < BRANCHES; b++)); do
+    for ((s = 0; s < STEPS; s++)); do
+      echo "  TRANSITION FROM b${b}_s${s} TO b${b}_s$(( (s + 1) % STEPS ))"
+      echo "    := b${b}_s${s}.T >= T#${DWELL}ms;"
+      echo "  END_TRANSITION"
+    done
+  done
+  echo
+  echo "  ACTION work:"
+  echo "    count := count + 1;"
+  echo "  END_ACTION"
+  echo "END_PROGRAM"
+  echo
+  echo "CONFIGURATION config"
+  echo "  RESOURCE resource1 ON PLC"
+  echo "    TASK task0(INTERVAL := T#1ms, PRIORITY := 0);"
+  echo "    PROGRAM instance0 WITH task0 : sfc_bench;"
+  echo "  END_RESOURCE"
+  echo "END_CONFIGURATION"
+} > $STFILE
+
+for MODE in full nodebug sparse sparse_nodebug; do
+  OUTDIR=$BENCHDIR/$MODE
+  mkdir -p $OUTDIR
+  case $MODE in
+    nodebug)        OPTIONS="-O n";;
+    sparse)         OPTIONS="-O s";;
+    sparse_nodebug) OPTIONS="-O s,n";;
+    *)              OPTIONS="";;
+  esac
+  ../iec2c $OPTIONS -I ../lib -T $OUTDIR $STFILE || exit 1
+  START=$(date +%s)
+  $CC -I ../lib/C -I $OUTDIR $CFLAGS -o $OUTDIR/bench \
+      sfc_bench.c $OUTDIR/config.c $OUTDIR/resource1.c || exit 1
+  echo -n "$MODE: compiled in $(( $(date +%s) - START ))s, "
+  $OUTDIR/bench $SCANS
+  size $OUTDIR/bench | tail -n 1
+done
@@ -0,0 +1,156 @@
+#!/bin/bash
+# matiec - a compiler for the programming languages defined in IEC 61131-3
+#
+# Copyright (C) 2003-2011  Mario de Sousa (msousa@fe.up.pt)
+# Copyright (C) 2007-2011  Laurent Bessard and Edouard Tisserant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Test of the removal of the unused POUs and variables (option -u of iec2c).
+#
+# The same program is compiled with and without -u, and the C code generated in both
+# cases is compiled and linked with a minimal runtime that prints the results of the
+# program after each scan. Both executables must print the same results. The POUs and
+# the Function and FB variables that are never used must be reported as removed, and
+# the variables of the programs (even those never used) must still be listed in
+# VARIABLES.csv, so they can be read with the debugger.
+#
+# usage: ./unused_code_test.sh
+
+CC=gcc
+CFLAGS=-O2
+SCANS=4
+
+TESTDIR=unused_code_test.tmp
+rm -rf $TESTDIR
+mkdir -p $TESTDIR/plain $TESTDIR/removed
+
+cat > $TESTDIR/test.st <<EOF
+FUNCTION twice : INT
+  VAR_INPUT v : INT; END_VAR
+  VAR unused_tmp : INT; END_VAR
+  twice := v * 2;
+END_FUNCTION
+
+FUNCTION never_called : INT
+  VAR_INPUT v : INT; END_VAR
+  never_called := v;
+END_FUNCTION
+
+FUNCTION_BLOCK inner
+  VAR_INPUT inc : INT; END_VAR
+  VAR_OUTPUT q : INT; END_VAR
+  q := q + inc;
+END_FUNCTION_BLOCK
+
+FUNCTION_BLOCK never_instantiated
+  VAR_OUTPUT q : INT; END_VAR
+  q := 1;
+END_FUNCTION_BLOCK
+
+FUNCTION_BLOCK outer
+  VAR_INPUT inc : INT; END_VAR
+  VAR_OUTPUT q : INT; END_VAR
+  VAR
+    used : inner;
+    unused_fb : inner;
+    unused_var : DINT := 5;
+  END_VAR
+  used(inc := twice(v := inc));
+  q := used.q;
+END_FUNCTION_BLOCK
+
+PROGRAM main
+  VAR
+    res : ARRAY [0..3] OF INT;
+    cnt : outer;
+    watched : INT := 42;
+    scan : INT := 0;
+  END_VAR
+  scan := scan + 1;
+  cnt(inc := scan);
+  res[0] := scan;
+  res[1] := cnt.q;
+  res[2] := twice(v := cnt.q);
+END_PROGRAM
+
+CONFIGURATION config
+  RESOURCE resource1 ON PLC
+    TASK task0(INTERVAL := T#1ms, PRIORITY := 0);
+    PROGRAM instance0 WITH task0 : main;
+  END_RESOURCE
+END_CONFIGURATION
+EOF
+
+cat > $TESTDIR/main.c <<EOF
+#include <stdio.h>
+#include "iec_std_lib.h"
+#include "POUS.h"
+
+extern MAIN RESOURCE1__INSTANCE0;
+void config_run__(unsigned long tick);
+void config_init__(void);
+
+IEC_TIME __CURRENT_TIME;
+IEC_BOOL __DEBUG;
+
+int main(void)
+{
+    unsigned long tick;
+    int i;
+
+    config_init__();
+    for (tick = 0; tick < $SCANS; tick++) {
+        config_run__(tick);
+        for (i = 0; i < 3; i++)
+            printf("%ld ", (long)RESOURCE1__INSTANCE0.RES.value.table[i]);
+        printf("%ld\n", (long)RESOURCE1__INSTANCE0.WATCHED.value);
+    }
+    return 0;
+}
+EOF
+
+for MODE in plain removed; do
+  OUTDIR=$TESTDIR/$MODE
+  case $MODE in
+    removed) OPTIONS="-u";;
+    *)       OPTIONS="";;
+  esac
+  ../iec2c $OPTIONS -I ../lib -T $OUTDIR $TESTDIR/test.st > $OUTDIR/report 2>&1 || { cat $OUTDIR/report; exit 1; }
+  $CC -I ../lib/C -I $OUTDIR $CFLAGS -o $OUTDIR/test \
+      $TESTDIR/main.c $OUTDIR/config.c $OUTDIR/resource1.c || exit 1
+  $OUTDIR/test > $OUTDIR/results || exit 1
+done
+
+for REMOVED in "POU 'NEVER_CALLED'" "POU 'NEVER_INSTANTIATED'" "variable 'UNUSED_TMP'" "variable 'UNUSED_FB'" "variable 'UNUSED_VAR'"; do
+  if ! grep -q -i "removed unused $REMOVED" $TESTDIR/removed/report; then
+    echo "unused code test: unused $REMOVED not removed"
+    cat $TESTDIR/removed/report
+    exit 1
+  fi
+done
+if grep -q -i "variable '.*' of POU 'MAIN'" $TESTDIR/removed/report; then
+  echo "unused code test: a variable of a program was removed"
+  exit 1
+fi
+if ! grep -q "INSTANCE0.WATCHED;" $TESTDIR/removed/VARIABLES.csv; then
+  echo "unused code test: the variable of a program is missing from VARIABLES.csv"
+  exit 1
+fi
+if ! cmp -s $TESTDIR/plain/results $TESTDIR/removed/results; then
+  echo "unused code test: results differ with -u"
+  diff $TESTDIR/plain/results $TESTDIR/removed/results
+  exit 1
+fi
+echo "unused code test: OK"
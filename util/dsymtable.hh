@@ -45,19 +45,16 @@
 
 
 template<typename value_type> class dsymtable_c {
-  /* Case insensitive string compare copied from
-   * "The C++ Programming Language" - 3rd Edition
-   * by Bjarne Stroustrup, ISBN 0201889544.
+  /* Case insensitive string compare, the same as in symtable.hh
+   * (adapted from "The C++ Programming Language" - 3rd Edition, by Bjarne Stroustrup).
    */
   class nocase_c {
     public:
       bool operator() (const std::string& x, const std::string& y) const {
-        std::string::const_iterator ix = x.begin();
-        std::string::const_iterator iy = y.begin();
+        const unsigned char *ix = (const unsigned char *)x.c_str();
+        const unsigned char *iy = (const unsigned char *)y.c_str();
 
-        for(; (ix != x.end()) && (iy != y.end()) && (toupper(*ix) == toupper(*iy)); ++ix, ++iy);
-        if (ix == x.end()) return (iy != y.end());
-        if (iy == y.end()) return false;
+        for(; (*ix != '\0') && (toupper(*ix) == toupper(*iy)); ++ix, ++iy);
         return (toupper(*ix) < toupper(*iy));
       };
   };
@@ -163,16 +163,12 @@ typename symtable_c<value_type>::iterator symtable_c<value_type>::begin(void) {r
 /* returns end() if not found! */
 template<typename value_type>
 typename symtable_c<value_type>::iterator symtable_c<value_type>::find(const       char *identifier_str) {
-  iterator i;
-  if ((inner_scope != NULL) && ((i = inner_scope->find(identifier_str)) != inner_scope->end()))  // NOTE: must use the end() value of the inner scope!
-      return i;  // found in the lower level
-  /* if no lower level, or not found in lower level... */
-  return _base.find(identifier_str);
+  return find(std::string(identifier_str));
 }
 
 
 template<typename value_type>
-typename symtable_c<value_type>::iterator symtable_c<value_type>::find(const std::string identifier_str) {
+typename symtable_c<value_type>::iterator symtable_c<value_type>::find(const std::string &identifier_str) {
   iterator i;
   if ((inner_scope != NULL) && ((i = inner_scope->find(identifier_str)) != inner_scope->end()))  // NOTE: must use the end() value of the inner scope!
       return i;  // found in the lower level
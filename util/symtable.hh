@@ -43,19 +43,20 @@
 
 
 template<typename value_type> class symtable_c {
-  /* Case insensitive string compare copied from
+  /* Case insensitive string compare adapted from
    * "The C++ Programming Language" - 3rd Edition
    * by Bjarne Stroustrup, ISBN 0201889544.
+   * It walks the C strings instead of the std::string iterators, as it is called
+   * (by the lexer, through get_identifier_token()) for every identifier parsed.
+   * The terminating '\0' sorts shorter strings first, so the order is the same.
    */
   class nocase_c {
     public:
       bool operator() (const std::string& x, const std::string& y) const {
-        std::string::const_iterator ix = x.begin();
-        std::string::const_iterator iy = y.begin();
+        const unsigned char *ix = (const unsigned char *)x.c_str();
+        const unsigned char *iy = (const unsigned char *)y.c_str();
 
-        for(; (ix != x.end()) && (iy != y.end()) && (toupper(*ix) == toupper(*iy)); ++ix, ++iy);
-        if (ix == x.end()) return (iy != y.end());
-        if (iy == y.end()) return false;
+        for(; (*ix != '\0') && (toupper(*ix) == toupper(*iy)); ++ix, ++iy);
         return (toupper(*ix) < toupper(*iy));
       };
   };
@@ -107,7 +108,7 @@ template<typename value_type> class symtable_c {
     iterator               begin(void);
     iterator               end  (void);
     iterator               find (const char       *identifier_str);
-    iterator               find (const std::string identifier_str);
+    iterator               find (const std::string &identifier_str);
     iterator               find (const symbol_c   *symbol        );
 
 